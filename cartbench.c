@@ -0,0 +1,888 @@
+/** \file   cartbench.c
+ * \brief   Synthetic corpus generator and end to end benchmark of cartconv
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* a binary is written for every type that cartconv_get_type() returns at
+   every size the type accepts, and for the Dela/Rex types a set of base
+   files with inserted eproms. the cartconv binary is then run on all of
+   them for bin->crt, crt->bin and -f, every phase a few times, and the
+   best time and the peak RSS of the phase are written as JSON. after the
+   runs the outputs are checked byte for byte. */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "cartconv.h"
+
+#define BENCH_MAX_INSERTS   32
+#define BENCH_MAX_ARGS      (8 + 2 * BENCH_MAX_INSERTS)
+#define BENCH_BLOCK         0x2000
+
+/* the binary sizes that are tried against the sizes of every type. sizes
+   made of several bits like 0x18000 (96KiB Magic Desk, Retro Replay) have to
+   come back with the same size, not the next larger one */
+static const unsigned int bench_sizes[] = {
+    0x800, 0x1000, 0x2000, 0x3000, 0x4000, 0x5000, 0x6000, 0x8000,
+    0x10000, 0x18000, 0x20000, 0x40000, 0x80000, 0x100000, 0x200000,
+    0x400000, 0x800000, 0x1000000, 0
+};
+
+/* where a type puts a binary of another size than it stores, the rest of
+   the binary that comes back is $ff. a binary that comes back with another
+   size and is not listed here is a failure */
+typedef struct bench_placement_s {
+    const char *opt;
+    unsigned int size;          /* of the input */
+    unsigned int offset;        /* of the input in the binary that comes back */
+    unsigned int out_size;      /* of the binary that comes back */
+} bench_placement_t;
+
+static const bench_placement_t bench_placements[] = {
+    /* the Final Cartridge Plus has its rom at $2000 of the 32KiB */
+    { "fcp", 0x2000, 0x2000, 0x8000 },
+    { "fcp", 0x4000, 0x2000, 0x8000 },
+    { "fcp", 0x6000, 0x2000, 0x8000 },
+    /* padded up to the size of the cart */
+    { "ecr", 0x2000, 0, 0x6000 },
+    { "ecr", 0x4000, 0, 0x6000 },
+    { "ks", 0x2000, 0, 0x6000 },
+    { "ks", 0x4000, 0, 0x6000 },
+    { "zaxxon", 0x1000, 0, 0x5000 },
+    { "zaxxon", 0x4000, 0, 0x5000 },
+    /* only the first 8KiB are stored */
+    { "bis", 0x3000, 0, 0x2000 },
+    { "mach5", 0x3000, 0, 0x2000 },
+    { NULL, 0, 0, 0 }
+};
+
+/* eproms inserted after the 8KiB base file, 0 terminated. the 8KiB images
+   of the Rex EP256 are left out, save_rexep256_crt() puts them all into
+   bank 1 and they do not come back out of the .crt */
+typedef struct bench_insert_s {
+    const char *opt;
+    unsigned int sizes[BENCH_MAX_INSERTS + 1];
+} bench_insert_t;
+
+static const bench_insert_t bench_inserts[] = {
+    { "dep64", { 0 } },
+    { "dep64", { 0x8000, 0 } },
+    { "dep64", { 0x8000, 0x8000, 0 } },
+    { "dep256", { 0x2000, 0 } },
+    { "dep256", { 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000,
+                  0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000,
+                  0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000,
+                  0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0 } },
+    { "dep256", { 0x8000, 0x8000, 0x8000, 0x8000, 0x8000, 0x8000, 0x8000, 0 } },
+    { "dep7x8", { 0x8000, 0x4000, 0x2000, 0 } },
+    { "dep7x8", { 0x4000, 0x4000, 0x4000, 0x2000, 0 } },
+    { "dep7x8", { 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0x2000, 0 } },
+    { "rep256", { 0x8000, 0x8000, 0 } },
+    { "rep256", { 0x8000, 0x8000, 0x8000, 0x8000, 0x8000, 0x8000, 0x8000, 0x8000, 0 } },
+    { NULL, { 0 } }
+};
+
+typedef struct bench_file_s {
+    const char *opt;
+    char name[32];              /* <name>.bin, <name>.crt, <name>.f/ ... */
+    unsigned int inserts;       /* <name>-<n>.bin, only for Dela/Rex */
+    size_t bin_size;            /* of the base file and all inserts */
+    size_t crt_size;
+} bench_file_t;
+
+typedef struct bench_phase_s {
+    const char *name;
+    unsigned int files;
+    double bytes;
+    double seconds;             /* the best run */
+    long peak_rss;              /* KiB, the largest of all runs */
+} bench_phase_t;
+
+enum {
+    PHASE_BIN2CRT = 0,
+    PHASE_CRT2BIN,
+    PHASE_EXTRACT,
+    PHASE_NUM
+};
+
+static bench_phase_t phases[PHASE_NUM] = {
+    { "bin2crt", 0, 0.0, 0.0, 0 },
+    { "crt2bin", 0, 0.0, 0.0, 0 },
+    { "extract", 0, 0.0, 0.0, 0 }
+};
+
+static char cartconv_path[PATH_MAX];
+static char corpus_dir[PATH_MAX];
+static bench_file_t *files = NULL;
+static unsigned int files_num = 0;
+static unsigned int types_num = 0;
+static unsigned int checked = 0;
+static unsigned int resized = 0;
+static unsigned int reordered = 0;
+static unsigned int failed = 0;
+
+static void usage(void)
+{
+    printf("usage: cartbench [-c cartconv] [-d corpus dir] [-n runs] [-o json name] [-b old json] [-t percent]\n\n");
+    printf("-c <name>    the cartconv binary to measure (default ./cartconv)\n");
+    printf("-d <dir>     write the corpus here and keep it (default: a temporary directory)\n");
+    printf("-n <runs>    runs of every phase, the best one counts (default 3)\n");
+    printf("-o <name>    write the results as JSON to this file (default stdout)\n");
+    printf("-b <name>    compare against the JSON of an earlier run\n");
+    printf("-t <percent> slowdown or RSS growth that counts as a regression (default 10)\n");
+    exit(1);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* run cartconv with args in dir (NULL: the corpus), stdout goes to /dev/null */
+static int run_cartconv(const char *dir, const char **args, double *seconds, long *rss)
+{
+    const char *argv[BENCH_MAX_ARGS + 2];
+    struct rusage ru;
+    double start;
+    pid_t pid;
+    int status, i;
+
+    argv[0] = cartconv_path;
+    for (i = 0; args[i] != NULL && i < BENCH_MAX_ARGS; i++) {
+        argv[i + 1] = args[i];
+    }
+    argv[i + 1] = NULL;
+
+    fflush(stdout);
+    fflush(stderr);
+    start = now();
+    pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        int fd = open("/dev/null", O_WRONLY);
+
+        if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0 || chdir(dir ? dir : corpus_dir) < 0) {
+            _exit(127);
+        }
+        close(fd);
+        execv(cartconv_path, (char * const *)argv);
+        _exit(127);
+    }
+    while (wait4(pid, &status, 0, &ru) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+    if (seconds) {
+        *seconds += now() - start;
+    }
+    if (rss && ru.ru_maxrss > *rss) {
+        *rss = ru.ru_maxrss;
+    }
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+static unsigned char *read_file(const char *name, size_t *size)
+{
+    struct stat st;
+    unsigned char *data;
+    FILE *f;
+
+    f = fopen(name, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    if (fstat(fileno(f), &st) < 0 || (data = malloc((size_t)st.st_size + 1)) == NULL) {
+        fclose(f);
+        return NULL;
+    }
+    *size = fread(data, 1, (size_t)st.st_size, f);
+    fclose(f);
+    return data;
+}
+
+static size_t file_size(const char *name)
+{
+    struct stat st;
+
+    return (stat(name, &st) < 0) ? 0 : (size_t)st.st_size;
+}
+
+/* xorshift, so that every run of the bench gets the same corpus */
+static uint32_t bench_random(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/* random data, with every fourth 8KiB block empty (0xff) in larger files so
+   that the types which leave out empty banks do so */
+static int write_binary(const char *name, unsigned int size, uint32_t seed)
+{
+    unsigned char *data;
+    unsigned int i;
+    FILE *f;
+    int result = 0;
+
+    data = malloc(size);
+    if (data == NULL) {
+        return -1;
+    }
+    seed = seed * 2654435761u + 1;
+    for (i = 0; i < size; i += 4) {
+        uint32_t r = bench_random(&seed);
+
+        memcpy(data + i, &r, (size - i < 4) ? size - i : 4);
+    }
+    if (size > 0x4000) {
+        for (i = 2 * BENCH_BLOCK; i + BENCH_BLOCK <= size; i += 4 * BENCH_BLOCK) {
+            memset(data + i, 0xff, BENCH_BLOCK);
+        }
+    }
+    f = fopen(name, "wb");
+    if (f == NULL || fwrite(data, 1, size, f) != size) {
+        result = -1;
+    }
+    if (f != NULL && fclose(f) != 0) {
+        result = -1;
+    }
+    if (result < 0) {
+        fprintf(stderr, "Error: can't write %s\n", name);
+    }
+    free(data);
+    return result;
+}
+
+static bench_file_t *add_file(const char *opt)
+{
+    bench_file_t *p;
+
+    p = realloc(files, (files_num + 1) * sizeof(bench_file_t));
+    if (p == NULL) {
+        return NULL;
+    }
+    files = p;
+    p = &files[files_num++];
+    memset(p, 0, sizeof(bench_file_t));
+    p->opt = opt;
+    return p;
+}
+
+static int generate_corpus(void)
+{
+    cartconv_type_t type;
+    bench_file_t *file;
+    char name[PATH_MAX];
+    unsigned int i, n;
+    int index;
+
+    if (chdir(corpus_dir) < 0) {
+        fprintf(stderr, "Error: can't enter %s\n", corpus_dir);
+        return -1;
+    }
+    for (index = 0; cartconv_get_type(index, &type) == 0; index++) {
+        types_num++;
+        if (type.insertion) {
+            continue;
+        }
+        for (i = 0; bench_sizes[i] != 0; i++) {
+            if ((bench_sizes[i] & type.sizes) != bench_sizes[i]) {
+                continue;
+            }
+            file = add_file(type.opt);
+            if (file == NULL) {
+                return -1;
+            }
+            snprintf(file->name, sizeof(file->name), "%s-%x", type.opt, bench_sizes[i]);
+            snprintf(name, sizeof(name), "%s.bin", file->name);
+            if (write_binary(name, bench_sizes[i], files_num) < 0) {
+                return -1;
+            }
+            file->bin_size = bench_sizes[i];
+        }
+    }
+
+    for (i = 0; bench_inserts[i].opt != NULL; i++) {
+        file = add_file(bench_inserts[i].opt);
+        if (file == NULL) {
+            return -1;
+        }
+        snprintf(file->name, sizeof(file->name), "%s-v%u", bench_inserts[i].opt, i);
+        snprintf(name, sizeof(name), "%s.bin", file->name);
+        if (write_binary(name, 0x2000, files_num) < 0) {
+            return -1;
+        }
+        file->bin_size = 0x2000;
+        for (n = 0; bench_inserts[i].sizes[n] != 0; n++) {
+            snprintf(name, sizeof(name), "%s-%u.bin", file->name, n);
+            if (write_binary(name, bench_inserts[i].sizes[n], files_num * 64 + n) < 0) {
+                return -1;
+            }
+            file->bin_size += bench_inserts[i].sizes[n];
+        }
+        file->inserts = n;
+    }
+    return 0;
+}
+
+/* one run of every phase over the whole corpus */
+static int run_phases(int first)
+{
+    char bin[48], crt[48], out[48], dir[48], crtpath[48];
+    char inserts[BENCH_MAX_INSERTS][48];
+    const char *args[BENCH_MAX_ARGS + 1];
+    double seconds[PHASE_NUM] = { 0.0, 0.0, 0.0 };
+    unsigned int i, n, a;
+    int result = 0;
+
+    for (i = 0; i < PHASE_NUM; i++) {
+        phases[i].files = files_num;
+        phases[i].bytes = 0.0;
+    }
+
+    for (i = 0; i < files_num; i++) {
+        bench_file_t *file = &files[i];
+
+        snprintf(bin, sizeof(bin), "%s.bin", file->name);
+        snprintf(crt, sizeof(crt), "%s.crt", file->name);
+        snprintf(out, sizeof(out), "%s.out.bin", file->name);
+        unlink(crt);
+        unlink(out);
+
+        a = 0;
+        args[a++] = "-q";
+        args[a++] = "-t";
+        args[a++] = file->opt;
+        args[a++] = "-i";
+        args[a++] = bin;
+        for (n = 0; n < file->inserts; n++) {
+            snprintf(inserts[n], sizeof(inserts[n]), "%s-%u.bin", file->name, n);
+            args[a++] = "-i";
+            args[a++] = inserts[n];
+        }
+        args[a++] = "-o";
+        args[a++] = crt;
+        args[a] = NULL;
+        if (run_cartconv(NULL, args, &seconds[PHASE_BIN2CRT], &phases[PHASE_BIN2CRT].peak_rss) < 0) {
+            fprintf(stderr, "Error: bin->crt of %s failed\n", file->name);
+            result = -1;
+            continue;
+        }
+        file->crt_size = file_size(crt);
+        phases[PHASE_BIN2CRT].bytes += (double)file->bin_size;
+
+        args[0] = "-q";
+        args[1] = "-i";
+        args[2] = crt;
+        args[3] = "-o";
+        args[4] = out;
+        args[5] = NULL;
+        if (run_cartconv(NULL, args, &seconds[PHASE_CRT2BIN], &phases[PHASE_CRT2BIN].peak_rss) < 0) {
+            fprintf(stderr, "Error: crt->bin of %s failed\n", file->name);
+            result = -1;
+        }
+        phases[PHASE_CRT2BIN].bytes += (double)file->crt_size;
+
+        snprintf(dir, sizeof(dir), "%s.f", file->name);
+        snprintf(crtpath, sizeof(crtpath), "../%s.crt", file->name);
+        if (first && mkdir(dir, 0755) < 0 && errno != EEXIST) {
+            fprintf(stderr, "Error: can't create %s\n", dir);
+            return -1;
+        }
+        args[0] = "-q";
+        args[1] = "-f";
+        args[2] = crtpath;
+        args[3] = NULL;
+        if (run_cartconv(dir, args, &seconds[PHASE_EXTRACT], &phases[PHASE_EXTRACT].peak_rss) < 0) {
+            fprintf(stderr, "Error: -f of %s failed\n", file->name);
+            result = -1;
+        }
+        phases[PHASE_EXTRACT].bytes += (double)file->crt_size;
+    }
+
+    for (i = 0; i < PHASE_NUM; i++) {
+        if (first || seconds[i] < phases[i].seconds) {
+            phases[i].seconds = seconds[i];
+        }
+    }
+    return result;
+}
+
+static void roundtrip_failed(const bench_file_t *file, const char *what)
+{
+    fprintf(stderr, "roundtrip: %s: %s\n", file->name, what);
+    failed++;
+}
+
+/* the offset where a and b differ, or -1 if they don't */
+static long compare_data(const unsigned char *a, size_t asize, const unsigned char *b, size_t bsize)
+{
+    size_t i;
+
+    for (i = 0; i < asize && i < bsize; i++) {
+        if (a[i] != b[i]) {
+            return (long)i;
+        }
+    }
+    return (asize == bsize) ? -1 : (long)i;
+}
+
+/* compare two files, a failure if they differ */
+static int check_files(const bench_file_t *file, const char *what, const char *aname, const char *bname)
+{
+    unsigned char *a, *b;
+    size_t asize = 0, bsize = 0;
+    char text[128];
+    long offset;
+
+    a = read_file(aname, &asize);
+    b = read_file(bname, &bsize);
+    if (a == NULL || b == NULL) {
+        snprintf(text, sizeof(text), "%s: %s is missing", what, a ? bname : aname);
+        roundtrip_failed(file, text);
+        offset = 0;
+    } else {
+        offset = compare_data(a, asize, b, bsize);
+        if (offset >= 0) {
+            snprintf(text, sizeof(text), "%s: differs at offset $%06lx (size $%lx and $%lx)",
+                     what, (unsigned long)offset, (unsigned long)asize, (unsigned long)bsize);
+            roundtrip_failed(file, text);
+        }
+    }
+    free(a);
+    free(b);
+    return (offset >= 0) ? -1 : 0;
+}
+
+/* cartconv [-t opt] -i in -o out, without timing */
+static void convert(const char *opt, const char *in, const char *out)
+{
+    const char *args[8];
+    int a = 0;
+
+    args[a++] = "-q";
+    if (opt != NULL) {
+        args[a++] = "-t";
+        args[a++] = opt;
+    }
+    args[a++] = "-i";
+    args[a++] = in;
+    args[a++] = "-o";
+    args[a++] = out;
+    args[a] = NULL;
+    unlink(out);
+    run_cartconv(NULL, args, NULL, NULL);
+}
+
+static const bench_placement_t *find_placement(const bench_file_t *file)
+{
+    const bench_placement_t *p;
+
+    for (p = bench_placements; p->opt != NULL; p++) {
+        if (!strcmp(p->opt, file->opt) && p->size == file->bin_size) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* the input at the offset of the placement, $ff around it */
+static int write_placed(const bench_placement_t *placement, const char *inname, const char *name)
+{
+    unsigned char *in, *out;
+    size_t size = 0;
+    FILE *f;
+    int result = -1;
+
+    in = read_file(inname, &size);
+    out = malloc(placement->out_size);
+    if (in != NULL && out != NULL) {
+        memset(out, 0xff, placement->out_size);
+        if (placement->offset < placement->out_size) {
+            if (size > placement->out_size - placement->offset) {
+                size = placement->out_size - placement->offset;
+            }
+            memcpy(out + placement->offset, in, size);
+        }
+        f = fopen(name, "wb");
+        if (f != NULL) {
+            result = (fwrite(out, 1, placement->out_size, f) == placement->out_size) ? 0 : -1;
+            if (fclose(f) != 0) {
+                result = -1;
+            }
+        }
+    }
+    free(in);
+    free(out);
+    return result;
+}
+
+/* the base file followed by the inserted files */
+static int write_expected(const bench_file_t *file, const char *name)
+{
+    char part[48];
+    unsigned char *data;
+    unsigned int n;
+    size_t size;
+    FILE *f;
+    int result = 0;
+
+    f = fopen(name, "wb");
+    if (f == NULL) {
+        return -1;
+    }
+    for (n = 0; n <= file->inserts && result == 0; n++) {
+        if (n == 0) {
+            snprintf(part, sizeof(part), "%s.bin", file->name);
+        } else {
+            snprintf(part, sizeof(part), "%s-%u.bin", file->name, n - 1);
+        }
+        data = read_file(part, &size);
+        if (data == NULL || fwrite(data, 1, size, f) != size) {
+            result = -1;
+        }
+        free(data);
+    }
+    if (fclose(f) != 0) {
+        result = -1;
+    }
+    return result;
+}
+
+/* the binary of the crt has to be the input, or for the Dela/Rex types the
+   base file followed by the inserted files. when the type stores another
+   size than it was given (padded or cut off) the binary has to hold the
+   input exactly where bench_placements says, and survive another round. the crt
+   rebuilt from the -f banks has to be the crt, or hold the same banks in
+   another order. */
+static void check_roundtrips(void)
+{
+    char bin[48], crt[48], out[48], name[48], name2[48];
+    char text[128];
+    const bench_placement_t *placement;
+    const char *args[6];
+
+    for (; checked < files_num; checked++) {
+        bench_file_t *file = &files[checked];
+
+        snprintf(bin, sizeof(bin), "%s.bin", file->name);
+        snprintf(crt, sizeof(crt), "%s.crt", file->name);
+        snprintf(out, sizeof(out), "%s.out.bin", file->name);
+
+        if (file->inserts > 0) {
+            snprintf(name, sizeof(name), "%s.all.bin", file->name);
+            if (write_expected(file, name) < 0) {
+                roundtrip_failed(file, "can't write the expected binary");
+            } else {
+                check_files(file, "bin->crt->bin", name, out);
+            }
+        } else if (file_size(out) != file->bin_size) {
+            resized++;
+            placement = find_placement(file);
+            if (placement == NULL) {
+                snprintf(text, sizeof(text), "bin->crt->bin: size $%lx, expected $%lx",
+                         (unsigned long)file_size(out), (unsigned long)file->bin_size);
+                roundtrip_failed(file, text);
+            } else {
+                snprintf(name, sizeof(name), "%s.placed.bin", file->name);
+                if (write_placed(placement, bin, name) < 0) {
+                    roundtrip_failed(file, "can't write the expected binary");
+                } else {
+                    check_files(file, "bin->crt->bin", name, out);
+                }
+            }
+            snprintf(name, sizeof(name), "%s.rt.crt", file->name);
+            snprintf(name2, sizeof(name2), "%s.rt.bin", file->name);
+            convert(file->opt, out, name);
+            convert(NULL, name, name2);
+            check_files(file, "crt->bin->crt->bin", out, name2);
+        } else {
+            check_files(file, "bin->crt->bin", bin, out);
+        }
+
+        snprintf(name, sizeof(name), "%s.f", file->name);
+        snprintf(name2, sizeof(name2), "%s.join.crt", file->name);
+        args[0] = "-q";
+        args[1] = "--join";
+        args[2] = name;
+        args[3] = "-o";
+        args[4] = name2;
+        args[5] = NULL;
+        unlink(name2);
+        run_cartconv(NULL, args, NULL, NULL);
+        if (file_size(name2) == file->crt_size) {
+            unsigned char *a, *b;
+            size_t asize = 0, bsize = 0;
+
+            a = read_file(crt, &asize);
+            b = read_file(name2, &bsize);
+            if (a != NULL && b != NULL && compare_data(a, asize, b, bsize) < 0) {
+                free(a);
+                free(b);
+                continue;
+            }
+            free(a);
+            free(b);
+        }
+        /* -f names the bank files by bank, --join puts them back in that
+           order */
+        snprintf(name, sizeof(name), "%s.join.bin", file->name);
+        convert(NULL, name2, name);
+        if (check_files(file, "-f/--join", out, name) == 0) {
+            reordered++;
+        }
+    }
+}
+
+static double mb_per_s(const bench_phase_t *p)
+{
+    return (p->seconds > 0.0) ? p->bytes / p->seconds / 1e6 : 0.0;
+}
+
+static double files_per_s(const bench_phase_t *p)
+{
+    return (p->seconds > 0.0) ? p->files / p->seconds : 0.0;
+}
+
+static int write_json(FILE *f, int runs)
+{
+    double corpus = 0.0;
+    unsigned int i;
+
+    for (i = 0; i < files_num; i++) {
+        corpus += (double)files[i].bin_size;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"cartconv\": \"%s\",\n", cartconv_path);
+    fprintf(f, "  \"runs\": %d,\n", runs);
+    fprintf(f, "  \"types\": %u,\n", types_num);
+    fprintf(f, "  \"files\": %u,\n", files_num);
+    fprintf(f, "  \"corpus_bytes\": %.0f,\n", corpus);
+    fprintf(f, "  \"phases\": [\n");
+    for (i = 0; i < PHASE_NUM; i++) {
+        fprintf(f, "    {\"phase\": \"%s\", \"files\": %u, \"bytes\": %.0f, \"seconds\": %.6f, "
+                "\"mb_per_s\": %.3f, \"files_per_s\": %.3f, \"peak_rss_kb\": %ld}%s\n",
+                phases[i].name, phases[i].files, phases[i].bytes, phases[i].seconds,
+                mb_per_s(&phases[i]), files_per_s(&phases[i]), phases[i].peak_rss,
+                (i + 1 < PHASE_NUM) ? "," : "");
+    }
+    fprintf(f, "  ],\n");
+    fprintf(f, "  \"roundtrip\": {\"checked\": %u, \"resized\": %u, \"reordered\": %u, \"failed\": %u}\n",
+            checked, resized, reordered, failed);
+    fprintf(f, "}\n");
+    return ferror(f) ? -1 : 0;
+}
+
+/* print the old and new numbers of every phase, 1 if one got worse by more
+   than percent */
+static int compare_json(FILE *f, double percent)
+{
+    char line[512], phase[16];
+    bench_phase_t old;
+    double old_mb, old_fps;
+    unsigned int i;
+    int result = 0;
+    char *p;
+
+    fprintf(stderr, "\nphase      old MB/s   new MB/s  change   old RSS  new RSS\n");
+    while (fgets(line, sizeof(line), f)) {
+        p = strstr(line, "{\"phase\"");
+        if (p == NULL || sscanf(p, "{\"phase\": \"%15[^\"]\", \"files\": %u, \"bytes\": %lf, \"seconds\": %lf, "
+                                "\"mb_per_s\": %lf, \"files_per_s\": %lf, \"peak_rss_kb\": %ld}",
+                                phase, &old.files, &old.bytes, &old.seconds,
+                                &old_mb, &old_fps, &old.peak_rss) != 7) {
+            continue;
+        }
+        for (i = 0; i < PHASE_NUM; i++) {
+            double change;
+
+            if (strcmp(phases[i].name, phase) != 0) {
+                continue;
+            }
+            change = (old_mb > 0.0) ? (mb_per_s(&phases[i]) / old_mb - 1.0) * 100.0 : 0.0;
+            fprintf(stderr, "%-8s %10.1f %10.1f %+6.1f%% %8ld %8ld", phase, old_mb,
+                    mb_per_s(&phases[i]), change, old.peak_rss, phases[i].peak_rss);
+            if (old.files != phases[i].files) {
+                fprintf(stderr, "  (%u files before)", old.files);
+            }
+            if (change < -percent
+                || (double)phases[i].peak_rss > (double)old.peak_rss * (1.0 + percent / 100.0)) {
+                fprintf(stderr, "  REGRESSION");
+                result = 1;
+            }
+            fprintf(stderr, "\n");
+        }
+    }
+    return result;
+}
+
+static int remove_entry(const char *name, const struct stat *st, int flag, struct FTW *ftw)
+{
+    return remove(name);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *cartconv_name = "./cartconv";
+    const char *json_name = NULL;
+    FILE *old = NULL;
+    const char *dir_name = NULL;
+    double percent = 10.0;
+    int runs = 3;
+    int result = 0;
+    int i;
+    FILE *f;
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == 0 || argv[i][2] != 0 || i + 1 >= argc) {
+            usage();
+        }
+        switch (argv[i][1]) {
+            case 'c':
+                cartconv_name = argv[++i];
+                break;
+            case 'd':
+                dir_name = argv[++i];
+                break;
+            case 'n':
+                runs = atoi(argv[++i]);
+                break;
+            case 'o':
+                json_name = argv[++i];
+                break;
+            case 'b':
+                old = fopen(argv[++i], "r");
+                if (old == NULL) {
+                    fprintf(stderr, "Error: can't open %s\n", argv[i]);
+                    return 1;
+                }
+                break;
+            case 't':
+                percent = atof(argv[++i]);
+                break;
+            default:
+                usage();
+        }
+    }
+    if (runs < 1) {
+        usage();
+    }
+
+    if (realpath(cartconv_name, cartconv_path) == NULL || access(cartconv_path, X_OK) < 0) {
+        fprintf(stderr, "Error: can't run %s\n", cartconv_name);
+        return 1;
+    }
+    if (dir_name != NULL) {
+        if ((mkdir(dir_name, 0755) < 0 && errno != EEXIST) || realpath(dir_name, corpus_dir) == NULL) {
+            fprintf(stderr, "Error: can't create %s\n", dir_name);
+            return 1;
+        }
+    } else {
+        snprintf(corpus_dir, sizeof(corpus_dir), "%s/cartbench.XXXXXX",
+                 getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp");
+        if (mkdtemp(corpus_dir) == NULL) {
+            fprintf(stderr, "Error: can't create %s\n", corpus_dir);
+            return 1;
+        }
+    }
+    f = stdout;
+    if (json_name != NULL) {
+        f = fopen(json_name, "w");
+        if (f == NULL) {
+            fprintf(stderr, "Error: can't open %s\n", json_name);
+            return 1;
+        }
+    }
+
+    if (generate_corpus() < 0) {
+        result = 1;
+        goto done;
+    }
+    fprintf(stderr, "corpus: %u files of %u types in %s\n", files_num, types_num, corpus_dir);
+
+    for (i = 0; i < runs; i++) {
+        if (run_phases(i == 0) < 0) {
+            result = 1;
+        }
+    }
+    check_roundtrips();
+    if (failed) {
+        result = 1;
+    }
+
+    for (i = 0; i < PHASE_NUM; i++) {
+        fprintf(stderr, "%-8s %4u files %9.1f MB/s %9.1f files/s  peak RSS %ld KiB\n",
+                phases[i].name, phases[i].files, mb_per_s(&phases[i]),
+                files_per_s(&phases[i]), phases[i].peak_rss);
+    }
+    fprintf(stderr, "roundtrip: %u checked, %u resized by the type, %u reordered by --join, %u failed\n",
+            checked, resized, reordered, failed);
+
+    if (write_json(f, runs) < 0) {
+        fprintf(stderr, "Error: can't write the results\n");
+        result = 1;
+    }
+    if (old != NULL && compare_json(old, percent) && result == 0) {
+        result = 2;
+    }
+
+done:
+    if (f != stdout) {
+        fclose(f);
+    }
+    if (old != NULL) {
+        fclose(old);
+    }
+    if (dir_name == NULL) {
+        nftw(corpus_dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    free(files);
+    return result;
+}
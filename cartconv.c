@@ -0,0 +1,6675 @@
+/** \file   cartconv.c
+ * \brief   Cartridge Conversion library
+ *
+ * \author  Marco van den heuvel <blackystardust68@yahoo.com>
+ * \author  groepaz <groepaz@gmx.net>
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+//#include "vice.h"
+
+/* a library must not bring its own strdup/strncasecmp, the system has them */
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_STRDUP
+#define HAVE_STRNCASECMP
+#endif
+
+#ifdef __linux__
+#define _GNU_SOURCE     /* copy_file_range */
+#endif
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <strings.h>
+
+#include <unistd.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "cartconv.h"
+#include "hash.h"
+#include "romdb.h"
+
+//#include "cartridge.h"
+
+/* the sizes are bits, except 12KiB, 20KiB, 24KiB and 96KiB that are two of
+   them. a type accepts every size that has all its bits in cart_t sizes, see
+   cart_pad_size() */
+#define CARTRIDGE_SIZE_2KB     0x00000800
+#define CARTRIDGE_SIZE_4KB     0x00001000
+#define CARTRIDGE_SIZE_8KB     0x00002000
+#define CARTRIDGE_SIZE_12KB    0x00003000
+#define CARTRIDGE_SIZE_16KB    0x00004000
+#define CARTRIDGE_SIZE_20KB    0x00005000
+#define CARTRIDGE_SIZE_24KB    0x00006000
+#define CARTRIDGE_SIZE_32KB    0x00008000
+#define CARTRIDGE_SIZE_64KB    0x00010000
+#define CARTRIDGE_SIZE_96KB    0x00018000
+#define CARTRIDGE_SIZE_128KB   0x00020000
+#define CARTRIDGE_SIZE_256KB   0x00040000
+#define CARTRIDGE_SIZE_512KB   0x00080000
+#define CARTRIDGE_SIZE_1024KB  0x00100000
+#define CARTRIDGE_SIZE_2048KB  0x00200000
+#define CARTRIDGE_SIZE_4096KB  0x00400000
+#define CARTRIDGE_SIZE_8192KB  0x00800000
+#define CARTRIDGE_SIZE_16384KB 0x01000000
+#define CARTRIDGE_SIZE_MAX     CARTRIDGE_SIZE_16384KB
+
+
+/* Carts that don't have a rom image */
+#define CARTRIDGE_DIGIMAX            -100 /* digimax.c */
+#define CARTRIDGE_DQBB               -101 /* dqbb.c */
+#define CARTRIDGE_GEORAM             -102 /* georam.c */
+#define CARTRIDGE_ISEPIC             -103 /* isepic.c */
+#define CARTRIDGE_RAMCART            -104 /* ramcart.c */
+#define CARTRIDGE_REU                -105 /* reu.c */
+#define CARTRIDGE_SFX_SOUND_EXPANDER -106 /* sfx_soundexpander.c, fmopl.c */
+#define CARTRIDGE_SFX_SOUND_SAMPLER  -107 /* sfx_soundsampler.c */
+#define CARTRIDGE_MIDI_PASSPORT      -108 /* c64-midi.c */
+#define CARTRIDGE_MIDI_DATEL         -109 /* c64-midi.c */
+#define CARTRIDGE_MIDI_SEQUENTIAL    -110 /* c64-midi.c */
+#define CARTRIDGE_MIDI_NAMESOFT      -111 /* c64-midi.c */
+#define CARTRIDGE_MIDI_MAPLIN        -112 /* c64-midi.c */
+#define CARTRIDGE_DS12C887RTC        -113 /* ds12c887rtc.c */
+#define CARTRIDGE_TFE                -116 /* ethernetcart.c */
+#define CARTRIDGE_TURBO232           -117 /* c64acia1.c */
+#define CARTRIDGE_SWIFTLINK          -118 /* c64acia1.c */
+#define CARTRIDGE_ACIA               -119 /* c64acia1.c */
+#define CARTRIDGE_PLUS60K            -120 /* plus60k.c */
+#define CARTRIDGE_PLUS256K           -121 /* plus256k.c */
+#define CARTRIDGE_C64_256K           -122 /* c64_256k.c */
+#define CARTRIDGE_CPM                -123 /* cpmcart.c */
+#define CARTRIDGE_DEBUGCART          -124 /* debugcart.c */
+
+/* Known cartridge types.  */
+/* TODO: cartconv (4k and 12k binaries) */
+#define CARTRIDGE_ULTIMAX              -6 /* generic.c */
+#define CARTRIDGE_GENERIC_8KB          -3 /* generic.c */
+#define CARTRIDGE_GENERIC_16KB         -2 /* generic.c */
+
+#define CARTRIDGE_NONE                 -1
+#define CARTRIDGE_CRT                   0
+
+/* the following must match the CRT IDs */
+#define CARTRIDGE_ACTION_REPLAY         1 /* actionreplay.c */
+#define CARTRIDGE_KCS_POWER             2 /* kcs.c */
+#define CARTRIDGE_FINAL_III             3 /* final3.c */
+#define CARTRIDGE_SIMONS_BASIC          4 /* simonsbasic.c */
+#define CARTRIDGE_OCEAN                 5 /* ocean.c */
+#define CARTRIDGE_EXPERT                6 /* expert.c */
+#define CARTRIDGE_FUNPLAY               7 /* funplay.c */
+#define CARTRIDGE_SUPER_GAMES           8 /* supergames.c */
+#define CARTRIDGE_ATOMIC_POWER          9 /* atomicpower.c */
+#define CARTRIDGE_EPYX_FASTLOAD        10 /* epyxfastload.c */
+#define CARTRIDGE_WESTERMANN           11 /* westermann.c */
+#define CARTRIDGE_REX                  12 /* rexutility.c */
+#define CARTRIDGE_FINAL_I              13 /* final.c */
+#define CARTRIDGE_MAGIC_FORMEL         14 /* magicformel.c */
+#define CARTRIDGE_GS                   15 /* gs.c */
+#define CARTRIDGE_WARPSPEED            16 /* warpspeed.c */
+#define CARTRIDGE_DINAMIC              17 /* dinamic.c */
+#define CARTRIDGE_ZAXXON               18 /* zaxxon.c */
+#define CARTRIDGE_MAGIC_DESK           19 /* magicdesk.c */
+#define CARTRIDGE_SUPER_SNAPSHOT_V5    20 /* supersnapshot.c */
+#define CARTRIDGE_COMAL80              21 /* comal80.c */
+#define CARTRIDGE_STRUCTURED_BASIC     22 /* stb.c */
+#define CARTRIDGE_ROSS                 23 /* ross.c */
+#define CARTRIDGE_DELA_EP64            24 /* delaep64.c */
+#define CARTRIDGE_DELA_EP7x8           25 /* delaep7x8.c */
+#define CARTRIDGE_DELA_EP256           26 /* delaep256.c */
+
+/* TODO: cartconv */
+#define CARTRIDGE_REX_EP256            27 /* rexep256.c */
+
+#define CARTRIDGE_MIKRO_ASSEMBLER      28 /* mikroass.c */
+
+/* TODO: cartconv (24k binary) */
+#define CARTRIDGE_FINAL_PLUS           29 /* finalplus.c */
+
+#define CARTRIDGE_ACTION_REPLAY4       30 /* actionreplay4.c */
+#define CARTRIDGE_STARDOS              31 /* stardos.c */
+#define CARTRIDGE_EASYFLASH            32 /* easyflash.c */
+
+/* TODO: cartconv (no cart exists?) */
+#define CARTRIDGE_EASYFLASH_XBANK      33 /* easyflash.c */
+
+#define CARTRIDGE_CAPTURE              34 /* capture.c */
+#define CARTRIDGE_ACTION_REPLAY3       35 /* actionreplay3.c */
+#define CARTRIDGE_RETRO_REPLAY         36 /* retroreplay.c */
+#define CARTRIDGE_MMC64                37 /* mmc64.c, spi-sdcard.c */
+#define CARTRIDGE_MMC_REPLAY           38 /* mmcreplay.c, ser-eeprom.c, spi-sdcard.c */
+#define CARTRIDGE_IDE64                39 /* ide64.c */
+#define CARTRIDGE_SUPER_SNAPSHOT       40 /* supersnapshot4.c */
+#define CARTRIDGE_IEEE488              41 /* c64tpi.c */
+#define CARTRIDGE_GAME_KILLER          42 /* gamekiller.c */
+#define CARTRIDGE_P64                  43 /* prophet64.c */
+#define CARTRIDGE_EXOS                 44 /* exos.c */
+#define CARTRIDGE_FREEZE_FRAME         45 /* freezeframe.c */
+#define CARTRIDGE_FREEZE_MACHINE       46 /* freezemachine.c */
+#define CARTRIDGE_SNAPSHOT64           47 /* snapshot64.c */
+#define CARTRIDGE_SUPER_EXPLODE_V5     48 /* superexplode5.c */
+#define CARTRIDGE_MAGIC_VOICE          49 /* magicvoice.c, tpicore.c, t6721.c */
+#define CARTRIDGE_ACTION_REPLAY2       50 /* actionreplay2.c */
+#define CARTRIDGE_MACH5                51 /* mach5.c */
+#define CARTRIDGE_DIASHOW_MAKER        52 /* diashowmaker.c */
+#define CARTRIDGE_PAGEFOX              53 /* pagefox.c */
+#define CARTRIDGE_KINGSOFT             54 /* kingsoft.c */
+#define CARTRIDGE_SILVERROCK_128       55 /* silverrock128.c */
+#define CARTRIDGE_FORMEL64             56 /* formel64.c */
+#define CARTRIDGE_RGCD                 57 /* rgcd.c */
+#define CARTRIDGE_RRNETMK3             58 /* rrnetmk3.c */
+#define CARTRIDGE_EASYCALC             59 /* easycalc.c */
+#define CARTRIDGE_GMOD2                60 /* gmod2.c */
+#define CARTRIDGE_MAX_BASIC            61 /* maxbasic.c */
+#define CARTRIDGE_GMOD3                62 /* gmod3.c */
+#define CARTRIDGE_ZIPPCODE48           63 /* zippcode48.c */
+#define CARTRIDGE_BLACKBOX8            64 /* blackbox8.c */
+#define CARTRIDGE_BLACKBOX3            65 /* blackbox3.c */
+#define CARTRIDGE_BLACKBOX4            66 /* blackbox4.c */
+#define CARTRIDGE_REX_RAMFLOPPY        67 /* rexramfloppy.c */
+#define CARTRIDGE_BISPLUS              68 /* bisplus.c */
+#define CARTRIDGE_SDBOX                69 /* sdbox.c */
+#define CARTRIDGE_MULTIMAX             70 /* multimax.c */
+#define CARTRIDGE_BLACKBOX9            71 /* blackbox9.c */
+#define CARTRIDGE_LT_KERNAL            72 /* ltkernal.c */
+#define CARTRIDGE_RAMLINK              73 /* ramlink.c */
+#define CARTRIDGE_HERO                 74 /* hero.c */
+
+#define CARTRIDGE_LAST                 74 /* cartconv: last cartridge in list */
+
+
+
+
+/* list of canonical names for the c64 cartridges:
+   note: often it is hard to determine "the" official name, let alone the way it
+   should be capitalized. because of that we go by the following rules:
+   - if even the actual spelling and/or naming is unclear, then the most "common"
+     variant is choosen ("Expert Cartridge" vs "The Expert")
+   - in many cases the name is printed all uppercase both on screen and in other
+     sources (manual, adverts). we refrain from doing the same here and convert
+     to Camel Case ("ACTION REPLAY V5" -> "Action Replay V5"), *except* if the
+     cart name constitutes an actual name (as in noun) by itself ("ISEPIC", "EXOS").
+     additionally common abrevations such as RAM or EPROM will get written uppercase
+     if in doubt.
+   - although generally these cartridge names should never get translated, some
+     generic stuff is translated to english ("EPROM Karte" -> "EPROM Cart")
+*/
+#define CARTRIDGE_NAME_ACIA               "ACIA"
+#define CARTRIDGE_NAME_ACTION_REPLAY      "Action Replay V5" /* http://rr.pokefinder.org/wiki/Action_Replay */
+#define CARTRIDGE_NAME_ACTION_REPLAY2     "Action Replay MK2" /* http://rr.pokefinder.org/wiki/Action_Replay */
+#define CARTRIDGE_NAME_ACTION_REPLAY3     "Action Replay MK3" /* http://rr.pokefinder.org/wiki/Action_Replay */
+#define CARTRIDGE_NAME_ACTION_REPLAY4     "Action Replay MK4" /* http://rr.pokefinder.org/wiki/Action_Replay */
+#define CARTRIDGE_NAME_ATOMIC_POWER       "Atomic Power" /* also: "Nordic Power" */ /* http://rr.pokefinder.org/wiki/Nordic_Power */
+#define CARTRIDGE_NAME_BISPLUS            "BIS-Plus"
+#define CARTRIDGE_NAME_BLACKBOX3          "Blackbox V3"
+#define CARTRIDGE_NAME_BLACKBOX4          "Blackbox V4"
+#define CARTRIDGE_NAME_BLACKBOX8          "Blackbox V8"
+#define CARTRIDGE_NAME_BLACKBOX9          "Blackbox V9"
+#define CARTRIDGE_NAME_GS                 "C64 Games System" /* http://retro.lonningdal.net/home.php?page=Computers&select=c64gs&image=c64gs4.jpg */
+#define CARTRIDGE_NAME_CAPTURE            "Capture" /* see manual http://rr.pokefinder.org/wiki/Capture */
+#define CARTRIDGE_NAME_COMAL80            "Comal 80" /* http://www.retroport.de/C64_C128_Hardware.html */
+#define CARTRIDGE_NAME_CPM                "CP/M cartridge"
+#define CARTRIDGE_NAME_MIDI_DATEL         "Datel MIDI"
+#define CARTRIDGE_NAME_DEBUGCART          "Debug Cartridge"
+#define CARTRIDGE_NAME_DELA_EP64          "Dela EP64"
+#define CARTRIDGE_NAME_DELA_EP7x8         "Dela EP7x8"
+#define CARTRIDGE_NAME_DELA_EP256         "Dela EP256"
+#define CARTRIDGE_NAME_DIASHOW_MAKER      "Diashow-Maker" /* http://www.retroport.de/Rex.html */
+#define CARTRIDGE_NAME_DIGIMAX            "DigiMAX" /* http://starbase.globalpc.net/~ezekowitz/vanessa/hobbies/projects.html */
+#define CARTRIDGE_NAME_DINAMIC            "Dinamic"
+#define CARTRIDGE_NAME_DQBB               "Double Quick Brown Box" /* on the cart itself its all uppercase ? */
+#define CARTRIDGE_NAME_DS12C887RTC        "DS12C887 Real Time Clock" /* Title of the page at http://ytm.bossstation.dnsalias.org/html/rtcds12c887.html */
+#define CARTRIDGE_NAME_EASYCALC           "Easy Calc Result" /* on the cart itself it's "Calc Result EASY", in the manual it's EASYCALC, but we'll go with what is defined ;) */
+#define CARTRIDGE_NAME_EASYFLASH          "EasyFlash" /* see http://skoe.de/easyflash/ */
+#define CARTRIDGE_NAME_EASYFLASH_XBANK    "EasyFlash Xbank" /* see http://skoe.de/easyflash/ */
+#define CARTRIDGE_NAME_EPYX_FASTLOAD      "Epyx FastLoad" /* http://rr.pokefinder.org/wiki/Epyx_FastLoad */
+#define CARTRIDGE_NAME_ETHERNETCART       "Ethernet cartridge"
+#define CARTRIDGE_NAME_EXOS               "EXOS" /* http://rr.pokefinder.org/wiki/ExOS */
+#define CARTRIDGE_NAME_EXPERT             "Expert Cartridge" /* http://rr.pokefinder.org/wiki/Expert_Cartridge */
+#define CARTRIDGE_NAME_FINAL_I            "The Final Cartridge" /* http://rr.pokefinder.org/wiki/Final_Cartridge */
+#define CARTRIDGE_NAME_FINAL_III          "The Final Cartridge III" /* http://rr.pokefinder.org/wiki/Final_Cartridge */
+#define CARTRIDGE_NAME_FINAL_PLUS         "Final Cartridge Plus" /* http://rr.pokefinder.org/wiki/Final_Cartridge */
+#define CARTRIDGE_NAME_TFE                "The Final Ethernet"
+#define CARTRIDGE_NAME_FORMEL64           "Formel 64"
+#define CARTRIDGE_NAME_FREEZE_FRAME       "Freeze Frame" /* http://rr.pokefinder.org/wiki/Freeze_Frame */
+#define CARTRIDGE_NAME_FREEZE_MACHINE     "Freeze Machine" /* http://rr.pokefinder.org/wiki/Freeze_Frame */
+#define CARTRIDGE_NAME_FUNPLAY            "Fun Play" /* also: "Power Play" */ /* http://home.nomansland.biz/~zerqent/commodore_salg/CIMG2132.JPG */
+#define CARTRIDGE_NAME_GAME_KILLER        "Game Killer" /* http://rr.pokefinder.org/wiki/Game_Killer */
+#define CARTRIDGE_NAME_GEORAM             "GEO-RAM" /* http://www.retroport.de/Rex.html */
+#define CARTRIDGE_NAME_GMOD2              "GMod2" /* http://wiki.icomp.de/wiki/GMod2 */
+#define CARTRIDGE_NAME_GMOD3              "GMod3" /* http://wiki.icomp.de/wiki/GMod3 */
+#define CARTRIDGE_NAME_HERO               "H.E.R.O. (Drean)"
+#define CARTRIDGE_NAME_IDE64              "IDE64" /* see http://www.ide64.org/ */
+#define CARTRIDGE_NAME_IEEE488            "IEEE-488 Interface"
+#define CARTRIDGE_NAME_ISEPIC             "ISEPIC" /* http://rr.pokefinder.org/wiki/Isepic */
+#define CARTRIDGE_NAME_KCS_POWER          "KCS Power Cartridge" /* http://rr.pokefinder.org/wiki/Power_Cartridge */
+#define CARTRIDGE_NAME_KINGSOFT           "Kingsoft"
+#define CARTRIDGE_NAME_LT_KERNAL          "Lt. Kernal Host Adaptor"
+#define CARTRIDGE_NAME_MACH5              "MACH 5" /* http://rr.pokefinder.org/wiki/MACH_5 */
+#define CARTRIDGE_NAME_MAGIC_DESK         "Magic Desk" /* also: "Domark, Hes Australia" */
+#define CARTRIDGE_NAME_MAGIC_FORMEL       "Magic Formel" /* http://rr.pokefinder.org/wiki/Magic_Formel */
+#define CARTRIDGE_NAME_MAGIC_VOICE        "Magic Voice" /* all lowercase on cart ? */
+#define CARTRIDGE_NAME_MAX_BASIC          "MAX Basic"
+#define CARTRIDGE_NAME_MIDI_MAPLIN        "Maplin MIDI"
+#define CARTRIDGE_NAME_MIKRO_ASSEMBLER    "Mikro Assembler"
+#define CARTRIDGE_NAME_MMC64              "MMC64" /* see manual */
+#define CARTRIDGE_NAME_MMC_REPLAY         "MMC Replay" /* see manual */
+#define CARTRIDGE_NAME_MIDI_NAMESOFT      "Namesoft MIDI"
+#define CARTRIDGE_NAME_MIDI_PASSPORT      "Passport MIDI"
+#define CARTRIDGE_NAME_MIDI_SEQUENTIAL    "Sequential MIDI"
+#define CARTRIDGE_NAME_MULTIMAX           "MultiMAX" /* http://www.multimax.co/ */
+#define CARTRIDGE_NAME_NORDIC_REPLAY      "Nordic Replay" /* "Retro Replay v2" see manual */
+#define CARTRIDGE_NAME_OCEAN              "Ocean"
+#define CARTRIDGE_NAME_PAGEFOX            "Pagefox"
+#define CARTRIDGE_NAME_P64                "Prophet64" /* see http://www.prophet64.com/ */
+#define CARTRIDGE_NAME_RAMCART            "RamCart" /* see cc65 driver */
+#define CARTRIDGE_NAME_RAMLINK            "RAMLink"
+#define CARTRIDGE_NAME_REU                "RAM Expansion Module" /* http://www.retroport.de/C64_C128_Hardware.html */
+#define CARTRIDGE_NAME_REX_EP256          "REX 256K EPROM Cart" /* http://www.retroport.de/Rex.html */
+#define CARTRIDGE_NAME_REX                "REX Utility"
+#define CARTRIDGE_NAME_REX_RAMFLOPPY      "REX RAM-Floppy"
+#define CARTRIDGE_NAME_RGCD               "RGCD"
+#define CARTRIDGE_NAME_RRNET              "RR-Net" /* see manual */
+#define CARTRIDGE_NAME_RRNETMK3           "RR-Net MK3" /* see manual */
+#define CARTRIDGE_NAME_RETRO_REPLAY       "Retro Replay" /* see manual */
+#define CARTRIDGE_NAME_ROSS               "ROSS"
+#define CARTRIDGE_NAME_SDBOX              "SD-BOX" /* http://c64.com.pl/index.php/sdbox106.html */
+#define CARTRIDGE_NAME_SFX_SOUND_EXPANDER "SFX Sound Expander" /* http://www.floodgap.com/retrobits/ckb/secret/cbm-sfx-fmbport.jpg */
+#define CARTRIDGE_NAME_SFX_SOUND_SAMPLER  "SFX Sound Sampler" /* http://www.floodgap.com/retrobits/ckb/secret/cbm-ssm-box.jpg */
+#define CARTRIDGE_NAME_SILVERROCK_128     "Silverrock 128KiB Cartridge"
+#define CARTRIDGE_NAME_SIMONS_BASIC       "Simons' BASIC" /* http://en.wikipedia.org/wiki/Simons'_BASIC */
+#define CARTRIDGE_NAME_SNAPSHOT64         "Snapshot 64" /* http://rr.pokefinder.org/wiki/Super_Snapshot */
+#define CARTRIDGE_NAME_STARDOS            "Stardos" /* see manual http://rr.pokefinder.org/wiki/StarDOS */
+#define CARTRIDGE_NAME_STRUCTURED_BASIC   "Structured BASIC"
+#define CARTRIDGE_NAME_SUPER_EXPLODE_V5   "Super Explode V5.0" /* http://rr.pokefinder.org/wiki/Super_Explode */
+#define CARTRIDGE_NAME_SUPER_GAMES        "Super Games"
+#define CARTRIDGE_NAME_SUPER_SNAPSHOT     "Super Snapshot V4" /* http://rr.pokefinder.org/wiki/Super_Snapshot */
+#define CARTRIDGE_NAME_SUPER_SNAPSHOT_V5  "Super Snapshot V5" /* http://rr.pokefinder.org/wiki/Super_Snapshot */
+#define CARTRIDGE_NAME_SWIFTLINK          "Swiftlink" /* http://mikenaberezny.com/hardware/peripherals/swiftlink-rs232-interface/ */
+#define CARTRIDGE_NAME_TURBO232           "Turbo232" /* also: "ACIA/SWIFTLINK" */ /*http://www.retroport.de/C64_C128_Hardware2.html */
+#define CARTRIDGE_NAME_WARPSPEED          "Warp Speed" /* see manual http://rr.pokefinder.org/wiki/WarpSpeed */
+#define CARTRIDGE_NAME_WESTERMANN         "Westermann Learning"
+#define CARTRIDGE_NAME_ZAXXON             "Zaxxon"
+#define CARTRIDGE_NAME_ZIPPCODE48         "ZIPP-CODE 48"
+
+#define CARTRIDGE_NAME_GENERIC_8KB        "generic 8KiB game"
+#define CARTRIDGE_NAME_GENERIC_16KB       "generic 16KiB game"
+#define CARTRIDGE_NAME_ULTIMAX            "generic Ultimax"
+
+
+
+
+/* an input file mapped into memory */
+typedef struct mapped_file_s {
+    int fd;
+    unsigned char *data;
+    size_t size;
+    int is_mapped;      /* 0 if the file had to be read into a malloc'ed buffer, 2 for memory of the caller */
+} mapped_file_t;
+
+/* a CHIP packet of a .crt file, decoded in place */
+typedef struct crt_chip_s {
+    unsigned long offset;           /* file offset of the CHIP packet */
+    unsigned long length;           /* total packet length, including the CHIP header */
+    unsigned int type;
+    unsigned int bank;
+    unsigned int start;
+    unsigned int size;              /* size of the ROM data */
+    unsigned int avail;             /* amount of ROM data actually present in the file */
+    unsigned int key;               /* position of the bank in the binary, for sorting */
+    unsigned int binpos;            /* offset of the ROM data in the binary */
+    const unsigned char *header;    /* points to the CHIP header in the mapped file */
+    const unsigned char *data;      /* points to the ROM data in the mapped file */
+} crt_chip_t;
+
+
+/* an operation of the edit mode */
+typedef struct edit_op_s {
+    int kind;
+    char *arg;              /* bank:addr=file or field=value */
+    mapped_file_t m;        /* the bank file */
+    unsigned long offset;   /* where the data goes */
+    const unsigned char *data;
+    unsigned int size;
+    unsigned char buf[0x20];    /* CHIP header of appended banks, patched header bytes */
+} edit_op_t;
+
+/* a chip of the .crt that is being written. the data is only referenced,
+   the parts are written out in one go by flush_crt_output() */
+typedef struct crt_part_s {
+    unsigned char header[0x10];
+    const unsigned char *data;
+    unsigned int avail;             /* bytes of data, the rest of the chip is $ff */
+    unsigned int size;
+} crt_part_t;
+
+/* a chip planned by save_layout_crt(), offset is in the binary */
+typedef struct layout_chip_s {
+    unsigned int offset;
+    unsigned int size;
+    unsigned int bank;
+    unsigned int address;
+} layout_chip_t;
+
+/* the .crt output: the header and chips are collected and written with
+   writev() into a temporary file, that is renamed to the output name when
+   it is complete */
+typedef struct crt_output_s {
+    int open;
+    int failed;                     /* a flush in between failed */
+    int fd;                         /* -1 when writing to cc->outstream */
+    char *tmpname;
+    char *target;                   /* the file a symlinked output points to */
+    int remove;                     /* the output is removed if it fails, not for devices */
+    unsigned char header[0x40];
+    int header_pending;
+    crt_part_t *parts;
+    unsigned int parts_num;
+    unsigned int parts_max;
+    struct iovec *iov;
+    unsigned int iov_max;
+    unsigned char *fill;            /* CRT_FILL_SIZE bytes of $ff */
+} crt_output_t;
+
+#define CRT_FILL_SIZE 0x8000
+
+/* the state of one conversion, see cartconv.h */
+struct cartconv_s {
+    FILE *out;                      /* messages */
+    FILE *err;                      /* errors and warnings */
+    char error[256];                /* the last error message */
+    FILE *outfile;
+    FILE *outstream;                /* memory stream of cartconv_convert_buffer() */
+    int outfd;                      /* what the output name "-" refers to */
+    int load_address;
+    int loadfile_offset;
+    unsigned int loadfile_size;
+    char *output_filename;
+    char *input_filename[33];
+    char *cart_name;
+    signed char cart_type;
+    unsigned char cart_subtype;
+    char convert_to_bin;
+    char convert_to_prg;
+    char convert_to_ultimax;
+    unsigned char input_filenames;
+    char loadfile_is_crt;
+    char loadfile_is_ultimax;
+    int loadfile_cart_type;
+    int loaded;                     /* an input file has been parsed */
+    unsigned char *filebuffer;      /* grown to what the loaded cart needs */
+    unsigned int filebuffer_size;
+    const unsigned char *loaddata;
+    unsigned int loaddata_end;      /* loaddata is 0xff from here on, without being stored */
+    unsigned char headerbuffer[0x40];
+    unsigned char extra_buffer_32kb[0x8000];
+    int repair_mode;
+    int input_padding;
+    int quiet_mode;
+    int omit_empty_banks;
+    int verify;                     /* read the written .crt back (--verify) */
+    unsigned int verified_chips;
+    int extract_threads;
+    int extract_files;              /* -f writes the header and bank files */
+    int extract_dirfd;              /* the directory they are written to */
+    char *checksum_filename;        /* sidecar of -f */
+    mapped_file_t inmap;
+    char *inmap_name;               /* the file in inmap, if it was loaded by name */
+    crt_chip_t *crtchips;
+    unsigned int crtchips_num;
+    unsigned int crtchips_max;
+    unsigned int *crtbanks;         /* index of the first chip of each bank in the sorted crtchips */
+    unsigned int crtbanks_num;
+    edit_op_t *edit_ops;
+    unsigned int edit_ops_num;
+    crt_output_t crtout;
+    layout_chip_t *layout_chips;    /* the plan of save_layout_crt() */
+    unsigned int layout_chips_max;
+    romdb_t *romdb;                 /* titles of the known images and chips (--romdb) */
+    cartconv_header_t extracted_header; /* the last cartconv_extract(), see cartconv_get_header() */
+    cartconv_chip_t *extracted;
+    unsigned int extracted_num;
+    int extracted_valid;
+};
+
+static int load_input_file(cartconv_t *cc, const char *filename);
+static int load_mapped_input(cartconv_t *cc, const char *filename);
+static int check_crt_header(cartconv_t *cc, const char *filename);
+static int printinfo(cartconv_t *cc, const char *name);
+static int writev_all(int fd, struct iovec *iov, unsigned int num);
+static void flush_crt_output(cartconv_t *cc);
+static void abort_crt_output(cartconv_t *cc);
+static int is_empty_data(const unsigned char *data, unsigned int size);
+static void print_romdb(cartconv_t *cc, const crt_chip_t *chips, const hash_digests_t *digests, unsigned int num,
+                        const hash_digests_t *image);
+
+typedef struct cart_s {
+    unsigned char exrom;
+    unsigned char game;
+    unsigned int sizes;
+    unsigned int bank_size;
+    unsigned int load_address;
+    unsigned char banks;   /* 0 means the amount of banks need to be taken from the load-size and bank-size */
+    unsigned int data_type;
+    char *name;
+    char *opt;
+    int (*save)(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char gameline, unsigned char exromline);
+    unsigned int flags;
+    const struct cart_layout_s *layout; /* the chips of the .crt, for save_layout_crt() */
+} cart_t;
+
+/* a layout is the list of chips a .crt is made of, one run of chips after the
+   other, all of them taken from the binary in order. a zero count, size or
+   address is the one of cart_info, a zero count with zero banks there is as
+   many chips as the binary holds. */
+typedef struct layout_run_s {
+    unsigned int count;
+    unsigned int size;
+    unsigned int bank;          /* bank of the first chip */
+    unsigned int bank_step;     /* to the bank of the next chip, 0 ends the runs */
+    unsigned int address;
+    unsigned int hi_address;    /* if not 0 every bank has a second chip here */
+} layout_run_t;
+
+#define LAYOUT_RUNS_MAX 3
+
+/* layout flags, empty chips are only left out of CART_OMIT_EMPTY types */
+#define LAYOUT_OMIT_ENDS  0x01  /* empty chips are left out, except the first and last one */
+#define LAYOUT_OMIT_ANY   0x02  /* any empty chip is left out */
+#define LAYOUT_AT_2000    0x04  /* a smaller binary goes at $2000, with $ff before and after it */
+
+typedef struct cart_layout_s {
+    unsigned int binsize;       /* for binaries of this size, 0 for any size */
+    signed char game;           /* header lines and chip type, -1 for the ones of cart_info */
+    signed char exrom;
+    signed char chip_type;
+    unsigned char flags;
+    layout_run_t runs[LAYOUT_RUNS_MAX + 1];
+} cart_layout_t;
+
+/* cart_t flags */
+#define CART_OMIT_EMPTY 0x01    /* the hardware works with missing banks, empty ones are left out (unless -b) */
+
+/* some prototypes to save routines */
+static int save_layout_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char game, unsigned char exrom);
+static int save_generic_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char p5, unsigned char p6);
+static int save_delaep64_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char game, unsigned char exrom);
+static int save_delaep256_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char game, unsigned char exrom);
+static int save_delaep7x8_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char game, unsigned char exrom);
+static int save_rexep256_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char game, unsigned char exrom);
+
+/* the layouts, every list ends with the one for binaries of any size */
+static const cart_layout_t layout_regular[] = {
+    {0, -1, -1, -1, LAYOUT_OMIT_ENDS, {{0, 0, 0, 1, 0, 0}}}
+};
+
+static const cart_layout_t layout_fcplus[] = {
+    {0, -1, -1, -1, LAYOUT_AT_2000, {{0, 0, 0, 1, 0, 0}}}
+};
+
+static const cart_layout_t layout_2_blocks[] = {
+    {0, -1, -1, -1, 0, {{1, 0x2000, 0, 1, 0x8000, 0xa000}}}
+};
+
+static const cart_layout_t layout_easyflash[] = {
+    {0, 0, 0, 2, LAYOUT_OMIT_ANY, {{64, 0x2000, 0, 1, 0x8000, 0xa000}}}
+};
+
+/* 256KiB is in two halves, bank 0-15 at $8000 and 16-31 at $a000 */
+static const cart_layout_t layout_ocean[] = {
+    {CARTRIDGE_SIZE_256KB, 1, 0, -1, LAYOUT_OMIT_ENDS, {{16, 0x2000, 0, 1, 0x8000, 0}, {16, 0x2000, 16, 1, 0xa000, 0}}},
+    {0, -1, -1, -1, LAYOUT_OMIT_ENDS, {{0, 0x2000, 0, 1, 0x8000, 0}}}
+};
+
+/* banks 0,8,..,56,1,9,..,57 */
+static const cart_layout_t layout_funplay[] = {
+    {0, -1, -1, -1, 0, {{8, 0x2000, 0, 8, 0x8000, 0}, {8, 0x2000, 1, 8, 0x8000, 0}}}
+};
+
+static const cart_layout_t layout_easycalc[] = {
+    {0, 1, 1, -1, 0, {{1, 0x2000, 0, 1, 0x8000, 0xa000}, {1, 0x2000, 1, 1, 0xa000, 0}}}
+};
+
+static const cart_layout_t layout_zaxxon[] = {
+    {0, -1, -1, -1, 0, {{1, 0x1000, 0, 1, 0x8000, 0}, {2, 0x2000, 0, 1, 0xa000, 0}}}
+};
+
+static const cart_layout_t layout_stardos[] = {
+    {0, 1, 0, -1, 0, {{1, 0x2000, 0, 1, 0x8000, 0xe000}}}
+};
+
+/* the generic carts only take the sizes listed */
+static const cart_layout_t layout_generic[] = {
+    {CARTRIDGE_SIZE_2KB, 1, 0, 0, 0, {{1, 0x0800, 0, 1, 0x8000, 0}}},
+    {CARTRIDGE_SIZE_4KB, 1, 0, 0, 0, {{1, 0x1000, 0, 1, 0x8000, 0}}},
+    {CARTRIDGE_SIZE_8KB, 1, 0, 0, 0, {{1, 0x2000, 0, 1, 0x8000, 0}}},
+    {CARTRIDGE_SIZE_12KB, 0, 0, 0, 0, {{1, 0x3000, 0, 1, 0x8000, 0}}},
+    {CARTRIDGE_SIZE_16KB, 0, 0, 0, 0, {{1, 0x4000, 0, 1, 0x8000, 0}}},
+    {0, 0, 0, 0, 0, {{0, 0, 0, 0, 0, 0}}}
+};
+
+static const cart_layout_t layout_ultimax[] = {
+    {CARTRIDGE_SIZE_2KB, 0, 1, 0, 0, {{1, 0x0800, 0, 1, 0xf800, 0}}},
+    {CARTRIDGE_SIZE_4KB, 0, 1, 0, 0, {{1, 0x1000, 0, 1, 0xf000, 0}}},
+    {CARTRIDGE_SIZE_8KB, 0, 1, 0, 0, {{1, 0x2000, 0, 1, 0xe000, 0}}},
+    {CARTRIDGE_SIZE_16KB, 0, 1, 0, 0, {{1, 0x2000, 0, 1, 0x8000, 0xe000}}},
+    {0, 0, 0, 0, 0, {{0, 0, 0, 0, 0, 0}}}
+};
+
+/* this table must be in correct order so it can be indexed by CRT ID */
+/*
+    exrom, game, sizes, bank size, load addr, num banks, data type, name, option, saver, flags, layout
+
+    num banks == 0 - take number of banks from input file size
+*/
+static const cart_t cart_info[] = {
+/*  {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, "Generic 8KiB", NULL, NULL}, */ /* 8k game config */
+/*  {0, 0, CARTRIDGE_SIZE_12KB, 0x3000, 0x8000, 1, 0, "Generic 12KiB", NULL, NULL}, */ /* 16k game config */
+/*  {0, 0, CARTRIDGE_SIZE_16KB, 0x4000, 0x8000, 1, 0, "Generic 16KiB", NULL, NULL}, */ /* 16k game config */
+/*  {1, 0, CARTRIDGE_SIZE_4KB | CARTRIDGE_SIZE_16KB, 0, 0, 1, 0, "Ultimax", NULL, NULL}, */ /* ultimax config */
+
+/* FIXME: initial exrom/game values are often wrong in this table
+ *        don't forget to also update vice.texi accordingly */
+
+    {0, 1, CARTRIDGE_SIZE_4KB | CARTRIDGE_SIZE_8KB | CARTRIDGE_SIZE_12KB | CARTRIDGE_SIZE_16KB, 0, 0, 0, 0, "Generic Cartridge", NULL, save_generic_crt, 0, NULL},
+    {0, 1, CARTRIDGE_SIZE_32KB, 0x2000, 0x8000, 4, 0, CARTRIDGE_NAME_ACTION_REPLAY, "ar5", save_layout_crt, 0, layout_regular}, /* this is NOT AR1, but 4.2,5,6 etc */
+    {0, 0, CARTRIDGE_SIZE_16KB, 0x2000, 0, 2, 0, CARTRIDGE_NAME_KCS_POWER, "kcs", save_layout_crt, 0, layout_2_blocks},
+    {0, 0, CARTRIDGE_SIZE_64KB | CARTRIDGE_SIZE_256KB, 0x4000, 0x8000, 0, 0, CARTRIDGE_NAME_FINAL_III, "fc3", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_16KB, 0x2000, 0, 2, 0, CARTRIDGE_NAME_SIMONS_BASIC, "simon", save_layout_crt, 0, layout_2_blocks},
+    {0, 0, CARTRIDGE_SIZE_32KB | CARTRIDGE_SIZE_128KB | CARTRIDGE_SIZE_256KB | CARTRIDGE_SIZE_512KB, 0x2000, 0, 0, 0, CARTRIDGE_NAME_OCEAN, "ocean", save_layout_crt, CART_OMIT_EMPTY, layout_ocean},
+    {1, 0, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 2, CARTRIDGE_NAME_EXPERT, "expert", NULL, 0, NULL},
+    {0, 1, CARTRIDGE_SIZE_128KB, 0x2000, 0x8000, 16, 0, CARTRIDGE_NAME_FUNPLAY, "fp", save_layout_crt, 0, layout_funplay},
+    {0, 0, CARTRIDGE_SIZE_64KB, 0x4000, 0x8000, 4, 0, CARTRIDGE_NAME_SUPER_GAMES, "sg", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_32KB, 0x2000, 0x8000, 4, 0, CARTRIDGE_NAME_ATOMIC_POWER, "ap", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_EPYX_FASTLOAD, "epyx", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_16KB, 0x4000, 0x8000, 1, 0, CARTRIDGE_NAME_WESTERMANN, "wl", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_REX, "ru", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_16KB, 0x4000, 0x8000, 1, 0, CARTRIDGE_NAME_FINAL_I, "fc1", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_64KB | CARTRIDGE_SIZE_96KB | CARTRIDGE_SIZE_128KB, 0x2000, 0xe000, 0, 0, CARTRIDGE_NAME_MAGIC_FORMEL, "mf", save_layout_crt, 0, layout_regular}, /* FIXME: 64k (v1), 96k (v2) and 128k (full) bins exist */
+    {0, 1, CARTRIDGE_SIZE_512KB, 0x2000, 0x8000, 64, 0, CARTRIDGE_NAME_GS, "gs", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_16KB, 0x4000, 0x8000, 1, 0, CARTRIDGE_NAME_WARPSPEED, "ws", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_128KB, 0x2000, 0x8000, 16, 0, CARTRIDGE_NAME_DINAMIC, "din", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_20KB, 0, 0, 3, 0, CARTRIDGE_NAME_ZAXXON, "zaxxon", save_layout_crt, 0, layout_zaxxon},
+    {0, 1, CARTRIDGE_SIZE_32KB | CARTRIDGE_SIZE_64KB | CARTRIDGE_SIZE_128KB | CARTRIDGE_SIZE_256KB | CARTRIDGE_SIZE_512KB | CARTRIDGE_SIZE_1024KB, 0x2000, 0x8000, 0, 0, CARTRIDGE_NAME_MAGIC_DESK, "md", save_layout_crt, CART_OMIT_EMPTY, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_64KB, 0x4000, 0x8000, 4, 0, CARTRIDGE_NAME_SUPER_SNAPSHOT_V5, "ss5", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_64KB | CARTRIDGE_SIZE_128KB, 0x4000, 0x8000, 0, 0, CARTRIDGE_NAME_COMAL80, "comal", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_16KB, 0x2000, 0x8000, 2, 0, CARTRIDGE_NAME_STRUCTURED_BASIC, "sb", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_16KB | CARTRIDGE_SIZE_32KB, 0x4000, 0x8000, 0, 0, CARTRIDGE_NAME_ROSS, "ross", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0, 0x8000, 0, 0, CARTRIDGE_NAME_DELA_EP64, "dep64", save_delaep64_crt, 0, NULL},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 0, 0, CARTRIDGE_NAME_DELA_EP7x8, "dep7x8", save_delaep7x8_crt, 0, NULL},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 0, 0, CARTRIDGE_NAME_DELA_EP256, "dep256", save_delaep256_crt, 0, NULL},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0, 0x8000, 0, 0, CARTRIDGE_NAME_REX_EP256, "rep256", save_rexep256_crt, 0, NULL},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_MIKRO_ASSEMBLER, "mikro", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_24KB | CARTRIDGE_SIZE_32KB, 0x8000, 0x0000, 1, 0, CARTRIDGE_NAME_FINAL_PLUS, "fcp", save_layout_crt, 0, layout_fcplus},
+    {0, 1, CARTRIDGE_SIZE_32KB, 0x2000, 0x8000, 4, 0, CARTRIDGE_NAME_ACTION_REPLAY4, "ar4", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_16KB, 0x2000, 0, 4, 0, CARTRIDGE_NAME_STARDOS, "star", save_layout_crt, 0, layout_stardos},
+    {1, 0, CARTRIDGE_SIZE_1024KB, 0x2000, 0, 128, 0, CARTRIDGE_NAME_EASYFLASH, "easy", save_layout_crt, CART_OMIT_EMPTY, layout_easyflash},
+    {0, 0, 0, 0, 0, 0, 0, CARTRIDGE_NAME_EASYFLASH_XBANK, NULL, NULL, 0, NULL}, /* TODO ?? */
+    {1, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_CAPTURE, "cap", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_16KB, 0x2000, 0x8000, 2, 0, CARTRIDGE_NAME_ACTION_REPLAY3, "ar3", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_32KB | CARTRIDGE_SIZE_64KB | CARTRIDGE_SIZE_128KB, 0x2000, 0x8000, 0, 0, CARTRIDGE_NAME_RETRO_REPLAY, "rr", save_layout_crt, CART_OMIT_EMPTY, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_MMC64, "mmc64", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_64KB | CARTRIDGE_SIZE_512KB, 0x2000, 0x8000, 0, 0, CARTRIDGE_NAME_MMC_REPLAY, "mmcr", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_64KB | CARTRIDGE_SIZE_128KB | CARTRIDGE_SIZE_512KB, 0x4000, 0x8000, 0, 2, CARTRIDGE_NAME_IDE64, "ide64", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_32KB, 0x4000, 0x8000, 2, 0, CARTRIDGE_NAME_SUPER_SNAPSHOT, "ss4", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_4KB, 0x1000, 0x8000, 1, 0, CARTRIDGE_NAME_IEEE488, "ieee", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_8KB, 0x2000, 0xe000, 1, 0, CARTRIDGE_NAME_GAME_KILLER, "gk", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_256KB, 0x2000, 0x8000, 32, 0, CARTRIDGE_NAME_P64, "p64", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_8KB, 0x2000, 0xe000, 1, 0, CARTRIDGE_NAME_EXOS, "exos", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_FREEZE_FRAME, "ff", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_16KB | CARTRIDGE_SIZE_32KB, 0x4000, 0x8000, 0, 0, CARTRIDGE_NAME_FREEZE_MACHINE, "fm", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_4KB, 0x1000, 0xe000, 1, 0, CARTRIDGE_NAME_SNAPSHOT64, "s64", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_16KB, 0x2000, 0x8000, 2, 0, CARTRIDGE_NAME_SUPER_EXPLODE_V5, "se5", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_16KB, 0x4000, 0x8000, 1, 0, CARTRIDGE_NAME_MAGIC_VOICE, "mv", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_16KB, 0x2000, 0x8000, 2, 0, CARTRIDGE_NAME_ACTION_REPLAY2, "ar2", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_4KB | CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 0, 0, CARTRIDGE_NAME_MACH5, "mach5", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_DIASHOW_MAKER, "dsm", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_64KB, 0x4000, 0x8000, 4, 0, CARTRIDGE_NAME_PAGEFOX, "pf", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_24KB, 0x2000, 0x8000, 3, 0, CARTRIDGE_NAME_KINGSOFT, "ks", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_128KB, 0x2000, 0x8000, 16, 0, CARTRIDGE_NAME_SILVERROCK_128, "silver", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_32KB, 0x2000, 0xe000, 4, 0, CARTRIDGE_NAME_FORMEL64, "f64", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_64KB, 0x2000, 0x8000, 8, 0, CARTRIDGE_NAME_RGCD, "rgcd", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_RRNETMK3, "rrnet", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_24KB, 0, 0, 3, 0, CARTRIDGE_NAME_EASYCALC, "ecr", save_layout_crt, 0, layout_easycalc},
+    {0, 1, CARTRIDGE_SIZE_512KB, 0x2000, 0x8000, 64, 0, CARTRIDGE_NAME_GMOD2, "gmod2", save_layout_crt, CART_OMIT_EMPTY, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_16KB, 0x2000, 0, 0, 0, CARTRIDGE_NAME_MAX_BASIC, "max", save_generic_crt, 0, NULL},
+    {0, 1, CARTRIDGE_SIZE_2048KB | CARTRIDGE_SIZE_4096KB | CARTRIDGE_SIZE_8192KB | CARTRIDGE_SIZE_16384KB, 0x2000, 0x8000, 0, 0, CARTRIDGE_NAME_GMOD3, "gmod3", save_layout_crt, CART_OMIT_EMPTY, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_ZIPPCODE48, "zipp", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_32KB | CARTRIDGE_SIZE_64KB, 0x4000, 0x8000, 0, 0, CARTRIDGE_NAME_BLACKBOX8, "bb8", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_BLACKBOX3, "bb3", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_16KB, 0x4000, 0x8000, 1, 0, CARTRIDGE_NAME_BLACKBOX4, "bb4", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_REX_RAMFLOPPY, "rrf", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_2KB | CARTRIDGE_SIZE_4KB | CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 0, 0, CARTRIDGE_NAME_BISPLUS, "bis", save_layout_crt, 0, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_128KB, 0x4000, 0x8000, 8, 0, CARTRIDGE_NAME_SDBOX, "sdbox", save_layout_crt, 0, layout_regular},
+    {1, 0, CARTRIDGE_SIZE_1024KB, 0x4000, 0x8000, 64, 0, CARTRIDGE_NAME_MULTIMAX, "mm", save_layout_crt, CART_OMIT_EMPTY, layout_regular},
+    {0, 0, CARTRIDGE_SIZE_32KB, 0x4000, 0x8000, 0, 0, CARTRIDGE_NAME_BLACKBOX9, "bb9", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_8KB, 0x2000, 0x8000, 1, 0, CARTRIDGE_NAME_LT_KERNAL, "ltk", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_64KB, 0x2000, 0x8000, 8, 0, CARTRIDGE_NAME_RAMLINK, "rl", save_layout_crt, 0, layout_regular},
+    {0, 1, CARTRIDGE_SIZE_32KB, 0x2000, 0x8000, 4, 0, CARTRIDGE_NAME_HERO, "hero", save_layout_crt, 0, layout_regular},
+    {0, 0, 0, 0, 0, 0, 0, NULL, NULL, NULL, 0, NULL}
+};
+
+//#ifndef HAVE_MEMMOVE
+#define memmove(x, y, z) bcopy(y, x, z)
+//#endif
+
+#ifndef HAVE_STRDUP
+char *strdup(const char *string)
+{
+    char *new;
+
+    new = malloc(strlen(string) + 1);
+    if (new != NULL) {
+        strcpy(new, string);
+    }
+    return new;
+}
+#endif
+
+#if !defined(HAVE_STRNCASECMP)
+static const unsigned char charmap[] = {
+    '\000', '\001', '\002', '\003', '\004', '\005', '\006', '\007',
+    '\010', '\011', '\012', '\013', '\014', '\015', '\016', '\017',
+    '\020', '\021', '\022', '\023', '\024', '\025', '\026', '\027',
+    '\030', '\031', '\032', '\033', '\034', '\035', '\036', '\037',
+    '\040', '\041', '\042', '\043', '\044', '\045', '\046', '\047',
+    '\050', '\051', '\052', '\053', '\054', '\055', '\056', '\057',
+    '\060', '\061', '\062', '\063', '\064', '\065', '\066', '\067',
+    '\070', '\071', '\072', '\073', '\074', '\075', '\076', '\077',
+    '\100', '\141', '\142', '\143', '\144', '\145', '\146', '\147',
+    '\150', '\151', '\152', '\153', '\154', '\155', '\156', '\157',
+    '\160', '\161', '\162', '\163', '\164', '\165', '\166', '\167',
+    '\170', '\171', '\172', '\133', '\134', '\135', '\136', '\137',
+    '\140', '\141', '\142', '\143', '\144', '\145', '\146', '\147',
+    '\150', '\151', '\152', '\153', '\154', '\155', '\156', '\157',
+    '\160', '\161', '\162', '\163', '\164', '\165', '\166', '\167',
+    '\170', '\171', '\172', '\173', '\174', '\175', '\176', '\177',
+    '\200', '\201', '\202', '\203', '\204', '\205', '\206', '\207',
+    '\210', '\211', '\212', '\213', '\214', '\215', '\216', '\217',
+    '\220', '\221', '\222', '\223', '\224', '\225', '\226', '\227',
+    '\230', '\231', '\232', '\233', '\234', '\235', '\236', '\237',
+    '\240', '\241', '\242', '\243', '\244', '\245', '\246', '\247',
+    '\250', '\251', '\252', '\253', '\254', '\255', '\256', '\257',
+    '\260', '\261', '\262', '\263', '\264', '\265', '\266', '\267',
+    '\270', '\271', '\272', '\273', '\274', '\275', '\276', '\277',
+    '\300', '\341', '\342', '\343', '\344', '\345', '\346', '\347',
+    '\350', '\351', '\352', '\353', '\354', '\355', '\356', '\357',
+    '\360', '\361', '\362', '\363', '\364', '\365', '\366', '\367',
+    '\370', '\371', '\372', '\333', '\334', '\335', '\336', '\337',
+    '\340', '\341', '\342', '\343', '\344', '\345', '\346', '\347',
+    '\350', '\351', '\352', '\353', '\354', '\355', '\356', '\357',
+    '\360', '\361', '\362', '\363', '\364', '\365', '\366', '\367',
+    '\370', '\371', '\372', '\373', '\374', '\375', '\376', '\377',
+};
+
+int strncasecmp(const char *s1, const char *s2, size_t n)
+{
+    unsigned char u1, u2;
+
+    for (; n != 0; --n) {
+        u1 = (unsigned char)*s1++;
+        u2 = (unsigned char)*s2++;
+        if (charmap[u1] != charmap[u2]) {
+            return charmap[u1] - charmap[u2];
+        }
+
+        if (u1 == '\0') {
+            return 0;
+        }
+    }
+    return 0;
+}
+#endif
+
+/* print an error or warning, errors are also kept for cartconv_error() */
+static void cc_error(cartconv_t *cc, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vfprintf(cc->err, format, ap);
+    va_end(ap);
+    if (!strncmp(format, "Error: ", 7)) {
+        va_start(ap, format);
+        vsnprintf(cc->error, sizeof(cc->error), format + 7, ap);
+        va_end(ap);
+        cc->error[strcspn(cc->error, "\n")] = 0;
+    }
+}
+
+static int get_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n < 1) ? 1 : (int)n;
+}
+
+/* read a pipe (stdin) completely, it can not be mapped */
+static int read_input_stream(mapped_file_t *m)
+{
+    unsigned char *p;
+    size_t max = 0;
+    ssize_t n;
+
+    while (1) {
+        if (m->size == max) {
+            max = max ? max * 2 : 0x10000;
+            p = realloc(m->data, max);
+            if (p == NULL) {
+                free(m->data);
+                m->data = NULL;
+                close(m->fd);
+                m->fd = -1;
+                return -1;
+            }
+            m->data = p;
+        }
+        n = read(m->fd, m->data + m->size, max - m->size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        m->size += (size_t)n;
+    }
+    return 0;
+}
+
+static int map_input_fd(mapped_file_t *m, int fd);
+
+/* map a file into memory, falls back to reading it if mmap is not possible */
+static int map_input_file(mapped_file_t *m, const char *filename)
+{
+    if (!strcmp(filename, "-")) {
+        return map_input_fd(m, dup(STDIN_FILENO));
+    }
+    return map_input_fd(m, open(filename, O_RDONLY));
+}
+
+/* map an open file into memory, the fd is owned by m afterwards */
+static int map_input_fd(mapped_file_t *m, int fd)
+{
+    struct stat st;
+    ssize_t n;
+    size_t pos = 0;
+
+    m->fd = fd;
+    m->data = NULL;
+    m->size = 0;
+    m->is_mapped = 0;
+    if (m->fd < 0) {
+        return -1;
+    }
+    if (fstat(m->fd, &st) < 0) {
+        close(m->fd);
+        m->fd = -1;
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        return read_input_stream(m);
+    }
+    m->size = (size_t)st.st_size;
+    if (m->size == 0) {
+        return 0;
+    }
+    m->data = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, m->fd, 0);
+    if (m->data != MAP_FAILED) {
+        m->is_mapped = 1;
+#ifdef MADV_SEQUENTIAL
+        madvise(m->data, m->size, MADV_SEQUENTIAL);
+#endif
+        return 0;
+    }
+    m->data = malloc(m->size);
+    if (m->data == NULL) {
+        close(m->fd);
+        m->fd = -1;
+        return -1;
+    }
+    while (pos < m->size) {
+        n = read(m->fd, m->data + pos, m->size - pos);
+        if (n <= 0) {
+            break;
+        }
+        pos += (size_t)n;
+    }
+    m->size = pos;
+    return 0;
+}
+
+static void unmap_input_file(mapped_file_t *m)
+{
+    if (m->data != NULL) {
+        if (m->is_mapped == 1) {
+            munmap(m->data, m->size);
+        } else if (m->is_mapped == 0) {
+            free(m->data);
+        }
+    }
+    if (m->fd >= 0) {
+        close(m->fd);
+    }
+    m->fd = -1;
+    m->data = NULL;
+    m->size = 0;
+    m->is_mapped = 0;
+}
+
+/* copy a part of the mapped file into a new file. the kernel copies the data
+   directly where possible, otherwise it is written from the mapping in bounded
+   pieces. no user space buffer is involved, whatever the length is. */
+#define COPY_ERROR_OPEN   -1
+#define COPY_ERROR_WRITE  -2
+
+/* copy a part of the input to the file name in dirfd. no message is printed,
+   it is also used by the extraction threads: the error is returned and
+   reported with copy_file_error() */
+static int copy_file_chunk(int dirfd, const mapped_file_t *m, unsigned long offset, unsigned long length, const char *name)
+{
+    int outfd;
+    ssize_t n;
+    size_t chunk;
+#ifdef __linux__
+    off_t off = (off_t)offset;
+    int use_copy_range = 1;
+    int use_sendfile = 1;
+#endif
+
+    outfd = openat(dirfd, name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (outfd < 0) {
+        return COPY_ERROR_OPEN;
+    }
+
+    while (length > 0) {
+        chunk = (length > 0x100000) ? 0x100000 : (size_t)length;
+#ifdef __linux__
+        if (use_copy_range) {
+            n = copy_file_range(m->fd, &off, outfd, NULL, chunk, 0);
+            if (n > 0) {
+                length -= (unsigned long)n;
+                offset += (unsigned long)n;
+                continue;
+            }
+            /* cross filesystem, unsupported or a special file */
+            use_copy_range = 0;
+            if (n < 0 && errno == EINTR) {
+                use_copy_range = 1;
+            }
+            continue;
+        }
+        if (use_sendfile) {
+            n = sendfile(outfd, m->fd, &off, chunk);
+            if (n > 0) {
+                length -= (unsigned long)n;
+                offset += (unsigned long)n;
+                continue;
+            }
+            use_sendfile = 0;
+            if (n < 0 && errno == EINTR) {
+                use_sendfile = 1;
+            }
+            continue;
+        }
+#endif
+        n = write(outfd, m->data + offset, chunk);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            close(outfd);
+            return COPY_ERROR_WRITE;
+        }
+        length -= (unsigned long)n;
+        offset += (unsigned long)n;
+    }
+
+    close(outfd);
+    return 0;
+}
+
+static void copy_file_error(cartconv_t *cc, int error, const char *name)
+{
+    if (error == COPY_ERROR_OPEN) {
+        cc_error(cc, "Error: Can't open output file %s\n", name);
+    } else {
+        cc_error(cc, "Error: Can't write to file %s\n", name);
+    }
+}
+
+static void crt_decode_chip_header(const unsigned char *b, crt_chip_t *chip)
+{
+    chip->offset = 0;
+    chip->length = (unsigned long)((b[4] << 24) + (b[5] << 16) + (b[6] << 8) + b[7]);
+    chip->type = (unsigned int)((b[8] * 0x100) + b[9]);
+    chip->bank = (unsigned int)((b[10] * 0x100) + b[11]);
+    chip->start = (unsigned int)((b[12] * 0x100) + b[13]);
+    chip->size = (unsigned int)((b[14] * 0x100) + b[15]);
+    chip->avail = chip->size;
+    chip->header = b;
+    chip->data = b + 0x10;
+}
+
+/* decode the CHIP packet at pos, returns -1 if there is no complete CHIP header left */
+static int crt_decode_chip(const mapped_file_t *m, unsigned long pos, crt_chip_t *chip)
+{
+    const unsigned char *b;
+    unsigned long left;
+
+    if (pos > m->size || (m->size - pos) < 0x10) {
+        return -1;
+    }
+    b = m->data + pos;
+    left = m->size - pos - 0x10;
+
+    crt_decode_chip_header(b, chip);
+    chip->offset = pos;
+    chip->avail = (left < chip->size) ? (unsigned int)left : chip->size;
+    return 0;
+}
+
+/* all CHIP packets of the .crt in m, in file order. the walk stops after a
+   packet that is shorter than its header or runs past the end of the file,
+   that one is kept as the last chip but not counted in *complete. the
+   array has room for extra more chips. -1 if out of memory */
+static int crt_walk_chips(const mapped_file_t *m, unsigned int extra, crt_chip_t **chips,
+                          unsigned int *num, unsigned int *complete)
+{
+    crt_chip_t chip;
+    crt_chip_t *list, *p;
+    unsigned int max = 64;
+    unsigned long pos = 0x40;
+
+    *num = 0;
+    *complete = 0;
+    list = malloc((max + extra) * sizeof(crt_chip_t));
+    if (list == NULL) {
+        return -1;
+    }
+    while (crt_decode_chip(m, pos, &chip) == 0) {
+        if (*num == max) {
+            max *= 2;
+            p = realloc(list, (max + extra) * sizeof(crt_chip_t));
+            if (p == NULL) {
+                free(list);
+                return -1;
+            }
+            list = p;
+        }
+        list[(*num)++] = chip;
+        if (chip.length < 0x10 || chip.length > (m->size - pos)) {
+            break;
+        }
+        pos += chip.length;
+        (*complete)++;
+    }
+    *chips = list;
+    return 0;
+}
+
+/* check a CHIP header, returns the amount of data that can be loaded */
+static int crt_check_chip(cartconv_t *cc, const crt_chip_t *chip, unsigned int *loadsize)
+{
+    if (memcmp(chip->header, "CHIP", 4) != 0) {
+        cc_error(cc, "Error: CHIP tag not found.\n");
+        return -1;
+    }
+    *loadsize = chip->size;
+    if ((chip->size + 0x10) > chip->length) {
+        if (cc->repair_mode) {
+            cc_error(cc, "Warning: data size exceeds chunk length. (data:%04x chunk:%04lx)\n", chip->size, chip->length);
+            *loadsize = (chip->length > 0x10) ? (unsigned int)(chip->length - 0x10) : 0;
+        } else {
+            cc_error(cc, "Error: data size exceeds chunk length. (data:%04x chunk:%04lx) (use -r to force)\n", chip->size, chip->length);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int crt_add_chip(cartconv_t *cc, const crt_chip_t *chip)
+{
+    crt_chip_t *p;
+
+    if (cc->crtchips_num == cc->crtchips_max) {
+        cc->crtchips_max = cc->crtchips_max ? cc->crtchips_max * 2 : 64;
+        p = realloc(cc->crtchips, cc->crtchips_max * sizeof(crt_chip_t));
+        if (p == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            return -1;
+        }
+        cc->crtchips = p;
+    }
+    cc->crtchips[cc->crtchips_num++] = *chip;
+    return 0;
+}
+
+/* the layout of the type for the size of the binary */
+static const cart_layout_t *find_layout(const cart_layout_t *layout, unsigned int binsize)
+{
+    while (layout->binsize != 0 && layout->binsize != binsize) {
+        layout++;
+    }
+    return layout;
+}
+
+/* the position of a bank in the binary, from the runs of the layout for any
+   size: for funplay bank 8 is the second one */
+static unsigned int layout_bank_key(const cart_layout_t *layout, unsigned int bank)
+{
+    const layout_run_t *run;
+    unsigned int base = 0, n;
+
+    layout = find_layout(layout, 0);
+    for (run = layout->runs; run->bank_step != 0; run++) {
+        if (run->count == 0) {
+            break;
+        }
+        if (bank >= run->bank && (bank - run->bank) % run->bank_step == 0) {
+            n = (bank - run->bank) / run->bank_step;
+            if (n < run->count) {
+                return base + n;
+            }
+        }
+        base += run->count;
+    }
+    return base + bank;
+}
+
+/* the position of a bank in the binary */
+static unsigned int crt_bank_key(cartconv_t *cc, unsigned int bank)
+{
+    if (cart_info[cc->loadfile_cart_type].layout != NULL) {
+        return layout_bank_key(cart_info[cc->loadfile_cart_type].layout, bank);
+    }
+    return bank;
+}
+
+static int compare_chips(const void *op1, const void *op2)
+{
+    const crt_chip_t *p1 = (const crt_chip_t *)op1;
+    const crt_chip_t *p2 = (const crt_chip_t *)op2;
+
+    if (p1->key != p2->key) {
+        return (p1->key < p2->key) ? -1 : 1;
+    }
+    if (p1->start != p2->start) {
+        return (p1->start < p2->start) ? -1 : 1;
+    }
+    return (p1->offset < p2->offset) ? -1 : 1;
+}
+
+/* the smallest binary size from n up that has all its bits in sizes, 0 if
+   there is none. that is n with the lowest 0 bit set that can be set while
+   the bits above it are in sizes, and the bits below it cleared */
+static unsigned int cart_pad_size(unsigned int sizes, unsigned int n)
+{
+    unsigned int bit, high;
+
+    if ((n & sizes) == n) {
+        return n;
+    }
+    for (bit = 1; bit != 0 && bit <= sizes; bit <<= 1) {
+        high = n & ~((bit << 1) - 1);
+        if (!(n & bit) && (sizes & bit) && (high & sizes) == high) {
+            return high | bit;
+        }
+    }
+    return 0;
+}
+
+/* the size of the binary for a cart of the given type with data up to end.
+   when banks were left out the last ones may be missing too, the binary
+   then gets the next size the type knows, so it can be converted back */
+static unsigned int crt_sparse_size(int type, unsigned int end, int left_out)
+{
+    unsigned int size;
+
+    if (!left_out) {
+        return end;
+    }
+    size = cart_pad_size(cart_info[type].sizes, end);
+    return size ? size : end;
+}
+
+/* 1 if the banks of the cart type may have been left out when empty, the
+   bank number then gives the position of a chip in the binary */
+static int crt_is_sparse(int type)
+{
+    return type > 0 && type <= CARTRIDGE_LAST && type != CARTRIDGE_EASYFLASH &&
+           (cart_info[type].flags & CART_OMIT_EMPTY);
+}
+
+/* the largest binary of the cart type */
+static unsigned int crt_max_size(int type)
+{
+    unsigned int size, max = 0;
+
+    for (size = CARTRIDGE_SIZE_2KB; size <= CARTRIDGE_SIZE_MAX; size <<= 1) {
+        if (cart_info[type].sizes & size) {
+            max = size;
+        }
+    }
+    return max ? max : CARTRIDGE_SIZE_MAX;
+}
+
+/* the position of each chip in the binary. the sorted chips simply follow
+   each other, unless empty banks may have been left out. a chip whose bank
+   is beyond the largest binary of the type is an error, with -r it is left
+   out */
+static int crt_layout_chips(cartconv_t *cc)
+{
+    unsigned int i, pos = 0;
+    unsigned int size = cc->crtchips[0].size;
+    unsigned int max;
+    int sparse = crt_is_sparse(cc->loadfile_cart_type);
+    int left_out = 0;
+
+    /* with different chip sizes or several chips per bank the bank number says nothing */
+    for (i = 1; sparse && i < cc->crtchips_num; i++) {
+        if (cc->crtchips[i].size != size || cc->crtchips[i].key == cc->crtchips[i - 1].key) {
+            sparse = 0;
+        }
+    }
+    if (sparse) {
+        max = crt_max_size(cc->loadfile_cart_type);
+        /* the chips are sorted by bank, the ones that do not fit are at the end */
+        for (i = 0; i < cc->crtchips_num; i++) {
+            if ((unsigned long)cc->crtchips[i].key * size + size > max) {
+                if (!cc->repair_mode || i == 0) {
+                    cc_error(cc, "Error: bank %u of the chip at $%06lx is beyond the size of the cart type%s\n",
+                             cc->crtchips[i].bank, cc->crtchips[i].offset, (i > 0) ? " (use -r to leave it out)" : "");
+                    return -1;
+                }
+                cc_error(cc, "Warning: bank %u of the chip at $%06lx is beyond the size of the cart type, left out\n",
+                         cc->crtchips[i].bank, cc->crtchips[i].offset);
+                cc->crtchips_num = i;
+                break;
+            }
+        }
+    }
+    for (i = 0; i < cc->crtchips_num; i++) {
+        if (sparse && cc->crtchips[i].key * size != pos) {
+            pos = cc->crtchips[i].key * size;
+            left_out = 1;
+        }
+        cc->crtchips[i].binpos = pos;
+        pos += cc->crtchips[i].size;
+    }
+    if (sparse) {
+        cc->loadfile_size = crt_sparse_size(cc->loadfile_cart_type, pos, left_out);
+    }
+    return 0;
+}
+
+/* sort the chips of the loaded file by bank and address, so the binary gets
+   the right layout whatever order the chips have in the file, and build the
+   table to find the chips of a bank directly */
+static int crt_index_chips(cartconv_t *cc)
+{
+    unsigned int i, key;
+
+    free(cc->crtbanks);
+    cc->crtbanks = NULL;
+    cc->crtbanks_num = 0;
+    if (cc->crtchips_num == 0) {
+        return 0;
+    }
+    for (i = 0; i < cc->crtchips_num; i++) {
+        cc->crtchips[i].key = crt_bank_key(cc, cc->crtchips[i].bank);
+    }
+    qsort(cc->crtchips, cc->crtchips_num, sizeof(crt_chip_t), compare_chips);
+    if (crt_layout_chips(cc) < 0) {
+        return -1;
+    }
+
+    cc->crtbanks_num = cc->crtchips[cc->crtchips_num - 1].key + 2;
+    cc->crtbanks = malloc(cc->crtbanks_num * sizeof(unsigned int));
+    if (cc->crtbanks == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        cc->crtbanks_num = 0;
+        return -1;
+    }
+    key = 0;
+    for (i = 0; i < cc->crtchips_num; i++) {
+        while (key <= cc->crtchips[i].key) {
+            cc->crtbanks[key++] = i;
+        }
+    }
+    while (key < cc->crtbanks_num) {
+        cc->crtbanks[key++] = cc->crtchips_num;
+    }
+    return 0;
+}
+
+/* find the chip of a bank. hi selects the chip that is not at $8000, which is
+   $a000 or $e000 depending on the mode. if the file has the same bank twice the
+   last one wins */
+static const crt_chip_t *crt_find_chip(cartconv_t *cc, unsigned int bank, int hi)
+{
+    unsigned int key = crt_bank_key(cc, bank);
+    unsigned int i;
+    const crt_chip_t *chip = NULL;
+
+    if (key + 1 >= cc->crtbanks_num) {
+        return NULL;
+    }
+    for (i = cc->crtbanks[key]; i < cc->crtbanks[key + 1]; i++) {
+        if (((cc->crtchips[i].start >> 8) != 0x80) == (hi != 0)) {
+            chip = &cc->crtchips[i];
+        }
+    }
+    return chip;
+}
+
+static void close_input_file(cartconv_t *cc)
+{
+    flush_crt_output(cc);           /* the pending chips may point into the input */
+    unmap_input_file(&cc->inmap);
+    cc->crtchips_num = 0;
+    free(cc->crtbanks);
+    cc->crtbanks = NULL;
+    cc->crtbanks_num = 0;
+    cc->loaddata = NULL;
+    cc->loaded = 0;
+    free(cc->inmap_name);
+    cc->inmap_name = NULL;
+}
+
+
+/* the registry: indexes of cart_info by option and by name, the types with
+   an option sorted by it and the types that can be made from a binary. they
+   are made once, on first use */
+#define CART_HASH_SIZE 256      /* a power of 2, more than twice the types */
+
+typedef struct cart_registry_s {
+    unsigned char by_opt[CART_HASH_SIZE];       /* crt id + 1, 0 for a free slot */
+    unsigned char by_name[CART_HASH_SIZE];
+    unsigned char listed[CARTRIDGE_LAST + 1];   /* crt ids */
+    unsigned int listed_num;
+    unsigned char convertible[CARTRIDGE_LAST + 1];
+    unsigned int convertible_num;
+} cart_registry_t;
+
+static cart_registry_t cart_registry;
+static pthread_once_t cart_registry_once = PTHREAD_ONCE_INIT;
+
+/* FNV-1a of the lower case string */
+static unsigned int cart_hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s) {
+        h = (h ^ (unsigned char)tolower((int)(unsigned char)*s++)) * 16777619u;
+    }
+    return h & (CART_HASH_SIZE - 1);
+}
+
+static void cart_hash_add(unsigned char *table, const char *key, int id)
+{
+    unsigned int h = cart_hash(key);
+
+    while (table[h] != 0) {
+        h = (h + 1) & (CART_HASH_SIZE - 1);
+    }
+    table[h] = (unsigned char)(id + 1);
+}
+
+static int compare_listed(const void *op1, const void *op2)
+{
+    return strcmp(cart_info[*(const unsigned char *)op1].opt, cart_info[*(const unsigned char *)op2].opt);
+}
+
+static void cart_registry_init(void)
+{
+    cart_registry_t *r = &cart_registry;
+    int i;
+
+    for (i = 0; i <= CARTRIDGE_LAST && cart_info[i].name != NULL; i++) {
+        cart_hash_add(r->by_name, cart_info[i].name, i);
+        if (cart_info[i].opt == NULL) {
+            continue;
+        }
+        cart_hash_add(r->by_opt, cart_info[i].opt, i);
+        /* crt id 0 is listed as "normal" */
+        if (i > 0) {
+            r->listed[r->listed_num++] = (unsigned char)i;
+            if (cart_info[i].save != NULL) {
+                r->convertible[r->convertible_num++] = (unsigned char)i;
+            }
+        }
+    }
+    qsort(r->listed, r->listed_num, 1, compare_listed);
+}
+
+static const cart_registry_t *get_cart_registry(void)
+{
+    pthread_once(&cart_registry_once, cart_registry_init);
+    return &cart_registry;
+}
+
+static int cart_hash_find(const unsigned char *table, const char *key, int by_name)
+{
+    unsigned int h = cart_hash(key);
+    int id;
+
+    while (table[h] != 0) {
+        id = table[h] - 1;
+        if (!strcasecmp(by_name ? cart_info[id].name : cart_info[id].opt, key)) {
+            return id;
+        }
+        h = (h + 1) & (CART_HASH_SIZE - 1);
+    }
+    return -1;
+}
+
+/* the crt id of a type option like "easy" or of a type name like
+   "EasyFlash", -1 if there is no such type */
+static int find_cart_type(const char *type)
+{
+    const cart_registry_t *r = get_cart_registry();
+    int id;
+
+    id = cart_hash_find(r->by_opt, type, 0);
+    if (id < 0) {
+        id = cart_hash_find(r->by_name, type, 1);
+    }
+    return id;
+}
+
+/* extra files can be inserted into the eproms of these */
+static int cart_takes_inserts(int id)
+{
+    return id == CARTRIDGE_DELA_EP7x8 || id == CARTRIDGE_DELA_EP64 ||
+           id == CARTRIDGE_REX_EP256 || id == CARTRIDGE_DELA_EP256;
+}
+
+
+
+/* run worker on the calling thread and on up to maxthreads - 1 more (-j, by
+   default one per cpu). the workers take the next chip or file from the
+   list in arg themselves */
+static void run_chip_workers(cartconv_t *cc, unsigned int maxthreads, void *(*worker)(void *), void *arg)
+{
+    pthread_t *threads;
+    unsigned int numthreads, n, i;
+
+    numthreads = (cc->extract_threads > 0) ? (unsigned int)cc->extract_threads : (unsigned int)get_cpu_count();
+    if (numthreads > maxthreads) {
+        numthreads = maxthreads;
+    }
+    threads = (numthreads > 1) ? malloc((numthreads - 1) * sizeof(pthread_t)) : NULL;
+    n = 0;
+    if (threads != NULL) {
+        for (n = 0; n < numthreads - 1; n++) {
+            if (pthread_create(&threads[n], NULL, worker, arg) != 0) {
+                break;
+            }
+        }
+    }
+    worker(arg);
+    for (i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
+
+/* the bank files of printbanks are written by several threads, each of them
+   takes the next chip from the list, hashes it and writes it while it is
+   still in the cache */
+typedef struct extract_list_s {
+    cartconv_t *cc;
+    const mapped_file_t *m;
+    crt_chip_t *chips;
+    hash_digests_t *digests;
+    unsigned char *skip;            /* chips that are overwritten by a later one */
+    unsigned int num;
+    unsigned int next;
+    int error;                      /* the first failed bank file, reported by the main thread */
+    char errorname[25];
+    pthread_mutex_t lock;
+} extract_list_t;
+
+static void extract_chip(extract_list_t *list, const crt_chip_t *chip)
+{
+    char bankname[25];
+    int error;
+
+    sprintf(bankname, "%03x_%04x_%04x", chip->bank, chip->start, (chip->start + chip->size - 1));
+    error = copy_file_chunk(list->cc->extract_dirfd, list->m, chip->offset, chip->length, bankname);
+    if (error < 0) {
+        pthread_mutex_lock(&list->lock);
+        if (list->error == 0) {
+            list->error = error;
+            strcpy(list->errorname, bankname);
+        }
+        pthread_mutex_unlock(&list->lock);
+    }
+}
+
+static void *extract_thread(void *arg)
+{
+    extract_list_t *list = arg;
+    unsigned int i;
+
+    while (1) {
+        pthread_mutex_lock(&list->lock);
+        i = list->next++;
+        pthread_mutex_unlock(&list->lock);
+        if (i >= list->num) {
+            break;
+        }
+        if (list->digests != NULL) {
+            hash_digests(list->chips[i].data, list->chips[i].avail, &list->digests[i]);
+        }
+        if (!list->skip[i]) {
+            extract_chip(list, &list->chips[i]);
+        }
+    }
+    return NULL;
+}
+
+static int compare_chip_names(const void *op1, const void *op2)
+{
+    const crt_chip_t *p1 = *(const crt_chip_t * const *)op1;
+    const crt_chip_t *p2 = *(const crt_chip_t * const *)op2;
+
+    if (p1->bank != p2->bank) {
+        return (p1->bank < p2->bank) ? -1 : 1;
+    }
+    if (p1->start != p2->start) {
+        return (p1->start < p2->start) ? -1 : 1;
+    }
+    if (p1->size != p2->size) {
+        return (p1->size < p2->size) ? -1 : 1;
+    }
+    return (p1->offset < p2->offset) ? -1 : 1;
+}
+
+/* write the bank files of all chips. chips that end up in the same file are
+   only written once, with the data of the last one like the sequential
+   extraction did. the checksums of every chip go to digests if it is not NULL.
+   -1 if a bank file could not be written */
+static int extract_chips(cartconv_t *cc, const mapped_file_t *m, crt_chip_t *chips, unsigned int num, hash_digests_t *digests)
+{
+    extract_list_t list;
+    crt_chip_t **sorted;
+    unsigned char *skip;
+    unsigned int i;
+
+    skip = calloc(num, 1);
+    sorted = malloc(num * sizeof(crt_chip_t *));
+    if (skip == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        free(sorted);
+        return -1;
+    }
+    if (!cc->extract_files) {
+        memset(skip, 1, num);       /* only the checksums */
+    } else if (sorted != NULL) {
+        for (i = 0; i < num; i++) {
+            sorted[i] = &chips[i];
+        }
+        qsort(sorted, num, sizeof(crt_chip_t *), compare_chip_names);
+        for (i = 1; i < num; i++) {
+            if (sorted[i - 1]->bank == sorted[i]->bank && sorted[i - 1]->start == sorted[i]->start &&
+                sorted[i - 1]->size == sorted[i]->size) {
+                skip[sorted[i - 1] - chips] = 1;    /* overwritten by a later chip */
+            }
+        }
+    }
+    free(sorted);
+
+    list.cc = cc;
+    list.m = m;
+    list.chips = chips;
+    list.digests = digests;
+    list.skip = skip;
+    list.num = num;
+    list.next = 0;
+    list.error = 0;
+    pthread_mutex_init(&list.lock, NULL);
+    run_chip_workers(cc, num / 4, extract_thread, &list);
+    free(skip);
+    pthread_mutex_destroy(&list.lock);
+    if (list.error < 0) {
+        copy_file_error(cc, list.error, list.errorname);
+        return -1;
+    }
+    return 0;
+}
+
+/* the SHAs of the whole file can not be split up, they are done by one more
+   thread while the chips are extracted. the CRC32 is put together from the
+   ones of the chips afterwards */
+typedef struct image_hash_s {
+    const mapped_file_t *m;
+    int sha256;                     /* only for the sidecar file */
+    hash_digests_t d;
+} image_hash_t;
+
+static void *image_hash_thread(void *arg)
+{
+    image_hash_t *h = arg;
+    const unsigned char *p = h->m->data;
+    size_t size = h->m->size;
+    size_t n;
+    sha1_ctx_t sha1;
+    sha256_ctx_t sha256;
+
+    sha1_init(&sha1);
+    sha256_init(&sha256);
+    while (size > 0) {
+        n = (size > 0x2000) ? 0x2000 : size;
+        sha1_update(&sha1, p, n);
+        if (h->sha256) {
+            sha256_update(&sha256, p, n);
+        }
+        p += n;
+        size -= n;
+    }
+    sha1_final(&sha1, h->d.sha1);
+    sha256_final(&sha256, h->d.sha256);
+    return NULL;
+}
+
+/* the CRC32 of the file from the ones of the chips, only the headers and the
+   bytes between the chips are read again */
+static uint32_t image_crc32(const mapped_file_t *m, const crt_chip_t *chips, const hash_digests_t *digests, unsigned int num)
+{
+    unsigned long pos = 0, data;
+    uint32_t crc = 0;
+    unsigned int i;
+
+    for (i = 0; i < num && digests != NULL; i++) {
+        data = (unsigned long)(chips[i].data - m->data);
+        if (data < pos) {
+            /* the data of the chip before runs into this one */
+            return crc32_update(0, m->data, m->size);
+        }
+        crc = crc32_update(crc, m->data + pos, data - pos);
+        crc = crc32_combine(crc, digests[i].crc32, chips[i].avail);
+        pos = data + chips[i].avail;
+    }
+    return crc32_update(crc, m->data + pos, m->size - pos);
+}
+
+/* the checksums as comma separated values, for the sidecar file of -f */
+static int write_checksums(cartconv_t *cc, const crt_chip_t *chips, const hash_digests_t *digests, unsigned int num, const image_hash_t *image)
+{
+    char sha1[SHA1_DIGEST_SIZE * 2 + 1];
+    char sha256[SHA256_DIGEST_SIZE * 2 + 1];
+    unsigned int i;
+    FILE *f;
+
+    f = fopen(cc->checksum_filename, "w");
+    if (f == NULL) {
+        cc_error(cc, "Error: Can't open output file %s\n", cc->checksum_filename);
+        return -1;
+    }
+    fprintf(f, "offset,bank,address,size,crc32,sha1,sha256\n");
+    for (i = 0; i < num; i++) {
+        hash_to_hex(digests[i].sha1, SHA1_DIGEST_SIZE, sha1);
+        hash_to_hex(digests[i].sha256, SHA256_DIGEST_SIZE, sha256);
+        fprintf(f, "0x%06lx,%u,0x%04x,%u,%08x,%s,%s\n",
+                chips[i].offset, chips[i].bank, chips[i].start, chips[i].avail, digests[i].crc32, sha1, sha256);
+    }
+    hash_to_hex(image->d.sha1, SHA1_DIGEST_SIZE, sha1);
+    hash_to_hex(image->d.sha256, SHA256_DIGEST_SIZE, sha256);
+    fprintf(f, "image,,,%lu,%08x,%s,%s\n", (unsigned long)image->m->size, image->d.crc32, sha1, sha256);
+    if (fclose(f) != 0) {
+        cc_error(cc, "Error: Can't write to file %s\n", cc->checksum_filename);
+        return -1;
+    }
+    return 0;
+}
+
+/* keep the header and the table that printbanks printed for
+   cartconv_get_header() and cartconv_get_chips() */
+static void save_chip_table(cartconv_t *cc, const mapped_file_t *m, const crt_chip_t *chips,
+                            const hash_digests_t *digests, unsigned int num, const hash_digests_t *image)
+{
+    cartconv_header_t *h = &cc->extracted_header;
+    const unsigned char *b = m->data;
+    cartconv_chip_t *table;
+    unsigned int i;
+
+    if (m->size < 0x40 || memcmp(b, "C64 CARTRIDGE   ", 16) || (num > 0 && digests == NULL)) {
+        return;
+    }
+    table = realloc(cc->extracted, (num ? num : 1) * sizeof(cartconv_chip_t));
+    if (table == NULL) {
+        return;
+    }
+    cc->extracted = table;
+    h->version = (b[0x14] << 8) | b[0x15];
+    h->id = (b[0x16] << 8) | b[0x17];
+    if (b[0x16] & 0x80) {
+        /* our negative test IDs */
+        h->id -= 0x10000;
+    }
+    h->type = (h->id >= 0 && h->id <= CARTRIDGE_LAST) ? cart_info[h->id].name : "unknown";
+    h->exrom = b[0x18];
+    h->game = b[0x19];
+    h->revision = b[0x1a];
+    memcpy(h->name, b + 0x20, 0x20);
+    h->name[0x20] = 0;
+    h->size = (unsigned long)m->size;
+    h->crc32 = image->crc32;
+    memcpy(h->sha1, image->sha1, SHA1_DIGEST_SIZE);
+    for (i = 0; i < num; i++) {
+        table[i].offset = chips[i].offset;
+        table[i].type = chips[i].type;
+        table[i].bank = chips[i].bank;
+        table[i].start = chips[i].start;
+        table[i].size = chips[i].size;
+        table[i].crc32 = digests[i].crc32;
+        memcpy(table[i].sha1, digests[i].sha1, SHA1_DIGEST_SIZE);
+    }
+    cc->extracted_num = num;
+    cc->extracted_valid = 1;
+}
+
+/* the chip table of the .crt in m, the chips are hashed and written out
+   from the same mapping the header was read from */
+static int printbanks(cartconv_t *cc, const mapped_file_t *m)
+{
+    crt_chip_t *chips = NULL, *c;
+    hash_digests_t *digests = NULL;
+    image_hash_t image;
+    pthread_t image_thread;
+    int image_threaded;
+    int error;
+    char sha1[SHA1_DIGEST_SIZE * 2 + 1];
+    char sha256[SHA256_DIGEST_SIZE * 2 + 1];
+    unsigned int numchips = 0, i;
+    char *typestr[4] = { "ROM", "RAM", "FLASH", "UNK" };
+    unsigned int type;
+    unsigned int numbanks;
+    unsigned long tsize;
+    int result = 0;
+
+    tsize = 0; numbanks = 0;
+
+    image.m = m;
+    image.sha256 = (cc->checksum_filename != NULL);
+    image_threaded = (pthread_create(&image_thread, NULL, image_hash_thread, &image) == 0);
+
+    /* the header and all chips are copied straight from the input file */
+    if (cc->extract_files) {
+        error = copy_file_chunk(cc->extract_dirfd, m, 0, (m->size < 0x40) ? m->size : 0x40, "000_0000_0040_CRT_header");
+        if (error < 0) {
+            copy_file_error(cc, error, "000_0000_0040_CRT_header");
+            result = -1;
+        }
+    }
+
+    /* find the chips first, they are extracted and hashed before the table is
+       printed. a broken last chip is kept for the table only */
+    if (crt_walk_chips(m, 0, &chips, &numchips, &numbanks) < 0) {
+        cc_error(cc, "Error: out of memory.\n");
+        result = -1;
+    }
+    for (i = 0; i < numbanks; i++) {
+        tsize += chips[i].size;
+    }
+
+    if (numbanks > 0) {
+        digests = malloc(numbanks * sizeof(hash_digests_t));
+        if (extract_chips(cc, m, chips, numbanks, digests) < 0) {
+            result = -1;
+        }
+    }
+    if (image_threaded) {
+        pthread_join(image_thread, NULL);
+    } else {
+        image_hash_thread(&image);
+    }
+    image.d.crc32 = image_crc32(m, chips, digests, numbanks);
+
+    fprintf(cc->out, "\noffset  sig  type  bank start size  chunklen crc32    sha1\n");
+    for (i = 0; i < numchips; i++) {
+        c = &chips[i];
+        type = c->type;
+        if (type > 2) {
+            type = 3; /* invalid */
+        }
+        fprintf(cc->out, "$%06lx %-1c%-1c%-1c%-1c %-5s #%03u $%04x $%04x $%04lx",
+                c->offset, c->header[0], c->header[1], c->header[2], c->header[3],
+                typestr[type], c->bank, c->start, c->size, c->length);
+        if (i < numbanks && digests != NULL) {
+            hash_to_hex(digests[i].sha1, SHA1_DIGEST_SIZE, sha1);
+            fprintf(cc->out, "    %08x %s", digests[i].crc32, sha1);
+        }
+        fprintf(cc->out, "\n");
+        if ((c->size + 0x10) > c->length) {
+            fprintf(cc->out, "  Error: data size exceeds chunk length\n");
+        }
+        if (c->length > (m->size - c->offset)) {
+            fprintf(cc->out, "  Error: data size exceeds end of file\n");
+        } else if (c->length == 0) {
+            fprintf(cc->out, "  Error: chunk length is zero\n");
+        }
+    }
+
+    fprintf(cc->out, "\ntotal banks: %u size: $%06lx\n", numbanks, tsize);
+    hash_to_hex(image.d.sha1, SHA1_DIGEST_SIZE, sha1);
+    fprintf(cc->out, "file crc32: %08x sha1: %s\n", image.d.crc32, sha1);
+    if (image.sha256) {
+        hash_to_hex(image.d.sha256, SHA256_DIGEST_SIZE, sha256);
+        fprintf(cc->out, "     sha256: %s\n", sha256);
+    }
+    if (cc->romdb != NULL) {
+        print_romdb(cc, chips, digests, numbanks, &image.d);
+    }
+    save_chip_table(cc, m, chips, digests, numbanks, &image.d);
+
+    if (cc->checksum_filename != NULL) {
+        if (digests == NULL && numbanks > 0) {
+            cc_error(cc, "Error: out of memory.\n");
+            result = -1;
+        } else if (write_checksums(cc, chips, digests, numbanks, &image) < 0) {
+            result = -1;
+        }
+    }
+    free(digests);
+    free(chips);
+    return result;
+}
+
+static int printinfo(cartconv_t *cc, const char *name)
+{
+    int crtid;
+    char *idname, *modename;
+    char cartname[0x20 + 1];
+    char *exrom_warning = NULL;
+    char *game_warning = NULL;
+    mapped_file_t m;
+    const mapped_file_t *in = &m;
+    int result = 0;
+
+    cc->extracted_valid = 0;
+
+    /* the file is mapped once: the header and the chips are decoded from
+       it in place and the payload is only read to hash and write the chips.
+       a .crt that was loaded before under the same name is used as it is */
+    if (cc->loaded && cc->loadfile_is_crt && cc->inmap_name != NULL && !strcmp(cc->inmap_name, name)) {
+        in = &cc->inmap;
+    } else {
+        close_input_file(cc);
+        if (map_input_file(&m, name) < 0) {
+            cc_error(cc, "Error: Can't open %s\n", name);
+            fprintf(cc->out, "Error: this file seems broken.\n\n");
+            return -1;
+        }
+        cc->inmap = m;
+        cc->inmap.fd = -1;
+        cc->inmap.is_mapped = 2;    /* m stays the owner */
+        if (load_mapped_input(cc, name) < 0) {
+            fprintf(cc->out, "Error: this file seems broken.\n\n");
+            result = -1;
+        }
+    }
+    crtid = cc->headerbuffer[0x17] + (cc->headerbuffer[0x16] << 8);
+    if (cc->headerbuffer[0x17] & 0x80) {
+        /* handle our negative test IDs */
+        crtid -= 0x10000;
+    }
+    if ((crtid >= 0) && (crtid <= CARTRIDGE_LAST)) {
+        idname = cart_info[crtid].name;
+    } else {
+        idname = "unknown";
+    }
+    if ((cc->headerbuffer[0x18] == 1) && (cc->headerbuffer[0x19] == 0)) {
+        modename = "ultimax";
+    } else if ((cc->headerbuffer[0x18] == 0) && (cc->headerbuffer[0x19] == 0)) {
+        modename = "16k Game";
+    } else if ((cc->headerbuffer[0x18] == 0) && (cc->headerbuffer[0x19] == 1)) {
+        modename = "8k Game";
+    } else {
+        modename = "?";
+    }
+    if (crtid && cc->headerbuffer[0x18] != cart_info[crtid].exrom) {
+        exrom_warning = "Warning: exrom in crt image set incorrectly.\n";
+    }
+    if (crtid && cc->headerbuffer[0x19] != cart_info[crtid].game) {
+        game_warning = "Warning: game in crt image set incorrectly.\n";
+    }
+    memcpy(cartname, &cc->headerbuffer[0x20], 0x20); cartname[0x20] = 0;
+    fprintf(cc->out, "CRT Version: %d.%d\n", cc->headerbuffer[0x14], cc->headerbuffer[0x15]);
+    fprintf(cc->out, "Name: %s\n", cartname);
+    fprintf(cc->out, "Hardware ID: %d (%s)\n", crtid, idname);
+    fprintf(cc->out, "Hardware Revision: %d\n", cc->headerbuffer[0x1a]);
+    fprintf(cc->out, "Mode: exrom: %d game: %d (%s)\n", cc->headerbuffer[0x18], cc->headerbuffer[0x19], modename);
+    if (exrom_warning) {
+        fprintf(cc->out, "%s", exrom_warning);
+    }
+    if (game_warning) {
+        fprintf(cc->out, "%s", game_warning);
+    }
+    if (printbanks(cc, in) < 0) {
+        result = -1;
+    }
+    if (in == &m) {
+        close_input_file(cc);
+        unmap_input_file(&m);
+    }
+    return result;
+}
+
+/* analyze mode: for every chip the used bytes, the largest free run and the
+   entropy of the data, as a table that can be read by other tools. runs of
+   at least ANALYZE_MIN_RUN $00 or $ff bytes count as free space. the chips
+   are analyzed by several threads like the bank files of printbanks */
+
+#define ANALYZE_MIN_RUN 16
+
+typedef struct bank_stats_s {
+    unsigned int used;              /* bytes outside of free runs */
+    unsigned int free;              /* bytes in free runs */
+    unsigned int free_offset;       /* the largest free run */
+    unsigned int free_length;
+    double entropy;                 /* bits per byte */
+} bank_stats_t;
+
+typedef struct analyze_list_s {
+    const crt_chip_t *chips;
+    bank_stats_t *stats;
+    unsigned int num;
+    unsigned int next;
+    pthread_mutex_t lock;
+} analyze_list_t;
+
+/* offset of the first $00 or $ff byte, size if there is none */
+static unsigned int find_fill_byte(const unsigned char *data, unsigned int size)
+{
+    unsigned int i = 0;
+#if defined(__SSE2__)
+    __m128i v;
+    int mask;
+
+    for (; i + 0x10 <= size; i += 0x10) {
+        v = _mm_loadu_si128((const __m128i *)(data + i));
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()),
+                                              _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xff))));
+        if (mask != 0) {
+            break;
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (data[i] == 0x00 || data[i] == 0xff) {
+            break;
+        }
+    }
+    return i;
+}
+
+/* the number of bytes at the start of data that are equal to value */
+static unsigned int count_run(const unsigned char *data, unsigned int size, unsigned char value)
+{
+    unsigned int i = 0;
+    uint64_t w, pattern = value ? ~(uint64_t)0 : 0;
+#if defined(__SSE2__)
+    __m128i v = _mm_set1_epi8((char)value);
+
+    for (; i + 0x10 <= size; i += 0x10) {
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), v)) != 0xffff) {
+            break;
+        }
+    }
+#endif
+    for (; i + 8 <= size; i += 8) {
+        memcpy(&w, data + i, 8);
+        if (w != pattern) {
+            break;
+        }
+    }
+    for (; i < size; i++) {
+        if (data[i] != value) {
+            break;
+        }
+    }
+    return i;
+}
+
+static void analyze_chip(const unsigned char *data, unsigned int size, bank_stats_t *st)
+{
+    uint32_t hist[4][256];
+    unsigned int i, n, c;
+    double p;
+
+    /* four tables, so that equal bytes next to each other do not wait for each other */
+    memset(hist, 0, sizeof(hist));
+    for (i = 0; i + 4 <= size; i += 4) {
+        hist[0][data[i]]++;
+        hist[1][data[i + 1]]++;
+        hist[2][data[i + 2]]++;
+        hist[3][data[i + 3]]++;
+    }
+    for (; i < size; i++) {
+        hist[0][data[i]]++;
+    }
+    st->entropy = 0.0;
+    for (c = 0; c < 256; c++) {
+        n = hist[0][c] + hist[1][c] + hist[2][c] + hist[3][c];
+        if (n != 0) {
+            p = (double)n / size;
+            st->entropy -= p * log2(p);
+        }
+    }
+
+    st->free = 0;
+    st->free_offset = 0;
+    st->free_length = 0;
+    i = 0;
+    while (i < size) {
+        i += find_fill_byte(data + i, size - i);
+        if (i >= size) {
+            break;
+        }
+        n = count_run(data + i, size - i, data[i]);
+        if (n >= ANALYZE_MIN_RUN) {
+            st->free += n;
+            if (n > st->free_length) {
+                st->free_offset = i;
+                st->free_length = n;
+            }
+        }
+        i += n;
+    }
+    st->used = size - st->free;
+}
+
+static void *analyze_thread(void *arg)
+{
+    analyze_list_t *list = arg;
+    unsigned int i;
+
+    while (1) {
+        pthread_mutex_lock(&list->lock);
+        i = list->next++;
+        pthread_mutex_unlock(&list->lock);
+        if (i >= list->num) {
+            break;
+        }
+        analyze_chip(list->chips[i].data, list->chips[i].avail, &list->stats[i]);
+    }
+    return NULL;
+}
+
+static int analyze_banks(cartconv_t *cc, const char *name)
+{
+    mapped_file_t m;
+    crt_chip_t *chips = NULL;
+    analyze_list_t list;
+    bank_stats_t *st;
+    unsigned int num, complete, i;
+    int result = -1;
+
+    if (map_input_file(&m, name) < 0) {
+        cc_error(cc, "Error: Can't open %s\n", name);
+        return -1;
+    }
+    if (m.size < 0x40 || memcmp(m.data, "C64 CARTRIDGE   ", 16)) {
+        cc_error(cc, "Error: %s is not a .crt file\n", name);
+        unmap_input_file(&m);
+        return -1;
+    }
+
+    /* the same chip walk as printbanks, a chip cut off by the end of the
+       file is analyzed as far as it goes */
+    if (crt_walk_chips(&m, 0, &chips, &num, &complete) < 0) {
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+    if (num > complete && chips[num - 1].length < 0x10) {
+        num--;
+    }
+
+    list.stats = calloc(num ? num : 1, sizeof(bank_stats_t));
+    if (list.stats == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+    list.chips = chips;
+    list.num = num;
+    list.next = 0;
+    pthread_mutex_init(&list.lock, NULL);
+    run_chip_workers(cc, num / 4, analyze_thread, &list);
+    pthread_mutex_destroy(&list.lock);
+
+    fprintf(cc->out, "offset,bank,address,size,used,free,largest_free_address,largest_free_size,entropy\n");
+    for (i = 0; i < num; i++) {
+        st = &list.stats[i];
+        /* missing data at the end of the file counts as free */
+        fprintf(cc->out, "0x%06lx,%u,0x%04x,%u,%u,%u,0x%04x,%u,%.4f\n",
+                chips[i].offset, chips[i].bank, chips[i].start, chips[i].size, st->used,
+                st->free + (chips[i].size - chips[i].avail),
+                (chips[i].start + st->free_offset) & 0xffff, st->free_length, st->entropy);
+    }
+    free(list.stats);
+    result = 0;
+
+out:
+    free(chips);
+    unmap_input_file(&m);
+    return result;
+}
+
+/* catalog mode: one row per .crt file of a dir tree or list file, made of
+   the header and the CHIP headers only. they are read with pread, the
+   payload is skipped, so the files are read by metadata and not by size.
+   the files are done by several threads, the rows are printed in order */
+
+typedef struct catalog_list_s {
+    cartconv_t *cc;
+    char **names;
+    char **rows;                    /* the finished rows, until they are printed */
+    unsigned int num;
+    unsigned int next;              /* the next file to do */
+    unsigned int printed;           /* the next row to print */
+    int format;
+    int failed;
+    pthread_mutex_t lock;
+} catalog_list_t;
+
+static void catalog_string(FILE *f, const char *s, int format)
+{
+    if (format == CARTCONV_CATALOG_JSON) {
+        fputc('"', f);
+        for (; *s; s++) {
+            if (*s == '"' || *s == '\\') {
+                fprintf(f, "\\%c", *s);
+            } else if ((unsigned char)*s < 0x20 || (unsigned char)*s >= 0x7f) {
+                /* PETSCII names are no UTF-8, every byte stays one char */
+                fprintf(f, "\\u%04x", (unsigned char)*s);
+            } else {
+                fputc(*s, f);
+            }
+        }
+        fputc('"', f);
+    } else if (strpbrk(s, ",\"\n\r") != NULL) {
+        fputc('"', f);
+        for (; *s; s++) {
+            if (*s == '"') {
+                fputc('"', f);
+            }
+            fputc(*s, f);
+        }
+        fputc('"', f);
+    } else {
+        fputs(s, f);
+    }
+}
+
+static void catalog_warning(FILE *w, const char *format, ...)
+{
+    va_list ap;
+
+    if (ftell(w) > 0) {
+        fputs("; ", w);
+    }
+    va_start(ap, format);
+    vfprintf(w, format, ap);
+    va_end(ap);
+}
+
+/* the row of one file, NULL if out of memory */
+static char *catalog_file(const char *name, int format, int *failed)
+{
+    unsigned char header[0x40];
+    unsigned char chipheader[0x10];
+    char cartname[0x20 + 1];
+    char *row = NULL, *warnings = NULL;
+    size_t rowlen, warnlen;
+    FILE *f, *w;
+    struct stat st;
+    crt_chip_t chip;
+    unsigned long pos, total = 0;
+    unsigned int chips = 0;
+    int fd, crtid = 0, valid = 0;
+    const char *idname = "";
+
+    f = open_memstream(&row, &rowlen);
+    w = open_memstream(&warnings, &warnlen);
+    if (f == NULL || w == NULL) {
+        if (f != NULL) {
+            fclose(f);
+            free(row);
+        }
+        return NULL;
+    }
+    cartname[0] = 0;
+
+    fd = open(name, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        catalog_warning(w, "can't open file");
+    } else if (pread(fd, header, 0x40, 0) != 0x40 || memcmp(header, "C64 CARTRIDGE   ", 16)) {
+        catalog_warning(w, "not a .crt file");
+    } else {
+        valid = 1;
+        crtid = header[0x17] + (header[0x16] << 8);
+        if (header[0x17] & 0x80) {
+            /* handle our negative test IDs */
+            crtid -= 0x10000;
+        }
+        if ((crtid >= 0) && (crtid <= CARTRIDGE_LAST)) {
+            idname = cart_info[crtid].name;
+            if (crtid && header[0x18] != cart_info[crtid].exrom) {
+                catalog_warning(w, "exrom set incorrectly");
+            }
+            if (crtid && header[0x19] != cart_info[crtid].game) {
+                catalog_warning(w, "game set incorrectly");
+            }
+        } else {
+            idname = "unknown";
+            catalog_warning(w, "unknown hardware id");
+        }
+        memcpy(cartname, &header[0x20], 0x20);
+        cartname[0x20] = 0;
+
+        /* the same chip walk as printbanks, on the CHIP headers only */
+        pos = 0x40;
+        while (pos + 0x10 <= (unsigned long)st.st_size && pread(fd, chipheader, 0x10, (off_t)pos) == 0x10) {
+            crt_decode_chip_header(chipheader, &chip);
+            if (memcmp(chipheader, "CHIP", 4) != 0) {
+                catalog_warning(w, "no CHIP tag at $%06lx", pos);
+                break;
+            }
+            chips++;
+            total += chip.size;
+            if ((chip.size + 0x10) > chip.length) {
+                catalog_warning(w, "chip at $%06lx: data size exceeds chunk length", pos);
+            }
+            if (chip.length > ((unsigned long)st.st_size - pos)) {
+                catalog_warning(w, "chip at $%06lx: data size exceeds end of file", pos);
+                break;
+            } else if (chip.length == 0) {
+                catalog_warning(w, "chip at $%06lx: chunk length is zero", pos);
+                break;
+            }
+            pos += chip.length;
+        }
+        if (pos < (unsigned long)st.st_size && pos + 0x10 > (unsigned long)st.st_size) {
+            catalog_warning(w, "%lu bytes after the last chip", (unsigned long)st.st_size - pos);
+        }
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    fclose(w);
+    if (warnings == NULL) {
+        fclose(f);
+        free(row);
+        return NULL;
+    }
+    if (!valid) {
+        *failed = 1;
+    }
+
+    if (format == CARTCONV_CATALOG_JSON) {
+        fprintf(f, "{\"file\":");
+        catalog_string(f, name, format);
+        if (valid) {
+            fprintf(f, ",\"version\":\"%d.%d\",\"id\":%d,\"type\":", header[0x14], header[0x15], crtid);
+            catalog_string(f, idname, format);
+            fprintf(f, ",\"exrom\":%d,\"game\":%d,\"revision\":%d,\"name\":", header[0x18], header[0x19], header[0x1a]);
+            catalog_string(f, cartname, format);
+            fprintf(f, ",\"chips\":%u,\"size\":%lu", chips, total);
+        }
+        fprintf(f, ",\"warnings\":");
+        catalog_string(f, warnings, format);
+        fprintf(f, "}\n");
+    } else {
+        catalog_string(f, name, format);
+        if (valid) {
+            fprintf(f, ",%d.%d,%d,", header[0x14], header[0x15], crtid);
+            catalog_string(f, idname, format);
+            fprintf(f, ",%d,%d,%d,", header[0x18], header[0x19], header[0x1a]);
+            catalog_string(f, cartname, format);
+            fprintf(f, ",%u,%lu,", chips, total);
+        } else {
+            fprintf(f, ",,,,,,,,,,");
+        }
+        catalog_string(f, warnings, format);
+        fprintf(f, "\n");
+    }
+    free(warnings);
+    if (fclose(f) != 0) {
+        free(row);
+        return NULL;
+    }
+    return row;
+}
+
+static void *catalog_thread(void *arg)
+{
+    catalog_list_t *list = arg;
+    unsigned int i;
+    char *row;
+    int failed = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&list->lock);
+        i = list->next++;
+        pthread_mutex_unlock(&list->lock);
+        if (i >= list->num) {
+            break;
+        }
+        row = catalog_file(list->names[i], list->format, &failed);
+
+        pthread_mutex_lock(&list->lock);
+        if (row == NULL) {
+            /* an empty row keeps the order going */
+            row = strdup("");
+            failed = 1;
+        }
+        list->rows[i] = row;
+        while (list->printed < list->num && list->rows[list->printed] != NULL) {
+            fputs(list->rows[list->printed], list->cc->out);
+            free(list->rows[list->printed]);
+            list->rows[list->printed] = NULL;
+            list->printed++;
+        }
+        if (failed) {
+            list->failed = 1;
+        }
+        pthread_mutex_unlock(&list->lock);
+    }
+    return NULL;
+}
+
+static int catalog_add_name(catalog_list_t *list, unsigned int *max, const char *name)
+{
+    char **names;
+
+    if (list->num == *max) {
+        names = realloc(list->names, (*max ? *max * 2 : 256) * sizeof(char *));
+        if (names == NULL) {
+            cc_error(list->cc, "Error: out of memory.\n");
+            return -1;
+        }
+        list->names = names;
+        *max = *max ? *max * 2 : 256;
+    }
+    if ((list->names[list->num] = strdup(name)) == NULL) {
+        cc_error(list->cc, "Error: out of memory.\n");
+        return -1;
+    }
+    list->num++;
+    return 0;
+}
+
+/* by name, the type char in front does not count */
+static int compare_catalog_names(const void *op1, const void *op2)
+{
+    return strcmp(*(char * const *)op1 + 1, *(char * const *)op2 + 1);
+}
+
+/* all .crt files of a dir tree, in the order of their names. d_type saves
+   the stat of every file */
+static int catalog_scan_dir(cartconv_t *cc, catalog_list_t *list, unsigned int *max, const char *dir)
+{
+    DIR *d;
+    struct dirent *de;
+    struct stat st;
+    char **names = NULL, **p;
+    char *path;
+    const char *ext;
+    unsigned int num = 0, i, isdir;
+    int result = 0;
+
+    d = opendir(dir);
+    if (d == NULL) {
+        cc_error(cc, "Error: Can't open directory %s\n", dir);
+        return -1;
+    }
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+        ext = strrchr(de->d_name, '.');
+        isdir = (de->d_type == DT_DIR || de->d_type == DT_UNKNOWN || de->d_type == DT_LNK);
+        if (!isdir && (ext == NULL || strcasecmp(ext, ".crt"))) {
+            continue;
+        }
+        p = realloc(names, (num + 1) * sizeof(char *));
+        /* the first char tells dirs from files */
+        path = malloc(strlen(dir) + strlen(de->d_name) + 3);
+        if (p == NULL || path == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            free(path);
+            names = p ? p : names;
+            result = -1;
+            break;
+        }
+        names = p;
+        sprintf(path, "%c%s/%s", isdir ? 'd' : 'f', dir, de->d_name);
+        names[num++] = path;
+    }
+    closedir(d);
+    if (num > 0) {
+        qsort(names, num, sizeof(char *), compare_catalog_names);
+    }
+
+    for (i = 0; i < num; i++) {
+        path = names[i] + 1;
+        if (result == 0 && names[i][0] == 'd') {
+            if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+                result = catalog_scan_dir(cc, list, max, path);
+            } else if (stat(path, &st) == 0 && S_ISREG(st.st_mode) && (ext = strrchr(path, '.')) != NULL &&
+                       !strcasecmp(ext, ".crt")) {
+                result = catalog_add_name(list, max, path);
+            }
+        } else if (result == 0) {
+            result = catalog_add_name(list, max, path);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return result;
+}
+
+/* a list file has one name per line */
+static int catalog_read_list(cartconv_t *cc, catalog_list_t *list, unsigned int *max, const char *listname)
+{
+    FILE *f;
+    char line[0x1000];
+    char *p;
+    size_t len;
+    int result = 0;
+
+    f = fopen(listname, "r");
+    if (f == NULL) {
+        cc_error(cc, "Error: Can't open %s\n", listname);
+        return -1;
+    }
+    while (result == 0 && fgets(line, sizeof(line), f) != NULL) {
+        len = strlen(line);
+        while (len > 0 && isspace((unsigned char)line[len - 1])) {
+            line[--len] = 0;
+        }
+        p = line;
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p != 0 && *p != '#') {
+            result = catalog_add_name(list, max, p);
+        }
+    }
+    fclose(f);
+    return result;
+}
+
+static int catalog(cartconv_t *cc, const char *source, int format)
+{
+    catalog_list_t list;
+    struct stat st;
+    unsigned int max = 0, i;
+    const char *ext = strrchr(source, '.');
+    int result;
+
+    memset(&list, 0, sizeof(list));
+    list.cc = cc;
+    list.format = format;
+    if (stat(source, &st) == 0 && S_ISDIR(st.st_mode)) {
+        result = catalog_scan_dir(cc, &list, &max, source);
+    } else if (ext != NULL && !strcasecmp(ext, ".crt")) {
+        result = catalog_add_name(&list, &max, source);
+    } else {
+        result = catalog_read_list(cc, &list, &max, source);
+    }
+    if (result == 0 && list.num > 0 && (list.rows = calloc(list.num, sizeof(char *))) == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        result = -1;
+    }
+    if (result < 0) {
+        goto out;
+    }
+
+    if (format == CARTCONV_CATALOG_CSV) {
+        fprintf(cc->out, "file,version,id,type,exrom,game,revision,name,chips,size,warnings\n");
+    }
+    pthread_mutex_init(&list.lock, NULL);
+    run_chip_workers(cc, list.num, catalog_thread, &list);
+    pthread_mutex_destroy(&list.lock);
+    result = list.failed ? -1 : 0;
+
+out:
+    for (i = 0; i < list.num; i++) {
+        free(list.names[i]);
+    }
+    free(list.names);
+    free(list.rows);
+    return result;
+}
+
+
+/* type detection: one pass over a binary collects the features, then every
+   type that takes the size gets a score from them */
+
+#define DETECT_READ  0x01
+#define DETECT_WRITE 0x02
+
+/* what the code of a binary does with the I/O pages, by the 6502 opcode with
+   an absolute address that comes before $de/$df */
+static const unsigned char detect_opcode[256] = {
+    [0x0d] = DETECT_READ,   /* ora */
+    [0x2c] = DETECT_READ,   /* bit */
+    [0x2d] = DETECT_READ,   /* and */
+    [0xad] = DETECT_READ,   /* lda */
+    [0xae] = DETECT_READ,   /* ldx */
+    [0xac] = DETECT_READ,   /* ldy */
+    [0xbd] = DETECT_READ,   /* lda abs,x */
+    [0xb9] = DETECT_READ,   /* lda abs,y */
+    [0xcd] = DETECT_READ,   /* cmp */
+    [0x8d] = DETECT_WRITE,  /* sta */
+    [0x8e] = DETECT_WRITE,  /* stx */
+    [0x8c] = DETECT_WRITE,  /* sty */
+    [0x9d] = DETECT_WRITE,  /* sta abs,x */
+    [0x99] = DETECT_WRITE,  /* sta abs,y */
+    [0xee] = DETECT_WRITE,  /* inc */
+    [0xce] = DETECT_WRITE   /* dec */
+};
+
+/* the registers a type is known to be switched with. lo is compared under
+   mask, so mask 0 is any access to the page */
+typedef struct detect_hint_s {
+    int id;
+    unsigned char page;     /* 0 for $de00, 1 for $df00 */
+    unsigned char lo;
+    unsigned char mask;
+    unsigned char access;
+    unsigned char weight;
+} detect_hint_t;
+
+static const detect_hint_t detect_hints[] = {
+    {CARTRIDGE_ACTION_REPLAY, 0, 0x00, 0xff, DETECT_WRITE, 15},
+    {CARTRIDGE_KCS_POWER, 1, 0x80, 0xff, DETECT_READ | DETECT_WRITE, 20},
+    {CARTRIDGE_FINAL_III, 1, 0xff, 0xff, DETECT_WRITE, 35},
+    {CARTRIDGE_SIMONS_BASIC, 0, 0x00, 0xff, DETECT_READ | DETECT_WRITE, 15},
+    {CARTRIDGE_OCEAN, 0, 0x00, 0xff, DETECT_WRITE, 20},
+    {CARTRIDGE_FUNPLAY, 0, 0x00, 0xff, DETECT_WRITE, 15},
+    {CARTRIDGE_SUPER_GAMES, 1, 0x00, 0xff, DETECT_WRITE, 30},
+    {CARTRIDGE_ATOMIC_POWER, 0, 0x00, 0xff, DETECT_WRITE, 15},
+    {CARTRIDGE_EPYX_FASTLOAD, 0, 0x00, 0x00, DETECT_READ, 25},
+    {CARTRIDGE_WESTERMANN, 1, 0x00, 0x00, DETECT_READ, 20},
+    {CARTRIDGE_REX, 1, 0xc0, 0xc0, DETECT_READ, 20},
+    {CARTRIDGE_FINAL_I, 0, 0x00, 0x00, DETECT_READ | DETECT_WRITE, 10},
+    {CARTRIDGE_FINAL_I, 1, 0x00, 0x00, DETECT_READ | DETECT_WRITE, 10},
+    {CARTRIDGE_GS, 0, 0x00, 0xff, DETECT_WRITE, 15},
+    {CARTRIDGE_WARPSPEED, 0, 0x00, 0xff, DETECT_WRITE, 10},
+    {CARTRIDGE_WARPSPEED, 1, 0x00, 0xff, DETECT_WRITE, 10},
+    {CARTRIDGE_DINAMIC, 0, 0x00, 0xf0, DETECT_READ, 25},
+    {CARTRIDGE_MAGIC_DESK, 0, 0x00, 0xff, DETECT_WRITE, 20},
+    {CARTRIDGE_COMAL80, 0, 0x00, 0xff, DETECT_WRITE, 20},
+    {CARTRIDGE_STRUCTURED_BASIC, 0, 0x00, 0xfc, DETECT_READ, 20},
+    {CARTRIDGE_ROSS, 0, 0x00, 0x00, DETECT_READ, 10},
+    {CARTRIDGE_ROSS, 1, 0x00, 0x00, DETECT_READ, 10},
+    {CARTRIDGE_STARDOS, 0, 0x00, 0x00, DETECT_READ, 15},
+    {CARTRIDGE_STARDOS, 1, 0x00, 0x00, DETECT_READ, 15},
+    {CARTRIDGE_EASYFLASH, 0, 0x00, 0xff, DETECT_WRITE, 10},
+    {CARTRIDGE_EASYFLASH, 0, 0x02, 0xff, DETECT_WRITE, 30},
+    {CARTRIDGE_RETRO_REPLAY, 0, 0x00, 0xff, DETECT_WRITE, 10},
+    {CARTRIDGE_RETRO_REPLAY, 0, 0x01, 0xff, DETECT_WRITE, 20},
+    {CARTRIDGE_P64, 1, 0x00, 0xff, DETECT_WRITE, 25},
+    {CARTRIDGE_MACH5, 0, 0x00, 0xff, DETECT_WRITE, 10},
+    {CARTRIDGE_MACH5, 1, 0x00, 0xff, DETECT_WRITE, 10},
+    {CARTRIDGE_PAGEFOX, 0, 0x80, 0xff, DETECT_WRITE, 25},
+    {CARTRIDGE_RGCD, 0, 0x00, 0xff, DETECT_WRITE, 20},
+    {CARTRIDGE_GMOD2, 0, 0x00, 0xff, DETECT_WRITE, 20},
+    {CARTRIDGE_GMOD3, 0, 0x00, 0x00, DETECT_WRITE, 15},
+    {0, 0, 0, 0, 0, 0}
+};
+
+typedef struct detect_features_s {
+    unsigned int size;
+    unsigned int reads[2][256];     /* accesses of every register */
+    unsigned int writes[2][256];
+    unsigned int io_writes;
+    int cbm80;                      /* the first bank starts like a $8000 cart */
+    int ultimax;                    /* the end is a reset vector into $e000-$ffff */
+    unsigned int empty_banks;       /* 8KiB banks of only $ff or $00 */
+    unsigned int mirror;            /* the image is this many bytes repeated, 0 if not */
+} detect_features_t;
+
+static void detect_scan(const unsigned char *p, unsigned int size, detect_features_t *f)
+{
+    static const unsigned char cbm80[5] = {0xc3, 0xc2, 0xcd, 0x38, 0x30};
+    unsigned int i, n, m;
+    unsigned char a;
+
+    memset(f, 0, sizeof(detect_features_t));
+    f->size = size;
+
+    /* the smallest power of 2 part that repeats to the whole image */
+    for (m = size / 2; m >= 0x800 && (size % m) == 0 && !memcmp(p, p + m, size - m); m /= 2) {
+        f->mirror = m;
+    }
+
+    /* the single pass over the code, of a mirrored image only the part that
+       repeats: every $de/$df byte is the high byte of an absolute address if
+       the byte two before is an opcode that takes one */
+    n = f->mirror ? f->mirror : size;
+    for (i = 2; i < n; i++) {
+        if ((p[i] & 0xfe) == 0xde) {
+            a = detect_opcode[p[i - 2]];
+            if (a == DETECT_READ) {
+                f->reads[p[i] & 1][p[i - 1]]++;
+            } else if (a == DETECT_WRITE) {
+                f->writes[p[i] & 1][p[i - 1]]++;
+                f->io_writes++;
+            }
+        }
+    }
+
+    f->cbm80 = (size >= 9 && !memcmp(p + 4, cbm80, 5));
+    if (size >= 0x800) {
+        n = p[size - 4] | (p[size - 3] << 8);
+        f->ultimax = (n >= 0xe000 && n != 0xffff);
+    }
+
+    for (i = 0; i + 0x2000 <= size; i += 0x2000) {
+        for (n = 1; n < 0x2000 && p[i + n] == p[i]; n++) {
+        }
+        if (n == 0x2000 && (p[i] == 0xff || p[i] == 0x00)) {
+            f->empty_banks++;
+        }
+    }
+}
+
+static int detect_score(const detect_features_t *f, int id, int ultimax)
+{
+    const cart_t *info = &cart_info[id];
+    const detect_hint_t *h;
+    unsigned int lo, n, hits, padded, sizes;
+    int score, hinted = 0;
+
+    sizes = (id == CARTRIDGE_CRT && ultimax) ? (CARTRIDGE_SIZE_2KB | CARTRIDGE_SIZE_4KB | CARTRIDGE_SIZE_8KB | CARTRIDGE_SIZE_16KB) : info->sizes;
+    padded = cart_pad_size(sizes, f->size);
+    if (padded == 0) {
+        return 0;
+    }
+    score = (padded == f->size) ? 35 : 10;
+    if (sizes == f->size) {
+        score += 10;
+    }
+
+    if (id != CARTRIDGE_CRT) {
+        ultimax = (info->load_address == 0xe000 || (info->exrom && !info->game));
+    }
+    if (ultimax) {
+        score += f->ultimax ? 15 : -10;
+    } else {
+        score += f->cbm80 ? 15 : (f->ultimax ? -15 : 0);
+    }
+
+    /* data looks like code by chance now and then, but not over and over
+       at the same register. so a hint for a range of registers takes two
+       accesses of one of them */
+    for (h = detect_hints; h->weight != 0; h++) {
+        if (h->id != id) {
+            continue;
+        }
+        hits = 0;
+        for (lo = 0; lo < 256; lo++) {
+            if ((lo & h->mask) == h->lo) {
+                n = ((h->access & DETECT_READ) ? f->reads[h->page][lo] : 0) +
+                    ((h->access & DETECT_WRITE) ? f->writes[h->page][lo] : 0);
+                hits = (n > hits) ? n : hits;
+            }
+        }
+        if (hits >= ((h->mask == 0xff) ? 1u : 2u)) {
+            hinted += h->weight;
+        }
+    }
+    score += (hinted > 40) ? 40 : hinted;
+
+    if (id == CARTRIDGE_CRT) {
+        /* a plain rom does not switch anything */
+        score += (f->io_writes == 0) ? 10 : -5;
+    } else {
+        /* special hardware does not repeat one rom, more likely a small
+           generic rom was dumped from a bigger chip */
+        if (f->mirror != 0) {
+            score -= 15;
+        }
+        /* the banks of a bigger cart are switched by some code */
+        if (padded > CARTRIDGE_SIZE_16KB && hinted == 0 && f->io_writes == 0) {
+            score -= 15;
+        }
+        if (padded > CARTRIDGE_SIZE_16KB && f->empty_banks > 0 && (info->flags & CART_OMIT_EMPTY)) {
+            score += 5;
+        }
+    }
+    return (score < 0) ? 0 : (score > 100) ? 100 : score;
+}
+
+static int compare_guesses(const void *op1, const void *op2)
+{
+    const cartconv_guess_t *p1 = (const cartconv_guess_t *)op1;
+    const cartconv_guess_t *p2 = (const cartconv_guess_t *)op2;
+
+    if (p1->score != p2->score) {
+        return p2->score - p1->score;
+    }
+    return p1->id - p2->id;
+}
+
+static void detect_add(cartconv_guess_t *all, unsigned int *num, int id, const char *opt, const char *name, int score)
+{
+    if (score > 0) {
+        all[*num].id = id;
+        all[*num].opt = opt;
+        all[*num].name = name;
+        all[*num].score = score;
+        (*num)++;
+    }
+}
+
+static int detect_type(cartconv_t *cc, const char *name, cartconv_guess_t *guesses, int max)
+{
+    const cart_registry_t *r = get_cart_registry();
+    cartconv_guess_t all[CARTRIDGE_LAST + 2];
+    detect_features_t *f;
+    mapped_file_t m;
+    unsigned int i, num = 0, size, offset = 0;
+    int id;
+
+    if (map_input_file(&m, name) < 0) {
+        cc_error(cc, "Error: Can't open %s\n", name);
+        return -1;
+    }
+    /* a .crt file already knows its type */
+    if (m.size >= 0x40 && !memcmp(m.data, "C64 CARTRIDGE   ", 16)) {
+        id = (m.data[0x16] << 8) | m.data[0x17];
+        if (m.data[0x16] & 0x80) {
+            /* our negative test IDs */
+            id -= 0x10000;
+        }
+        if (id == CARTRIDGE_CRT) {
+            detect_add(all, &num, id, "normal", cart_info[id].name, 100);
+        } else if (id > 0 && id <= CARTRIDGE_LAST) {
+            /* some types can't be made with -t, they go by their name */
+            detect_add(all, &num, id, cart_info[id].opt ? cart_info[id].opt : cart_info[id].name, cart_info[id].name, 100);
+        } else if (id == CARTRIDGE_ULTIMAX) {
+            detect_add(all, &num, id, "ulti", "Ultimax", 100);
+        } else if (id == CARTRIDGE_GENERIC_8KB || id == CARTRIDGE_GENERIC_16KB) {
+            detect_add(all, &num, id, "normal", cart_info[CARTRIDGE_CRT].name, 100);
+        } else {
+            detect_add(all, &num, id, "unknown", "unknown", 100);
+        }
+        goto out;
+    }
+    if (m.size > CARTRIDGE_SIZE_MAX + 2) {
+        cc_error(cc, "Error: %s is too big for a cart\n", name);
+        unmap_input_file(&m);
+        return -1;
+    }
+    /* like load_mapped_input, a .prg load address is skipped */
+    size = (unsigned int)m.size;
+    if ((size & 0x7ff) == 2) {
+        offset = 2;
+        size -= 2;
+    }
+    f = malloc(sizeof(detect_features_t));
+    if (f == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        unmap_input_file(&m);
+        return -1;
+    }
+    detect_scan(m.data + offset, size, f);
+
+    detect_add(all, &num, CARTRIDGE_CRT, "normal", cart_info[CARTRIDGE_CRT].name, detect_score(f, CARTRIDGE_CRT, 0));
+    detect_add(all, &num, CARTRIDGE_CRT, "ulti", "Ultimax", detect_score(f, CARTRIDGE_CRT, 1));
+    for (i = 0; i < r->convertible_num; i++) {
+        id = r->convertible[i];
+        detect_add(all, &num, id, cart_info[id].opt, cart_info[id].name, detect_score(f, id, 0));
+    }
+    free(f);
+    qsort(all, num, sizeof(cartconv_guess_t), compare_guesses);
+
+out:
+    unmap_input_file(&m);
+    if (num > (unsigned int)max) {
+        num = (unsigned int)max;
+    }
+    memcpy(guesses, all, num * sizeof(cartconv_guess_t));
+    return (int)num;
+}
+
+
+static int too_many_inputs(cartconv_t *cc)
+{
+    cc_error(cc, "Error: too many input files\n");
+    return -1;
+}
+
+
+/* this walks the chips of an easyflash cart, the banks get put into the
+   buffer in the interleaved way only when they are needed (see get_load_data) */
+static int load_easyflash_crt(cartconv_t *cc)
+{
+    crt_chip_t chip;
+    unsigned long pos = 0x40;
+
+    while (1) {
+        if (crt_decode_chip(&cc->inmap, pos, &chip) < 0) {
+            if (cc->loadfile_size == 0) {
+                return -1;
+            } else {
+                return 0;
+            }
+        }
+        cc->loadfile_size = 0x100000;
+        if (memcmp(chip.header, "CHIP", 4) != 0) {
+            return -1;
+        }
+        if (cc->load_address == 0) {
+            cc->load_address = (int)chip.start;
+        }
+        /* easyflash chips are always 8KiB, the next CHIP header directly follows the data */
+        if ((cc->inmap.size - (pos + 0x10)) < 0x2000) {
+            return -1;
+        }
+        if (crt_add_chip(cc, &chip) < 0) {
+            return -1;
+        }
+        pos += 0x2010;
+    }
+}
+
+static int load_all_banks(cartconv_t *cc)
+{
+    crt_chip_t chip;
+    unsigned long pos = 0x40;
+    unsigned long pad;
+    unsigned int loadsize;
+
+    if (cc->loadfile_cart_type == CARTRIDGE_EASYFLASH) {
+        return load_easyflash_crt(cc);
+    }
+
+    while (1) {
+        /* get CHIP header */
+        if (crt_decode_chip(&cc->inmap, pos, &chip) < 0) {
+            if (cc->loadfile_size == 0) {
+                cc_error(cc, "Error: could not read data from file.\n");
+                return -1;
+            } else {
+                return 0;
+            }
+        }
+        if (crt_check_chip(cc, &chip, &loadsize) < 0) {
+            return -1;
+        }
+        /* set load address to the load address of first CHIP in the file. this is not quite
+           correct, but works ok for the few cases when it matters */
+        if (cc->load_address == 0) {
+            cc->load_address = (int)chip.start;
+        }
+        if ((cc->loadfile_size + chip.size) > CARTRIDGE_SIZE_MAX) {
+            cc_error(cc, "Error: data exceeds the maximum cartridge size.\n");
+            return -1;
+        }
+        /* check the data is all there, it is not copied anywhere */
+        if (chip.avail < loadsize) {
+            if (cc->repair_mode) {
+                cc_error(cc, "Warning: unexpected end of file.\n");
+                if (crt_add_chip(cc, &chip) < 0) {
+                    return -1;
+                }
+                cc->loadfile_size += chip.size;
+                break;
+            }
+            cc_error(cc, "Error: could not read data from file. (use -r to force)\n");
+            return -1;
+        }
+        chip.avail = loadsize;
+        if (crt_add_chip(cc, &chip) < 0) {
+            return -1;
+        }
+        /* if the chunk is larger than the contained data+chip header, skip the rest */
+        if (chip.length > (chip.size + 0x10)) {
+            pad = chip.length - (chip.size + 0x10);
+            cc_error(cc, "Warning: chunk length exceeds data size (data:%04x chunk:%04lx), skipping %04lx bytes.\n", chip.size, chip.length, pad);
+        }
+        pos += (chip.length > 0x10) ? chip.length : 0x10 + loadsize;
+        cc->loadfile_size += chip.size;
+    }
+    return 0;
+}
+
+/* make cc->filebuffer hold at least size bytes, it only grows as far as the
+   largest cart converted with the context needs */
+static int alloc_filebuffer(cartconv_t *cc, unsigned int size)
+{
+    int moved = (cc->loaddata != NULL && cc->loaddata == cc->filebuffer);
+    unsigned char *p;
+
+    /* the buffer is going to change under the pending chips */
+    flush_crt_output(cc);
+    if (size <= cc->filebuffer_size) {
+        return 0;
+    }
+    p = realloc(cc->filebuffer, size);
+    if (p == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        return -1;
+    }
+    cc->filebuffer = p;
+    cc->filebuffer_size = size;
+    if (moved) {
+        cc->loaddata = p;
+    }
+    return 0;
+}
+
+/* returns the data of the loaded input file as one contiguous block. the banks
+   of a .crt file are only copied into cc->filebuffer when they are really needed in
+   one piece, a single CHIP packet is used directly from the mapped file */
+static const unsigned char *get_load_data(cartconv_t *cc)
+{
+    unsigned int i;
+    unsigned int pos = 0;
+    const crt_chip_t *chip;
+
+    if (cc->loaddata != NULL) {
+        return cc->loaddata;
+    }
+
+    if (cc->loadfile_cart_type != CARTRIDGE_EASYFLASH && cc->crtchips_num == 1 &&
+        cc->crtchips[0].avail == cc->crtchips[0].size && cc->crtchips[0].size == cc->loadfile_size) {
+        cc->loaddata = cc->crtchips[0].data;
+        cc->loaddata_end = cc->loadfile_size;
+        return cc->loaddata;
+    }
+
+    if (alloc_filebuffer(cc, cc->loadfile_size) < 0) {
+        return NULL;
+    }
+    /* only the holes are filled with 0xff, like empty eproms */
+    if (cc->loadfile_cart_type == CARTRIDGE_EASYFLASH) {
+        for (i = 0; i < 0x80; i++) {
+            chip = crt_find_chip(cc, i >> 1, i & 1);
+            if (chip != NULL) {
+                memcpy(cc->filebuffer + (i * 0x2000), chip->data, 0x2000);
+            } else {
+                memset(cc->filebuffer + (i * 0x2000), 0xff, 0x2000);
+            }
+        }
+    } else {
+        for (i = 0; i < cc->crtchips_num; i++) {
+            chip = &cc->crtchips[i];
+            memset(cc->filebuffer + pos, 0xff, chip->binpos - pos);
+            memcpy(cc->filebuffer + chip->binpos, chip->data, chip->avail);
+            memset(cc->filebuffer + chip->binpos + chip->avail, 0xff, chip->size - chip->avail);
+            pos = chip->binpos + chip->size;
+        }
+        memset(cc->filebuffer + pos, 0xff, cc->loadfile_size - pos);
+    }
+    cc->loaddata = cc->filebuffer;
+    cc->loaddata_end = cc->loadfile_size;
+    return cc->loaddata;
+}
+
+/* a binary that is shorter than the cart is padded with 0xff, the padding
+   is never stored, it is only produced where the data is written or copied */
+static void pad_load_data(cartconv_t *cc, unsigned int size)
+{
+    cc->loaddata_end = (unsigned int)cc->loadfile_offset + size;
+}
+
+/* how much of the next length bytes at cc->loadfile_offset is real data */
+static unsigned int load_data_avail(cartconv_t *cc, unsigned int length)
+{
+    unsigned int offset = (unsigned int)cc->loadfile_offset;
+
+    if (offset >= cc->loaddata_end) {
+        return 0;
+    }
+    return (cc->loaddata_end - offset < length) ? cc->loaddata_end - offset : length;
+}
+
+/* copy length bytes of the load data at cc->loadfile_offset, padded with 0xff */
+static int copy_load_data(cartconv_t *cc, unsigned char *dest, unsigned int length)
+{
+    const unsigned char *data;
+    unsigned int n;
+
+    flush_crt_output(cc);
+    data = get_load_data(cc);
+    if (data == NULL) {
+        return -1;
+    }
+    n = load_data_avail(cc, length);
+    memmove(dest, data + cc->loadfile_offset, n);
+    memset(dest + n, 0xff, length - n);
+    return 0;
+}
+
+/* 1 if all bytes are 0xff. the data is and'ed together in blocks and only
+   checked once per block, so the scan runs at memory speed */
+static int is_empty_data(const unsigned char *data, unsigned int size)
+{
+    unsigned int i = 0;
+    unsigned int j;
+    uint64_t w;
+
+#if defined(__SSE2__)
+    __m128i acc;
+
+    for (; i + 0x100 <= size; i += 0x100) {
+        acc = _mm_loadu_si128((const __m128i *)(data + i));
+        for (j = 0x10; j < 0x100; j += 0x10) {
+            acc = _mm_and_si128(acc, _mm_loadu_si128((const __m128i *)(data + i + j)));
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_set1_epi8((char)0xff))) != 0xffff) {
+            return 0;
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16_t acc;
+
+    for (; i + 0x100 <= size; i += 0x100) {
+        acc = vld1q_u8(data + i);
+        for (j = 0x10; j < 0x100; j += 0x10) {
+            acc = vandq_u8(acc, vld1q_u8(data + i + j));
+        }
+        if (vminvq_u8(acc) != 0xff) {
+            return 0;
+        }
+    }
+#endif
+    for (; i + 8 <= size; i += 8) {
+        memcpy(&w, data + i, 8);
+        if (w != ~(uint64_t)0) {
+            return 0;
+        }
+    }
+    for (j = i; j < size; j++) {
+        if (data[j] != 0xff) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* 1 if the next bank is all 0xff and can be left out of the .crt, this is
+   only done for the types that work with missing banks */
+static int omit_empty_bank(cartconv_t *cc, unsigned int length)
+{
+    const unsigned char *data;
+
+    if (!cc->omit_empty_banks || !(cart_info[(unsigned char)cc->cart_type].flags & CART_OMIT_EMPTY)) {
+        return 0;
+    }
+    data = get_load_data(cc);
+    if (data == NULL) {
+        return 0;
+    }
+    /* the padding behind the real data is empty anyway */
+    return is_empty_data(data + cc->loadfile_offset, load_data_avail(cc, length));
+}
+
+static int write_fill(FILE *f, unsigned int length)
+{
+    unsigned char fill[0x1000];
+    unsigned int n;
+
+    if (length == 0) {
+        return 0;
+    }
+    memset(fill, 0xff, sizeof(fill));
+    while (length > 0) {
+        n = (length > sizeof(fill)) ? (unsigned int)sizeof(fill) : length;
+        if (fwrite(fill, 1, n, f) != n) {
+            return -1;
+        }
+        length -= n;
+    }
+    return 0;
+}
+
+/* write length bytes of the load data at cc->loadfile_offset, padded with 0xff */
+static int write_load_data(cartconv_t *cc, FILE *f, unsigned int length)
+{
+    const unsigned char *data = get_load_data(cc);
+    unsigned int n;
+
+    if (data == NULL) {
+        return -1;
+    }
+    n = load_data_avail(cc, length);
+    if (fwrite(data + cc->loadfile_offset, 1, n, f) != n) {
+        return -1;
+    }
+    return write_fill(f, length - n);
+}
+
+/* write the banks of the loaded .crt file in binary form, straight from the mapped file */
+static int write_crt_data(cartconv_t *cc, FILE *f)
+{
+    const crt_chip_t *chip;
+    unsigned int i;
+    unsigned int pos = 0;
+
+    if (cc->loaddata != NULL) {
+        return write_load_data(cc, f, cc->loadfile_size);
+    }
+
+    if (cc->loadfile_cart_type == CARTRIDGE_EASYFLASH) {
+        for (i = 0; i < 0x80; i++) {
+            chip = crt_find_chip(cc, i >> 1, i & 1);
+            if (chip == NULL) {
+                if (write_fill(f, 0x2000) < 0) {
+                    return -1;
+                }
+            } else if (fwrite(chip->data, 1, 0x2000, f) != 0x2000) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    for (i = 0; i < cc->crtchips_num; i++) {
+        chip = &cc->crtchips[i];
+        if (write_fill(f, chip->binpos - pos) < 0) {
+            return -1;
+        }
+        if (fwrite(chip->data, 1, chip->avail, f) != chip->avail) {
+            return -1;
+        }
+        if (write_fill(f, chip->size - chip->avail) < 0) {
+            return -1;
+        }
+        pos = chip->binpos + chip->size;
+    }
+    return write_fill(f, cc->loadfile_size - pos);
+}
+
+/*
+ static int save_banks_to_file(void) {
+    
+    return -1;
+}
+ */
+
+/* "-" writes the output to stdout */
+static FILE *open_output_file(cartconv_t *cc)
+{
+    int fd;
+    FILE *f;
+
+    if (cc->outstream != NULL) {
+        return cc->outstream;
+    }
+    if (!strcmp(cc->output_filename, "-")) {
+        fd = dup(cc->outfd);
+        if (fd < 0) {
+            return NULL;
+        }
+        f = fdopen(fd, "wb");
+        if (f == NULL) {
+            close(fd);
+        }
+        return f;
+    }
+    return fopen(cc->output_filename, "wb");
+}
+
+static void remove_output_file(cartconv_t *cc)
+{
+    if (cc->outstream == NULL && strcmp(cc->output_filename, "-")) {
+        unlink(cc->output_filename);
+    }
+}
+
+/* the .crt output. a new file is written under a temporary name next to the
+   output and renamed when it is complete, so the output name never refers
+   to a half written file. devices and the like are written directly */
+static int open_crt_output(cartconv_t *cc)
+{
+    crt_output_t *out = &cc->crtout;
+    struct stat st;
+    const char *name;
+    size_t len;
+    int i, exists;
+
+    abort_crt_output(cc);
+    out->failed = 0;
+    out->header_pending = 0;
+    out->parts_num = 0;
+    out->fd = -1;
+    out->tmpname = NULL;
+    out->target = NULL;
+    out->remove = 0;
+    cc->outfile = NULL;
+
+    if (cc->outstream != NULL) {
+        cc->outfile = cc->outstream;
+    } else if (!strcmp(cc->output_filename, "-")) {
+        out->fd = dup(cc->outfd);
+    } else {
+        /* a symlink stays, the file it points to is replaced. a dangling
+           one is written through below */
+        name = cc->output_filename;
+        if (lstat(name, &st) == 0 && S_ISLNK(st.st_mode)) {
+            out->target = realpath(name, NULL);
+            name = out->target;
+        }
+        exists = (name != NULL && stat(name, &st) == 0);
+        if (name != NULL && (!exists || S_ISREG(st.st_mode))) {
+            len = strlen(name) + 32;
+            out->tmpname = malloc(len);
+            for (i = 0; out->tmpname != NULL && i < 100; i++) {
+                snprintf(out->tmpname, len, "%s.%lx-%lx-%d", name,
+                         (unsigned long)getpid(), (unsigned long)(uintptr_t)cc & 0xffffff, i);
+                out->fd = open(out->tmpname, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+                if (out->fd >= 0 || errno != EEXIST) {
+                    break;
+                }
+            }
+            if (out->fd < 0) {
+                /* e.g. a directory without write access */
+                free(out->tmpname);
+                out->tmpname = NULL;
+            } else if (exists) {
+                /* the new file gets the owner and mode of the old one, the
+                   owner only where we may */
+                if (fchown(out->fd, st.st_uid, st.st_gid) < 0) {
+                    errno = 0;
+                }
+                fchmod(out->fd, st.st_mode & 07777);
+            }
+        }
+        if (out->fd < 0) {
+            out->fd = open(cc->output_filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            out->remove = (out->fd >= 0 && fstat(out->fd, &st) == 0 && S_ISREG(st.st_mode));
+        }
+    }
+    if (out->fd < 0 && cc->outfile == NULL) {
+        return -1;
+    }
+    out->open = 1;
+    return 0;
+}
+
+/* write the header and the chips collected so far */
+static void flush_crt_output(cartconv_t *cc)
+{
+    crt_output_t *out = &cc->crtout;
+    crt_part_t *p;
+    struct iovec *iov;
+    unsigned int i, n, num, fill;
+
+    if (!out->open || out->failed || (out->parts_num == 0 && !out->header_pending)) {
+        return;
+    }
+
+    /* the header and data of every chip and pieces of the $ff padding */
+    num = 1;
+    fill = 0;
+    for (i = 0; i < out->parts_num; i++) {
+        p = &out->parts[i];
+        num += 2 + ((p->size - p->avail + CRT_FILL_SIZE - 1) / CRT_FILL_SIZE);
+        fill |= p->size - p->avail;
+    }
+    if (num > out->iov_max) {
+        iov = realloc(out->iov, num * sizeof(struct iovec));
+        if (iov == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            out->failed = 1;
+            return;
+        }
+        out->iov = iov;
+        out->iov_max = num;
+    }
+    if (fill != 0 && out->fill == NULL) {
+        out->fill = malloc(CRT_FILL_SIZE);
+        if (out->fill == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            out->failed = 1;
+            return;
+        }
+        memset(out->fill, 0xff, CRT_FILL_SIZE);
+    }
+
+    iov = out->iov;
+    n = 0;
+    if (out->header_pending) {
+        iov[n].iov_base = out->header;
+        iov[n++].iov_len = 0x40;
+    }
+    for (i = 0; i < out->parts_num; i++) {
+        p = &out->parts[i];
+        iov[n].iov_base = p->header;
+        iov[n++].iov_len = 0x10;
+        if (p->avail > 0) {
+            iov[n].iov_base = (void *)p->data;
+            iov[n++].iov_len = p->avail;
+        }
+        for (fill = p->size - p->avail; fill > 0; fill -= iov[n++].iov_len) {
+            iov[n].iov_base = out->fill;
+            iov[n].iov_len = (fill > CRT_FILL_SIZE) ? CRT_FILL_SIZE : fill;
+        }
+    }
+
+    if (out->fd >= 0) {
+        if (writev_all(out->fd, iov, n) < 0) {
+            out->failed = 1;
+        }
+    } else {
+        for (i = 0; i < n && !out->failed; i++) {
+            if (fwrite(iov[i].iov_base, 1, iov[i].iov_len, cc->outfile) != iov[i].iov_len) {
+                out->failed = 1;
+            }
+        }
+    }
+    if (out->failed) {
+        cc_error(cc, "Error: Can't write to file %s\n", cc->output_filename);
+    }
+    out->header_pending = 0;
+    out->parts_num = 0;
+}
+
+/* drop the output, a temporary file is removed and an existing output file
+   is left alone */
+static void abort_crt_output(cartconv_t *cc)
+{
+    crt_output_t *out = &cc->crtout;
+
+    if (!out->open) {
+        return;
+    }
+    out->open = 0;
+    out->parts_num = 0;
+    out->header_pending = 0;
+    if (out->fd < 0) {
+        fclose(cc->outfile);
+    } else {
+        close(out->fd);
+        if (out->tmpname != NULL) {
+            unlink(out->tmpname);
+        } else if (out->remove) {
+            remove_output_file(cc);
+        }
+    }
+    free(out->tmpname);
+    out->tmpname = NULL;
+    free(out->target);
+    out->target = NULL;
+}
+
+static int close_crt_output(cartconv_t *cc)
+{
+    crt_output_t *out = &cc->crtout;
+    int result;
+
+    flush_crt_output(cc);
+    if (out->failed) {
+        abort_crt_output(cc);
+        return -1;
+    }
+    out->open = 0;
+    if (out->fd < 0) {
+        result = fclose(cc->outfile);
+    } else {
+        result = close(out->fd);
+        if (result == 0 && out->tmpname != NULL) {
+            result = rename(out->tmpname, (out->target != NULL) ? out->target : cc->output_filename);
+        }
+        if (result < 0 && out->tmpname != NULL) {
+            unlink(out->tmpname);
+        }
+    }
+    free(out->tmpname);
+    out->tmpname = NULL;
+    free(out->target);
+    out->target = NULL;
+    if (result != 0) {
+        cc_error(cc, "Error: Can't write to file %s\n", cc->output_filename);
+        return -1;
+    }
+    return 0;
+}
+
+/* write a whole .crt image given as pieces, through the same temporary
+   file as the converted output */
+static int write_crt_output(cartconv_t *cc, struct iovec *iov, unsigned int num)
+{
+    crt_output_t *out = &cc->crtout;
+    unsigned int i;
+
+    if (open_crt_output(cc) < 0) {
+        cc_error(cc, "Error: Can't open output file %s\n", cc->output_filename);
+        return -1;
+    }
+    if (out->fd >= 0) {
+        if (writev_all(out->fd, iov, num) < 0) {
+            out->failed = 1;
+        }
+    } else {
+        for (i = 0; i < num && !out->failed; i++) {
+            if (fwrite(iov[i].iov_base, 1, iov[i].iov_len, cc->outfile) != iov[i].iov_len) {
+                out->failed = 1;
+            }
+        }
+    }
+    if (out->failed) {
+        cc_error(cc, "Error: Can't write to file %s\n", cc->output_filename);
+        abort_crt_output(cc);
+        return -1;
+    }
+    return close_crt_output(cc);
+}
+
+static void crt2bin_ok(cartconv_t *cc)
+{
+    if (!cc->quiet_mode) {
+        fprintf(cc->out, "Input file : %s\n", cc->input_filename[0]);
+        fprintf(cc->out, "Output file : %s\n", cc->output_filename);
+        fprintf(cc->out, "Conversion from %s .crt to binary format successful.\n", cart_info[cc->loadfile_cart_type].name);
+    }
+}
+
+static int save_binary_output_file(cartconv_t *cc)
+{
+    unsigned char address_buffer[2];
+
+    cc->outfile = open_output_file(cc);
+    if (cc->outfile == NULL) {
+        cc_error(cc, "Error: Can't open output file %s\n", cc->output_filename);
+        return -1;
+    }
+    if (cc->convert_to_prg == 1) {
+        address_buffer[0] = (unsigned char)(cc->load_address & 0xff);
+        address_buffer[1] = (unsigned char)(cc->load_address >> 8);
+        if (fwrite(address_buffer, 1, 2, cc->outfile) != 2) {
+            cc_error(cc, "Error: Can't write to file %s\n", cc->output_filename);
+            fclose(cc->outfile);
+            return -1;
+        }
+    }
+    if (write_crt_data(cc, cc->outfile) < 0) {
+        cc_error(cc, "Error: Can't write to file %s\n", cc->output_filename);
+        fclose(cc->outfile);
+        return -1;
+    }
+    fclose(cc->outfile);
+    crt2bin_ok(cc);
+    return 0;
+}
+
+/* copy length bytes from one stream to the other, returns the amount copied */
+static unsigned int stream_copy(FILE *in, FILE *out, unsigned int length)
+{
+    unsigned char buffer[0x4000];
+    unsigned int done = 0;
+    size_t n, want;
+
+    while (done < length) {
+        want = ((length - done) > sizeof(buffer)) ? sizeof(buffer) : (length - done);
+        n = fread(buffer, 1, want, in);
+        if (n == 0) {
+            break;
+        }
+        if (out != NULL && fwrite(buffer, 1, n, out) != n) {
+            break;
+        }
+        done += (unsigned int)n;
+    }
+    return done;
+}
+
+/* convert a .crt file to binary while reading it strictly forward (a pipe).
+   every chip is written out as soon as it has been read, only easyflash
+   carts have to be collected because of the interleaved bank order */
+static int stream_crt_to_bin(cartconv_t *cc, FILE *in)
+{
+    unsigned char b[0x10];
+    crt_chip_t chip;
+    unsigned int loadsize, done, pos;
+    unsigned int firstsize = 0;
+    unsigned long key, lastkey = 0;
+    unsigned char address_buffer[2];
+    int left_out = 0;
+    int result = 0;
+
+    if (fread(cc->headerbuffer, 1, 16, in) != 16) {
+        cc_error(cc, "Error: Can't read %s\n", cc->input_filename[0]);
+        return -1;
+    }
+    if (memcmp("C64 CARTRIDGE   ", cc->headerbuffer, 16)) {
+        cc_error(cc, "Error: File is already in binary format\n");
+        return -1;
+    }
+    if (fread(cc->headerbuffer + 0x10, 1, 0x30, in) != 0x30) {
+        cc_error(cc, "Error: Can't read the full header of %s\n", cc->input_filename[0]);
+        return -1;
+    }
+    if (check_crt_header(cc, cc->input_filename[0]) < 0) {
+        return -1;
+    }
+    cc->loadfile_is_crt = 1;
+    cc->loadfile_size = 0;
+
+    cc->outfile = open_output_file(cc);
+    if (cc->outfile == NULL) {
+        cc_error(cc, "Error: Can't open output file %s\n", cc->output_filename);
+        return -1;
+    }
+    if (cc->loadfile_cart_type == CARTRIDGE_EASYFLASH) {
+        /* 1MiB plus room for a bank beyond it */
+        if (alloc_filebuffer(cc, 0x100000 + 0x2000) < 0) {
+            fclose(cc->outfile);
+            remove_output_file(cc);
+            return -1;
+        }
+        memset(cc->filebuffer, 0xff, 0x100000);
+    }
+
+    while (fread(b, 1, 0x10, in) == 0x10) {
+        crt_decode_chip_header(b, &chip);
+        if (crt_check_chip(cc, &chip, &loadsize) < 0) {
+            result = -1;
+            break;
+        }
+        if (cc->load_address == 0) {
+            cc->load_address = (int)chip.start;
+        }
+        if (cc->loadfile_size == 0 && cc->convert_to_prg == 1) {
+            address_buffer[0] = (unsigned char)(cc->load_address & 0xff);
+            address_buffer[1] = (unsigned char)(cc->load_address >> 8);
+            if (fwrite(address_buffer, 1, 2, cc->outfile) != 2) {
+                result = -2;
+                break;
+            }
+        }
+        if (cc->loadfile_cart_type == CARTRIDGE_EASYFLASH) {
+            cc->loadfile_size = 0x100000;
+            pos = ((chip.bank & 0xff) * 0x4000) + (((chip.start >> 8) == 0x80) ? 0 : 0x2000);
+            /* banks outside of the 1MiB are read into the spare space behind it */
+            if (fread(cc->filebuffer + ((pos < 0x100000) ? pos : 0x100000), 1, 0x2000, in) != 0x2000) {
+                result = -1;
+                break;
+            }
+            continue;
+        }
+        if ((cc->loadfile_size + chip.size) > CARTRIDGE_SIZE_MAX) {
+            cc_error(cc, "Error: data exceeds the maximum cartridge size.\n");
+            result = -1;
+            break;
+        }
+        /* the data is written as it comes, which only gives the right layout if the chips are sorted */
+        key = (crt_bank_key(cc, chip.bank) << 16) | chip.start;
+        if (cc->loadfile_size > 0 && key < lastkey) {
+            cc_error(cc, "Error: the chips of %s are not in bank order, it can not be converted as a stream.\n", cc->input_filename[0]);
+            result = -3;
+            break;
+        }
+        lastkey = key;
+        /* the banks left out of a sparse cart are filled in */
+        if (crt_is_sparse(cc->loadfile_cart_type) && (chip.size == firstsize || firstsize == 0) &&
+            crt_bank_key(cc, chip.bank) * chip.size > cc->loadfile_size) {
+            pos = crt_bank_key(cc, chip.bank) * chip.size;
+            if (write_fill(cc->outfile, pos - cc->loadfile_size) < 0) {
+                result = -2;
+                break;
+            }
+            cc->loadfile_size = pos;
+            left_out = 1;
+        }
+        if (firstsize == 0) {
+            firstsize = chip.size;
+        }
+        done = stream_copy(in, cc->outfile, loadsize);
+        cc->loadfile_size += chip.size;
+        if (done < loadsize) {
+            if (cc->repair_mode) {
+                cc_error(cc, "Warning: unexpected end of file.\n");
+                write_fill(cc->outfile, chip.size - done);
+            } else {
+                cc_error(cc, "Error: could not read data from file. (use -r to force)\n");
+                result = -1;
+            }
+            break;
+        }
+        if (write_fill(cc->outfile, chip.size - loadsize) < 0) {
+            result = -2;
+            break;
+        }
+        /* if the chunk is larger than the contained data+chip header, skip the rest */
+        if (chip.length > (chip.size + 0x10)) {
+            cc_error(cc, "Warning: chunk length exceeds data size (data:%04x chunk:%04lx), skipping %04lx bytes.\n",
+                    chip.size, chip.length, chip.length - (chip.size + 0x10));
+            stream_copy(in, NULL, (unsigned int)(chip.length - (chip.size + 0x10)));
+        }
+    }
+    if (result == 0 && cc->loadfile_size == 0) {
+        cc_error(cc, "Error: could not read data from file.\n");
+        result = -1;
+    }
+    if (result == -1) {
+        if (cc->repair_mode) {
+            cc_error(cc, "Warning: Can't load all banks of %s\n", cc->input_filename[0]);
+            result = 0;
+        } else {
+            cc_error(cc, "Error: Can't load all banks of %s (use -r to force)\n", cc->input_filename[0]);
+        }
+    }
+    if (result == 0 && cc->loadfile_cart_type == CARTRIDGE_EASYFLASH) {
+        if (fwrite(cc->filebuffer, 1, cc->loadfile_size, cc->outfile) != cc->loadfile_size) {
+            result = -2;
+        }
+    }
+    if (result == 0 && crt_is_sparse(cc->loadfile_cart_type)) {
+        pos = crt_sparse_size(cc->loadfile_cart_type, cc->loadfile_size, left_out);
+        if (write_fill(cc->outfile, pos - cc->loadfile_size) < 0) {
+            result = -2;
+        }
+        cc->loadfile_size = pos;
+    }
+    if (result == -2) {
+        cc_error(cc, "Error: Can't write to file %s\n", cc->output_filename);
+    }
+    fclose(cc->outfile);
+    if (result < 0) {
+        remove_output_file(cc);
+        return -1;
+    }
+    crt2bin_ok(cc);
+    return 0;
+}
+
+static int write_crt_header(cartconv_t *cc, unsigned char gameline, unsigned char exromline)
+{
+    unsigned char crt_header[0x40] = "C64 CARTRIDGE   ";
+    int endofname = 0;
+    int i;
+
+    /* header length */
+    crt_header[0x10] = 0;
+    crt_header[0x11] = 0;
+    crt_header[0x12] = 0;
+    crt_header[0x13] = 0x40;
+
+    crt_header[0x14] = 1;   /* crt version high */
+    /* crt version low */
+    if (cc->cart_subtype > 0) {
+        crt_header[0x15] = 1;
+    } else {
+        crt_header[0x15] = 0;
+    }
+
+    crt_header[0x16] = 0;   /* cart type high */
+    crt_header[0x17] = (unsigned char)cc->cart_type;
+
+    crt_header[0x18] = exromline;
+    crt_header[0x19] = gameline;
+
+    crt_header[0x1a] = cc->cart_subtype;
+    
+    /* unused/reserved */
+    crt_header[0x1b] = 0;
+    crt_header[0x1c] = 0;
+    crt_header[0x1d] = 0;
+    crt_header[0x1e] = 0;
+    crt_header[0x1f] = 0;
+
+    if (cc->cart_name == NULL) {
+        cc->cart_name = strdup("VICE CART");
+    }
+
+    for (i = 0; i < 32; i++) {
+        if (endofname == 1) {
+            crt_header[0x20 + i] = 0;
+        } else {
+            if (cc->cart_name[i] == 0) {
+                endofname = 1;
+            } else {
+                crt_header[0x20 + i] = (unsigned char)toupper((int)cc->cart_name[i]);
+            }
+        }
+    }
+
+    if (open_crt_output(cc) < 0) {
+        cc_error(cc, "Error: Can't open output file %s\n", cc->output_filename);
+        return -1;
+    }
+    memcpy(cc->crtout.header, crt_header, 0x40);
+    cc->crtout.header_pending = 1;
+    return 0;
+}
+
+static int write_chip_package(cartconv_t *cc, unsigned int length, unsigned int bank, unsigned int address, unsigned char type)
+{
+    unsigned char chip_header[0x10] = "CHIP";
+    const unsigned char *data;
+    crt_part_t *p;
+    unsigned int max;
+
+    chip_header[4] = 0;
+    chip_header[5] = 0;
+    chip_header[6] = (unsigned char)((length + 0x10) >> 8);
+    chip_header[7] = (unsigned char)((length + 0x10) & 0xff);
+
+    chip_header[8] = 0;
+    chip_header[9] = type;
+
+    chip_header[0xa] = (unsigned char)(bank >> 8);
+    chip_header[0xb] = (unsigned char)(bank & 0xff);
+
+    chip_header[0xc] = (unsigned char)(address >> 8);
+    chip_header[0xd] = (unsigned char)(address & 0xff);
+
+    chip_header[0xe] = (unsigned char)(length >> 8);
+    chip_header[0xf] = (unsigned char)(length & 0xff);
+
+    data = get_load_data(cc);
+    if (data == NULL) {
+        abort_crt_output(cc);
+        return -1;
+    }
+    if (cc->crtout.parts_num == cc->crtout.parts_max) {
+        max = cc->crtout.parts_max ? cc->crtout.parts_max * 2 : 64;
+        p = realloc(cc->crtout.parts, max * sizeof(crt_part_t));
+        if (p == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            abort_crt_output(cc);
+            return -1;
+        }
+        cc->crtout.parts = p;
+        cc->crtout.parts_max = max;
+    }
+    p = &cc->crtout.parts[cc->crtout.parts_num++];
+    memcpy(p->header, chip_header, 0x10);
+    p->data = data + cc->loadfile_offset;
+    p->avail = load_data_avail(cc, length);
+    p->size = length;
+    cc->loadfile_offset += (int)length;
+    return 0;
+}
+
+static void bin2crt_ok(cartconv_t *cc)
+{
+    if (!cc->quiet_mode) {
+        fprintf(cc->out, "Input file : %s\n", cc->input_filename[0]);
+        fprintf(cc->out, "Output file : %s\n", cc->output_filename);
+        fprintf(cc->out, "Conversion from binary format to %s .crt successful.\n",
+               cart_info[(unsigned char)cc->cart_type].name);
+    }
+}
+
+/* the chips of a layout for the loaded binary in the order of the .crt, the
+   offsets are relative to the start of the binary. returns the number of
+   chips, 0 if there are none and -1 if out of memory */
+static int plan_layout(cartconv_t *cc, const cart_t *info, const cart_layout_t *layout, unsigned int binsize)
+{
+    const layout_run_t *run;
+    layout_chip_t *chip;
+    unsigned int count, size, i, j, num = 0, offset = 0;
+    int pass;
+
+    /* count first, then fill in */
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            if (num > cc->layout_chips_max) {
+                chip = realloc(cc->layout_chips, num * sizeof(layout_chip_t));
+                if (chip == NULL) {
+                    cc_error(cc, "Error: out of memory.\n");
+                    return -1;
+                }
+                cc->layout_chips = chip;
+                cc->layout_chips_max = num;
+            }
+            num = 0;
+            offset = 0;
+        }
+        for (run = layout->runs; run->bank_step != 0; run++) {
+            count = run->count ? run->count : info->banks;
+            size = run->size ? run->size : info->bank_size;
+            if (count == 0) {
+                /* handle the case when a chip of half/4th the regular size
+                   is used on an otherwise identical hardware (eg 2k/4k
+                   chip on a 8k cart)
+                */
+                if (binsize - offset == (size / 2)) {
+                    size /= 2;
+                } else if (binsize - offset == (size / 4)) {
+                    size /= 4;
+                }
+                count = (binsize - offset) / size;
+            }
+            for (i = 0; i < count; i++) {
+                for (j = 0; j < (run->hi_address ? 2u : 1u); j++) {
+                    if (pass == 1) {
+                        chip = &cc->layout_chips[num];
+                        chip->offset = offset;
+                        chip->size = size;
+                        chip->bank = run->bank + i * run->bank_step;
+                        chip->address = j ? run->hi_address : (run->address ? run->address : info->load_address);
+                    }
+                    num++;
+                    offset += size;
+                }
+            }
+        }
+    }
+    return (int)num;
+}
+
+/* write the chips of the layout of the type: the whole .crt is planned
+   first, then the chips are queued on the output and written in one go */
+static int write_layout(cartconv_t *cc, const cart_layout_t *layout, unsigned char game, unsigned char exrom, unsigned int data_type)
+{
+    const cart_t *info = &cart_info[(unsigned char)cc->cart_type];
+    const layout_chip_t *chip;
+    unsigned int base, end, size, i;
+    int num;
+
+    layout = find_layout(layout, cc->loadfile_size);
+    num = plan_layout(cc, info, layout, cc->loadfile_size);
+    if (num < 0) {
+        return -1;
+    }
+    if (layout->game >= 0) {
+        game = (unsigned char)layout->game;
+        exrom = (unsigned char)layout->exrom;
+    }
+    if (layout->chip_type >= 0) {
+        data_type = (unsigned int)layout->chip_type;
+    }
+    if (write_crt_header(cc, game, exrom) < 0) {
+        return -1;
+    }
+
+    end = num ? cc->layout_chips[num - 1].offset + cc->layout_chips[num - 1].size : 0;
+    if ((layout->flags & LAYOUT_AT_2000) && cc->loadfile_size < end && end > 0x2000) {
+        /* what does not fit behind $2000 is cut off, like the old cart did */
+        size = (cc->loadfile_size < end - 0x2000) ? cc->loadfile_size : end - 0x2000;
+        if (get_load_data(cc) == NULL || alloc_filebuffer(cc, end) < 0 ||
+            copy_load_data(cc, cc->filebuffer + 0x2000, size) < 0) {
+            abort_crt_output(cc);
+            return -1;
+        }
+        memset(cc->filebuffer, 0xff, 0x2000);
+        memset(cc->filebuffer + 0x2000 + size, 0xff, end - 0x2000 - size);
+        cc->loaddata = cc->filebuffer;
+        cc->loaddata_end = end;
+        cc->loadfile_offset = 0;
+    }
+
+    base = (unsigned int)cc->loadfile_offset;
+    for (i = 0; i < (unsigned int)num; i++) {
+        chip = &cc->layout_chips[i];
+        cc->loadfile_offset = (int)(base + chip->offset);
+        /* with LAYOUT_OMIT_ENDS the first chip is kept because the cart
+           starts from it, the last one so the size of the cart is still known */
+        if (((layout->flags & LAYOUT_OMIT_ANY) ||
+             ((layout->flags & LAYOUT_OMIT_ENDS) && i > 0 && i < (unsigned int)num - 1)) &&
+            omit_empty_bank(cc, chip->size)) {
+            continue;
+        }
+        if (write_chip_package(cc, chip->size, chip->bank, chip->address, (unsigned char)data_type) < 0) {
+            return -1;
+        }
+    }
+    if (close_crt_output(cc) < 0) {
+        return -1;
+    }
+    bin2crt_ok(cc);
+    return 0;
+}
+
+static int save_layout_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char game, unsigned char exrom)
+{
+    return write_layout(cc, cart_info[(unsigned char)cc->cart_type].layout, game, exrom, p4);
+}
+
+/* check the .crt header in cc->headerbuffer */
+static int check_crt_header(cartconv_t *cc, const char *filename)
+{
+    if (cc->headerbuffer[0x10] != 0 || cc->headerbuffer[0x11] != 0 || cc->headerbuffer[0x12] != 0 || cc->headerbuffer[0x13] != 0x40) {
+        cc_error(cc, "Error: Illegal header size in %s\n", filename);
+        if (!cc->repair_mode) {
+            return -1;
+        }
+    }
+    if (cc->headerbuffer[0x18] == 1 && cc->headerbuffer[0x19] == 0) {
+        cc->loadfile_is_ultimax = 1;
+    } else {
+        cc->loadfile_is_ultimax = 0;
+    }
+
+    cc->loadfile_cart_type = cc->headerbuffer[0x17] + (cc->headerbuffer[0x16] << 8);
+    if (cc->headerbuffer[0x17] & 0x80) {
+        /* handle our negative test IDs */
+        cc->loadfile_cart_type -= 0x10000;
+    }
+    if (!((cc->loadfile_cart_type >= 0) && (cc->loadfile_cart_type <= CARTRIDGE_LAST))) {
+        cc_error(cc, "Error: Unknown CRT ID: %d\n", cc->loadfile_cart_type);
+        return -1;
+    }
+    return 0;
+}
+
+static int load_input_file(cartconv_t *cc, const char *filename)
+{
+    cc->loadfile_offset = 0;
+    close_input_file(cc);
+    if (map_input_file(&cc->inmap, filename) < 0) {
+        cc_error(cc, "Error: Can't open %s\n", filename);
+        return -1;
+    }
+    return load_mapped_input(cc, filename);
+}
+
+/* parse the input that is in cc->inmap, filename is only used for messages */
+static int load_mapped_input(cartconv_t *cc, const char *filename)
+{
+    int result;
+
+    cc->loadfile_offset = 0;
+    /* check first 16 bytes */
+    if (cc->inmap.size < 16) {
+        cc_error(cc, "Error: Can't read %s\n", filename);
+        close_input_file(cc);
+        return -1;
+    }
+    if (!memcmp("C64 CARTRIDGE   ", cc->inmap.data, 16)) {
+        cc->loadfile_is_crt = 1;
+        if (cc->inmap.size < 0x40) {
+            cc_error(cc, "Error: Can't read the full header of %s\n", filename);
+            close_input_file(cc);
+            return -1;
+        }
+        /* the header is decoded in place, only the 0x40 bytes are kept for printinfo */
+        memcpy(cc->headerbuffer, cc->inmap.data, 0x40);
+        if (check_crt_header(cc, filename) < 0) {
+            close_input_file(cc);
+            return -1;
+        }
+
+        cc->loadfile_size = 0;
+        result = load_all_banks(cc);
+        if (crt_index_chips(cc) < 0) {
+            close_input_file(cc);
+            return -1;
+        }
+        if (result < 0) {
+            if (cc->repair_mode) {
+                cc_error(cc, "Warning: Can't load all banks of %s\n", filename);
+                return 0;
+            } else {
+                cc_error(cc, "Error: Can't load all banks of %s (use -r to force)\n", filename);
+                close_input_file(cc);
+                return -1;
+            }
+        } else {
+            return 0;
+        }
+    } else {
+        cc->loadfile_is_crt = 0;
+        /* the binary is used directly from the mapped file */
+        cc->loaddata = cc->inmap.data;
+        if (cc->inmap.size > (CARTRIDGE_SIZE_MAX + 2)) {
+            cc->loadfile_size = CARTRIDGE_SIZE_MAX + 2;
+        } else {
+            cc->loadfile_size = (unsigned int)cc->inmap.size;
+        }
+        cc->loaddata_end = cc->loadfile_size;
+
+        switch (cc->loadfile_size) {
+            case CARTRIDGE_SIZE_2KB:
+            case CARTRIDGE_SIZE_4KB:
+            case CARTRIDGE_SIZE_8KB:
+            case CARTRIDGE_SIZE_12KB:
+            case CARTRIDGE_SIZE_16KB:
+            case CARTRIDGE_SIZE_20KB:
+            case CARTRIDGE_SIZE_24KB:
+            case CARTRIDGE_SIZE_32KB:
+            case CARTRIDGE_SIZE_64KB:
+            case CARTRIDGE_SIZE_96KB:
+            case CARTRIDGE_SIZE_128KB:
+            case CARTRIDGE_SIZE_256KB:
+            case CARTRIDGE_SIZE_512KB:
+            case CARTRIDGE_SIZE_1024KB:
+            case CARTRIDGE_SIZE_2048KB:
+            case CARTRIDGE_SIZE_4096KB:
+            case CARTRIDGE_SIZE_8192KB:
+            case CARTRIDGE_SIZE_16384KB:
+                cc->loadfile_offset = 0;
+                return 0;
+                break;
+            case CARTRIDGE_SIZE_2KB + 2:
+            case CARTRIDGE_SIZE_4KB + 2:
+            case CARTRIDGE_SIZE_8KB + 2:
+            case CARTRIDGE_SIZE_12KB + 2:
+            case CARTRIDGE_SIZE_16KB + 2:
+            case CARTRIDGE_SIZE_20KB + 2:
+            case CARTRIDGE_SIZE_24KB + 2:
+            case CARTRIDGE_SIZE_32KB + 2:
+            case CARTRIDGE_SIZE_64KB + 2:
+            case CARTRIDGE_SIZE_96KB + 2:
+            case CARTRIDGE_SIZE_128KB + 2:
+            case CARTRIDGE_SIZE_256KB + 2:
+            case CARTRIDGE_SIZE_512KB + 2:
+            case CARTRIDGE_SIZE_1024KB + 2:
+            case CARTRIDGE_SIZE_2048KB + 2:
+            case CARTRIDGE_SIZE_4096KB + 2:
+            case CARTRIDGE_SIZE_8192KB + 2:
+            case CARTRIDGE_SIZE_16384KB + 2:
+                cc->loadfile_size -= 2;
+                cc->loadfile_offset = 2;
+                return 0;
+                break;
+            case CARTRIDGE_SIZE_32KB + 4:
+                cc->loadfile_size -= 4;
+                cc->loadfile_offset = 4;
+                return 0;
+                break;
+            default:
+                if (cc->input_padding) {
+                    return 0;
+                }
+                cc_error(cc, "Error: Illegal file size of %s\n", filename);
+                close_input_file(cc);
+                return -1;
+        }
+    }
+}
+
+static int close_output_cleanup(cartconv_t *cc)
+{
+    abort_crt_output(cc);
+    return -1;
+}
+
+static int save_delaep64_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char p5, unsigned char p6)
+{
+    unsigned int i;
+
+    if (cc->loadfile_size != CARTRIDGE_SIZE_8KB) {
+        cc_error(cc, "Error: wrong size of Dela EP64 base file %s (%u)\n",
+                cc->input_filename[0], cc->loadfile_size);
+        return -1;
+    }
+
+    if (write_crt_header(cc, 1, 0) < 0) {
+        return -1;
+    }
+
+    /* write base file */
+    if (write_chip_package(cc, 0x2000, 0, 0x8000, 0) < 0) {
+        return -1;
+    }
+
+    if (cc->input_filenames > 1) {
+        /* write user eproms */
+        for (i = 1; i < cc->input_filenames; i++) {
+            if (load_input_file(cc, cc->input_filename[i]) < 0) {
+                return close_output_cleanup(cc);
+            }
+            if (cc->loadfile_is_crt == 1) {
+                cc_error(cc, "Error: to be inserted file can only be a binary for Dela EP64\n");
+                return close_output_cleanup(cc);
+            }
+            if (cc->loadfile_size != CARTRIDGE_SIZE_32KB) {
+                cc_error(cc, "Error: to be inserted file can only be 32KiB in size for Dela EP64\n");
+                return close_output_cleanup(cc);
+            }
+            if (write_chip_package(cc, 0x8000, i, 0x8000, 0) < 0) {
+                return close_output_cleanup(cc);
+            }
+        }
+    }
+
+    if (close_crt_output(cc) < 0) {
+        return -1;
+    }
+    bin2crt_ok(cc);
+    return 0;
+}
+
+static int save_delaep256_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char p5, unsigned char p6)
+{
+    unsigned int i, j;
+    unsigned int insert_size = 0;
+
+    if (cc->loadfile_size != CARTRIDGE_SIZE_8KB) {
+        cc_error(cc, "Error: wrong size of Dela EP256 base file %s (%u)\n",
+                cc->input_filename[0], cc->loadfile_size);
+        return -1;
+    }
+
+    if (cc->input_filenames == 1) {
+        cc_error(cc, "Error: no files to insert into Dela EP256 .crt\n");
+        return -1;
+    }
+
+    if (write_crt_header(cc, 1, 0) < 0) {
+        return -1;
+    }
+
+    if (write_chip_package(cc, 0x2000, 0, 0x8000, 0) < 0) {
+        return -1;
+    }
+
+    for (i = 0; i < (unsigned int)cc->input_filenames - 1; i++) {
+        if (load_input_file(cc, cc->input_filename[i + 1]) < 0) {
+            return close_output_cleanup(cc);
+        }
+
+        if (cc->loadfile_size != CARTRIDGE_SIZE_32KB && cc->loadfile_size != CARTRIDGE_SIZE_8KB) {
+            cc_error(cc, "Error: only 32KiB binary files or 8KiB bin/crt files can be inserted in Dela EP256\n");
+            return close_output_cleanup(cc);
+        }
+
+        if (insert_size == 0) {
+            insert_size = cc->loadfile_size;
+        }
+
+        if (insert_size == CARTRIDGE_SIZE_32KB && cc->input_filenames > 8) {
+            cc_error(cc, "Error: a maximum of 8 32KiB images can be inserted\n");
+            return close_output_cleanup(cc);
+        }
+
+        if (insert_size != cc->loadfile_size) {
+            cc_error(cc, "Error: only one type of insertion is allowed at this time for Dela EP256\n");
+            return close_output_cleanup(cc);
+        }
+
+        if (cc->loadfile_is_crt == 1 && (cc->loadfile_size != CARTRIDGE_SIZE_8KB || cc->load_address != 0x8000 || cc->loadfile_is_ultimax == 1)) {
+            cc_error(cc, "Error: you can only insert generic 8KiB .crt files for Dela EP256\n");
+            return close_output_cleanup(cc);
+        }
+
+        if (insert_size == CARTRIDGE_SIZE_32KB) {
+            for (j = 0; j < 4; j++) {
+                if (write_chip_package(cc, 0x2000, (i * 4) + j + 1, 0x8000, 0) < 0) {
+                    return close_output_cleanup(cc);
+                }
+            }
+            if (!cc->quiet_mode) {
+                fprintf(cc->out, "inserted %s in banks %u-%u of the Dela EP256 .crt\n",
+                        cc->input_filename[i + 1], (i * 4) + 1, (i * 4) + 4);
+            }
+        } else {
+            if (write_chip_package(cc, 0x2000, i + 1, 0x8000, 0) < 0) {
+                return close_output_cleanup(cc);
+            }
+            if (!cc->quiet_mode) {
+                fprintf(cc->out, "inserted %s in bank %u of the Dela EP256 .crt\n",
+                        cc->input_filename[i + 1], i + 1);
+            }
+        }
+    }
+
+    if (close_crt_output(cc) < 0) {
+        return -1;
+    }
+    bin2crt_ok(cc);
+    return 0;
+}
+
+static int save_delaep7x8_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char p5, unsigned char p6)
+{
+    int inserted_size = 0;
+    int name_counter = 1;
+    unsigned int chip_counter = 1;
+
+    if (cc->loadfile_size != CARTRIDGE_SIZE_8KB) {
+        cc_error(cc, "Error: wrong size of Dela EP7x8 base file %s (%u)\n",
+                cc->input_filename[0], cc->loadfile_size);
+        return -1;
+    }
+
+    if (cc->input_filenames == 1) {
+        cc_error(cc, "Error: no files to insert into Dela EP7x8 .crt\n");
+        return -1;
+    }
+
+    if (write_crt_header(cc, 1, 0) < 0) {
+        return -1;
+    }
+
+    if (write_chip_package(cc, 0x2000, 0, 0x8000, 0) < 0) {
+        return -1;
+    }
+
+    while (name_counter != cc->input_filenames) {
+        if (load_input_file(cc, cc->input_filename[name_counter]) < 0) {
+            return close_output_cleanup(cc);
+        }
+
+        if (cc->loadfile_size == CARTRIDGE_SIZE_32KB) {
+            if (cc->loadfile_is_crt == 1) {
+                cc_error(cc, "Error: (%s) only binary 32KiB images can be inserted into a Dela EP7x8 .crt\n",
+                        cc->input_filename[name_counter]);
+                return close_output_cleanup(cc);
+            } else {
+                if (inserted_size != 0) {
+                    cc_error(cc, "Error: (%s) only the first inserted image can be a 32KiB image for Dela EP7x8\n",
+                            cc->input_filename[name_counter]);
+                    return close_output_cleanup(cc);
+                } else {
+                    if (write_chip_package(cc, 0x2000, chip_counter, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                    }
+                    if (write_chip_package(cc, 0x2000, chip_counter + 1, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                    }
+                    if (write_chip_package(cc, 0x2000, chip_counter + 2, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                    }
+                    if (write_chip_package(cc, 0x2000, chip_counter + 3, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                    }
+                    if (!cc->quiet_mode) {
+                        fprintf(cc->out, "inserted %s in banks %u-%u of the Dela EP7x8 .crt\n",
+                               cc->input_filename[name_counter], chip_counter,
+                               chip_counter + 3);
+                    }
+                    chip_counter += 4;
+                    inserted_size += 0x8000;
+                }
+            }
+        }
+
+        if (cc->loadfile_size == CARTRIDGE_SIZE_16KB) {
+            if (cc->loadfile_is_crt == 1 && (cc->loadfile_cart_type != 0 || cc->loadfile_is_ultimax == 1)) {
+                cc_error(cc, "Error: (%s) only generic 16KiB .crt images can be inserted into a Dela EP7x8 .crt\n",
+                        cc->input_filename[name_counter]);
+                return close_output_cleanup(cc);
+            } else {
+                if (inserted_size >= 0xc000) {
+                    cc_error(cc, "Error: (%s) no room to insert a 16KiB binary file into the Dela EP7x8 .crt\n",
+                            cc->input_filename[name_counter]);
+                    return close_output_cleanup(cc);
+                } else {
+                    if (write_chip_package(cc, 0x2000, chip_counter, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                    }
+                    if (write_chip_package(cc, 0x2000, chip_counter + 1, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                    }
+                    if (!cc->quiet_mode) {
+                        fprintf(cc->out, "inserted %s in banks %u and %u of the Dela EP7x8 .crt\n",
+                               cc->input_filename[name_counter], chip_counter, chip_counter + 1);
+                    }
+                    chip_counter += 2;
+                    inserted_size += 0x4000;
+                }
+            }
+        }
+
+        if (cc->loadfile_size == CARTRIDGE_SIZE_8KB) {
+            if (cc->loadfile_is_crt == 1 && (cc->loadfile_cart_type != 0 || cc->loadfile_is_ultimax == 1)) {
+                cc_error(cc, "Error: (%s) only generic 8KiB .crt images can be inserted into a Dela EP7x8 .crt\n",
+                        cc->input_filename[name_counter]);
+                return close_output_cleanup(cc);
+            } else {
+                if (inserted_size >= 0xe000) {
+                    cc_error(cc, "Error: (%s) no room to insert a 8KiB binary file into the Dela EP7x8 .crt\n",
+                            cc->input_filename[name_counter]);
+                    return close_output_cleanup(cc);
+                } else {
+                    if (write_chip_package(cc, 0x2000, chip_counter, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                    }
+                    if (!cc->quiet_mode) {
+                        fprintf(cc->out, "inserted %s in bank %u of the Dela EP7x8 .crt\n",
+                                cc->input_filename[name_counter], chip_counter);
+                    }
+                    chip_counter++;
+                    inserted_size += 0x2000;
+                }
+            }
+        }
+
+        name_counter++;
+    }
+
+    if (close_crt_output(cc) < 0) {
+        return -1;
+    }
+    bin2crt_ok(cc);
+    return 0;
+}
+
+static int save_rexep256_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char p5, unsigned char p6)
+{
+    int eprom_size_for_8kb = 0;
+    int images_of_8kb_started = 0;
+    int name_counter = 1;
+    unsigned int chip_counter = 1;
+    int subchip_counter = 1;
+
+    if (cc->loadfile_size != CARTRIDGE_SIZE_8KB) {
+        cc_error(cc, "Error: wrong size of Rex EP256 base file %s (%u)\n",
+                cc->input_filename[0], cc->loadfile_size);
+        return -1;
+    }
+
+    if (cc->input_filenames == 1) {
+        cc_error(cc, "Error: no files to insert into Rex EP256 .crt\n");
+        return -1;
+    }
+
+    if (write_crt_header(cc, 1, 0) < 0) {
+        return -1;
+    }
+
+    if (write_chip_package(cc, 0x2000, 0, 0x8000, 0) < 0) {
+        return -1;
+    }
+
+    while (name_counter != cc->input_filenames) {
+        if (load_input_file(cc, cc->input_filename[name_counter]) < 0) {
+            return close_output_cleanup(cc);
+        }
+
+        if (chip_counter > 8) {
+            cc_error(cc, "Error: no more room for %s in the Rex EP256 .crt\n", cc->input_filename[name_counter]);
+        }
+
+        if (cc->loadfile_size == CARTRIDGE_SIZE_32KB) {
+            if (cc->loadfile_is_crt == 1) {
+                cc_error(cc, "Error: (%s) only binary 32KiB images can be inserted into a Rex EP256 .crt\n",
+                        cc->input_filename[name_counter]);
+                return close_output_cleanup(cc);
+            } else {
+                if (images_of_8kb_started != 0) {
+                    cc_error(cc, "Error: (%s) only the first inserted images can be a 32KiB image for Rex EP256\n",
+                            cc->input_filename[name_counter]);
+                    return close_output_cleanup(cc);
+                } else {
+                    if (write_chip_package(cc, 0x8000, chip_counter, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                    }
+                    if (!cc->quiet_mode) {
+                        fprintf(cc->out, "inserted %s in bank %u as a 32KiB eprom of the Rex EP256 .crt\n",
+                               cc->input_filename[name_counter], chip_counter);
+                    }
+                    chip_counter++;
+                }
+            }
+        }
+
+        if (cc->loadfile_size == CARTRIDGE_SIZE_8KB) {
+            if (cc->loadfile_is_crt == 1 && (cc->loadfile_cart_type != 0 || cc->loadfile_is_ultimax == 1)) {
+                cc_error(cc, "Error: (%s) only generic 8KiB .crt images can be inserted into a Rex EP256 .crt\n",
+                        cc->input_filename[name_counter]);
+                return close_output_cleanup(cc);
+            } else {
+                if (images_of_8kb_started == 0) {
+                    images_of_8kb_started = 1;
+                    if ((9 - chip_counter) * 4 < (unsigned int)(cc->input_filenames - name_counter)) {
+                        cc_error(cc, "Error: no room for the amount of input files given\n");
+                        return close_output_cleanup(cc);
+                    }
+                    eprom_size_for_8kb = 1;
+                    if ((9 - chip_counter) * 2 < (unsigned int)(cc->input_filenames - name_counter)) {
+                        eprom_size_for_8kb = 4;
+                    }
+                    if (9 - chip_counter < (unsigned int)(cc->input_filenames - name_counter)) {
+                        eprom_size_for_8kb = 2;
+                    }
+                }
+
+                if (eprom_size_for_8kb == 1) {
+                    if (write_chip_package(cc, 0x2000, chip_counter, 0x8000, 0) < 0) {
+                        return close_output_cleanup(cc);
+                        if (!cc->quiet_mode) {
+                            fprintf(cc->out, "inserted %s as an 8KiB eprom in bank %u of the Rex EP256 .crt\n",
+                                   cc->input_filename[name_counter], chip_counter);
+                        }
+                        chip_counter++;
+                    }
+
+                    if (eprom_size_for_8kb == 4 && (subchip_counter == 4 || name_counter == cc->input_filenames - 1)) {
+                        copy_load_data(cc, cc->extra_buffer_32kb + ((subchip_counter - 1) * 0x2000), 0x2000);
+                        cc->loaddata = cc->extra_buffer_32kb;
+                        cc->loaddata_end = sizeof(cc->extra_buffer_32kb);
+                        cc->loadfile_offset = 0;
+                        if (write_chip_package(cc, 0x8000, chip_counter, 0x8000, 0) < 0) {
+                            return close_output_cleanup(cc);
+                        }
+                        if (!cc->quiet_mode) {
+                            if (subchip_counter == 1) {
+                                fprintf(cc->out, "inserted %s as a 32KiB eprom in bank %u of the Rex EP256 .crt\n",
+                                       cc->input_filename[name_counter], chip_counter);
+                            } else {
+                                fprintf(cc->out, " and %s as a 32KiB eprom in bank %u of the Rex EP256 .crt\n",
+                                       cc->input_filename[name_counter], chip_counter);
+                            }
+                        }
+                        chip_counter++;
+                        subchip_counter = 1;
+                    }
+
+                    if (eprom_size_for_8kb == 4 && (subchip_counter == 3 || subchip_counter == 2) &&
+                        name_counter != cc->input_filenames) {
+                        copy_load_data(cc, cc->extra_buffer_32kb + ((subchip_counter - 1) * 0x2000), 0x2000);
+                        if (!cc->quiet_mode) {
+                            fprintf(cc->out, ", %s", cc->input_filename[name_counter]);
+                        }
+                        subchip_counter++;
+                    }
+
+                    if (eprom_size_for_8kb == 2) {
+                        if (subchip_counter == 2 || name_counter == cc->input_filenames - 1) {
+                            copy_load_data(cc, cc->extra_buffer_32kb + ((subchip_counter - 1) * 0x2000), 0x2000);
+                            cc->loaddata = cc->extra_buffer_32kb;
+                            cc->loaddata_end = sizeof(cc->extra_buffer_32kb);
+                            cc->loadfile_offset = 0;
+                            if (write_chip_package(cc, 0x4000, chip_counter, 0x8000, 0) < 0) {
+                                return close_output_cleanup(cc);
+                            }
+                            if (!cc->quiet_mode) {
+                                if (subchip_counter == 1) {
+                                    fprintf(cc->out, "inserted %s as a 16KiB eprom in bank %u of the Rex EP256 .crt\n",
+                                           cc->input_filename[name_counter], chip_counter);
+                                } else {
+                                    fprintf(cc->out, " and %s as a 16KiB eprom in bank %u of the Rex EP256 .crt\n",
+                                           cc->input_filename[name_counter], chip_counter);
+                                }
+                            }
+                            chip_counter++;
+                            subchip_counter = 1;
+                        } else {
+                            copy_load_data(cc, cc->extra_buffer_32kb, 0x2000);
+                            if (!cc->quiet_mode) {
+                                fprintf(cc->out, "inserted %s", cc->input_filename[name_counter]);
+                            }
+                            subchip_counter++;
+                        }
+                    }
+
+                    if (eprom_size_for_8kb == 4 && subchip_counter == 1 && name_counter != cc->input_filenames) {
+                        copy_load_data(cc, cc->extra_buffer_32kb, 0x2000);
+                        if (!cc->quiet_mode) {
+                            fprintf(cc->out, "inserted %s", cc->input_filename[name_counter]);
+                        }
+                        subchip_counter++;
+                    }
+                }
+            }
+        }
+        name_counter++;
+    }
+
+    if (close_crt_output(cc) < 0) {
+        return -1;
+    }
+    bin2crt_ok(cc);
+    return 0;
+}
+
+static int save_generic_crt(cartconv_t *cc, unsigned int p1, unsigned int p2, unsigned int p3, unsigned int p4, unsigned char p5, unsigned char p6)
+{
+    const cart_layout_t *layout;
+
+    /* fprintf(cc->out, "save_generic_crt ultimax: %d size: %08x\n", cc->convert_to_ultimax, cc->loadfile_size); */
+    if (cc->convert_to_ultimax == 1) {
+        layout = find_layout(layout_ultimax, cc->loadfile_size);
+        if (layout->binsize == 0) {
+            cc_error(cc, "Error: invalid size for generic ultimax cartridge\n");
+            return -1;
+        }
+    } else {
+        layout = find_layout(layout_generic, cc->loadfile_size);
+        if (layout->binsize == 0) {
+            cc_error(cc, "Error: invalid size for generic cartridge\n");
+            return -1;
+        }
+    }
+    return write_layout(cc, layout, 0, 0, 0);
+}
+
+/* convert the loaded input file to cc->output_filename */
+static int convert_loaded_file(cartconv_t *cc)
+{
+    unsigned int unpadded_size, padded_size;
+
+    if (cc->input_filenames > 1 && cc->cart_type != CARTRIDGE_DELA_EP64 && cc->cart_type != CARTRIDGE_DELA_EP256 &&
+        cc->cart_type != CARTRIDGE_DELA_EP7x8 && cc->cart_type != CARTRIDGE_REX_EP256 && cc->loadfile_cart_type != CARTRIDGE_DELA_EP64 &&
+        cc->loadfile_cart_type != CARTRIDGE_DELA_EP256 && cc->loadfile_cart_type != CARTRIDGE_DELA_EP7x8 &&
+        cc->loadfile_cart_type != CARTRIDGE_REX_EP256) {
+        return too_many_inputs(cc);
+    }
+    if ((cc->cart_type == CARTRIDGE_DELA_EP64 || cc->loadfile_cart_type == CARTRIDGE_DELA_EP64) && cc->input_filenames > 3) {
+        return too_many_inputs(cc);
+    }
+    if ((cc->cart_type == CARTRIDGE_DELA_EP7x8 || cc->loadfile_cart_type == CARTRIDGE_DELA_EP7x8) && cc->input_filenames > 8) {
+        return too_many_inputs(cc);
+    }
+    if (cc->loadfile_is_crt == 1) {
+        if (cc->cart_type == CARTRIDGE_DELA_EP64 || cc->cart_type == CARTRIDGE_DELA_EP256 || cc->cart_type == CARTRIDGE_DELA_EP7x8 ||
+            cc->cart_type == CARTRIDGE_REX_EP256) {
+            return cart_info[(unsigned char)cc->cart_type].save(cc, 0, 0, 0, 0, 0, 0);
+        } else {
+            if (cc->cart_type == -1) {
+                return save_binary_output_file(cc);
+            } else {
+                cc_error(cc, "Error: File is already .crt format\n");
+                return -1;
+            }
+        }
+    } else {
+        if (cc->cart_type == -1) {
+            cc_error(cc, "Error: File is already in binary format\n");
+            return -1;
+        }
+        /* a size is accepted when all its bits are in sizes, with -p the
+           binary is padded up to the next size that is */
+        padded_size = cart_pad_size(cart_info[(unsigned char)cc->cart_type].sizes, cc->loadfile_size);
+        if (cc->input_padding && padded_size != 0) {
+            if (padded_size != cc->loadfile_size) {
+                unpadded_size = cc->loadfile_size;
+                cc->loadfile_size = padded_size;
+                pad_load_data(cc, unpadded_size);
+            }
+        } else {
+            if (padded_size != cc->loadfile_size) {
+                cc_error(cc, "Error: Input file size (%u) doesn't match %s requirements\n",
+                        cc->loadfile_size, cart_info[(unsigned char)cc->cart_type].name);
+                return -1;
+            }
+        }
+        if (cart_info[(unsigned char)cc->cart_type].save != NULL) {
+            return cart_info[(unsigned char)cc->cart_type].save(cc, cart_info[(unsigned char)cc->cart_type].bank_size,
+                                                     cart_info[(unsigned char)cc->cart_type].banks,
+                                                     cart_info[(unsigned char)cc->cart_type].load_address,
+                                                     cart_info[(unsigned char)cc->cart_type].data_type,
+                                                     cart_info[(unsigned char)cc->cart_type].game,
+                                                     cart_info[(unsigned char)cc->cart_type].exrom);
+        }
+    }
+    return 0;
+}
+
+/* verify mode: the .crt of a bin->crt conversion is written to memory first
+   and read back with the same code as any input .crt (load_all_banks,
+   load_easyflash_crt, get_load_data). its binary has to be the input, for
+   the Dela/Rex types followed by the inserted files, before the file is
+   written */
+
+typedef struct verify_part_s {
+    const unsigned char *data;
+    unsigned int size;
+    cartconv_t *cc;                 /* context of a file loaded for the check */
+} verify_part_t;
+
+typedef struct verify_input_s {
+    verify_part_t parts[33];
+    unsigned int num;
+    unsigned int size;
+} verify_input_t;
+
+static void verify_free(verify_input_t *in)
+{
+    unsigned int i;
+
+    for (i = 0; i < in->num; i++) {
+        cartconv_free(in->parts[i].cc);
+    }
+    in->num = 0;
+}
+
+/* the inserted files replace the base file in cc while the .crt is written,
+   so with more than one input all of them are loaded again on their own */
+static int verify_capture(cartconv_t *cc, verify_input_t *in)
+{
+    verify_part_t *part;
+    const unsigned char *data;
+    int i;
+
+    memset(in, 0, sizeof(verify_input_t));
+    if (cc->input_filenames <= 1) {
+        in->parts[0].data = cc->loaddata + cc->loadfile_offset;
+        in->parts[0].size = cc->loaddata_end - (unsigned int)cc->loadfile_offset;
+        in->size = in->parts[0].size;
+        in->num = 1;
+        return 0;
+    }
+    for (i = 0; i < cc->input_filenames; i++) {
+        part = &in->parts[in->num++];
+        part->cc = cartconv_new();
+        if (part->cc == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            verify_free(in);
+            return -1;
+        }
+        cartconv_set_streams(part->cc, cc->out, cc->err);
+        if (cartconv_load_file(part->cc, cc->input_filename[i]) < 0 || (data = get_load_data(part->cc)) == NULL) {
+            cc_error(cc, "Error: verify: can't read %s\n", cc->input_filename[i]);
+            verify_free(in);
+            return -1;
+        }
+        part->data = data + part->cc->loadfile_offset;
+        part->size = part->cc->loadfile_size;
+        in->size += part->size;
+    }
+    return 0;
+}
+
+/* the input byte that belongs at offset of the binary, -1 for none (0xff) */
+static int verify_input_byte(const verify_input_t *in, unsigned int offset)
+{
+    unsigned int i;
+
+    for (i = 0; i < in->num; i++) {
+        if (offset < in->parts[i].size) {
+            return in->parts[i].data[offset];
+        }
+        offset -= in->parts[i].size;
+    }
+    return -1;
+}
+
+static void verify_report(cartconv_t *cc, cartconv_t *back, unsigned int offset)
+{
+    const crt_chip_t *chip = NULL;
+    unsigned int i, pos = 0;
+
+    if (back->loadfile_cart_type == CARTRIDGE_EASYFLASH) {
+        chip = crt_find_chip(back, offset >> 14, offset & 0x2000);
+        pos = offset & 0x1fff;
+    } else {
+        for (i = 0; i < back->crtchips_num; i++) {
+            if (offset >= back->crtchips[i].binpos && offset - back->crtchips[i].binpos < back->crtchips[i].size) {
+                chip = &back->crtchips[i];
+                pos = offset - chip->binpos;
+                break;
+            }
+        }
+    }
+    if (chip == NULL) {
+        cc_error(cc, "Error: verify failed, the .crt has no bank for offset $%06x of the binary\n", offset);
+    } else {
+        cc_error(cc, "Error: verify failed, bank %u ($%04x) differs at offset $%04x (offset $%06x of the binary)\n",
+                 chip->bank, chip->start, pos, offset);
+    }
+}
+
+static int verify_crt(cartconv_t *cc, const verify_input_t *in, const unsigned char *crt, size_t size)
+{
+    cartconv_t *back;
+    const unsigned char *image;
+    unsigned int i, skip = 0;
+    int c, result = 0;
+
+    back = cartconv_new();
+    if (back == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        return -1;
+    }
+    cartconv_set_streams(back, cc->out, cc->err);
+    if (cartconv_load_buffer(back, crt, size) < 0 || (image = get_load_data(back)) == NULL) {
+        cc_error(cc, "Error: verify failed, the written .crt can't be read back (%s)\n", cartconv_error(back));
+        cartconv_free(back);
+        return -1;
+    }
+    /* layout_fcplus puts a smaller binary at $2000 of the 32KiB */
+    if (cc->cart_type == CARTRIDGE_FINAL_PLUS && in->size < 0x8000) {
+        skip = 0x2000;
+    }
+    if (in->size + skip > back->loadfile_size) {
+        cc_error(cc, "Error: verify failed, the .crt holds $%x bytes of the $%x byte input\n",
+                 back->loadfile_size - skip, in->size);
+        result = -1;
+    }
+    for (i = 0; i < back->loadfile_size && result == 0; i++) {
+        c = (i < skip) ? -1 : verify_input_byte(in, i - skip);
+        if (image[i] != ((c < 0) ? 0xff : c)) {
+            verify_report(cc, back, i);
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        cc->verified_chips = back->crtchips_num;
+    }
+    cartconv_free(back);
+    return result;
+}
+
+static void verify_ok(cartconv_t *cc, const verify_input_t *in)
+{
+    if (!cc->quiet_mode) {
+        fprintf(cc->out, "Verified: the %u chips of the .crt hold the $%x bytes of the input.\n",
+                cc->verified_chips, in->size);
+    }
+}
+
+static int write_output_data(cartconv_t *cc, const unsigned char *data, size_t size)
+{
+    FILE *f = open_output_file(cc);
+
+    if (f == NULL) {
+        cc_error(cc, "Error: Can't open output file %s\n", cc->output_filename);
+        return -1;
+    }
+    if (fwrite(data, 1, size, f) != size || fclose(f) != 0) {
+        cc_error(cc, "Error: Can't write to file %s\n", cc->output_filename);
+        if (f != NULL) {
+            remove_output_file(cc);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+static int verify_applies(const cartconv_t *cc)
+{
+    return cc->verify && cc->loadfile_is_crt == 0 && cc->cart_type != -1;
+}
+
+/* convert into memory, verify, then write the output. the messages of the
+   conversion are held back until the .crt has passed */
+static int convert_verified(cartconv_t *cc)
+{
+    verify_input_t in;
+    FILE *out = cc->out;
+    char *buf = NULL, *msg = NULL;
+    size_t len = 0, msglen = 0;
+    int result;
+
+    if (verify_capture(cc, &in) < 0) {
+        return -1;
+    }
+    cc->outstream = open_memstream(&buf, &len);
+    if (cc->outstream == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        verify_free(&in);
+        return -1;
+    }
+    cc->outfile = NULL;
+    if (!cc->quiet_mode) {
+        cc->out = open_memstream(&msg, &msglen);
+        if (cc->out == NULL) {
+            cc->out = out;
+        }
+    }
+    result = convert_loaded_file(cc);
+    if (result < 0 && cc->outfile != cc->outstream) {
+        fclose(cc->outstream);
+    }
+    cc->outstream = NULL;
+    cc->outfile = NULL;
+    if (cc->out != out) {
+        fclose(cc->out);
+        cc->out = out;
+    }
+    if (result == 0) {
+        result = verify_crt(cc, &in, (unsigned char *)buf, len);
+    }
+    if (result == 0) {
+        result = write_output_data(cc, (unsigned char *)buf, len);
+    }
+    if (result == 0) {
+        if (msg != NULL) {
+            fwrite(msg, 1, msglen, out);
+        }
+        verify_ok(cc, &in);
+    }
+    verify_free(&in);
+    free(msg);
+    free(buf);
+    return result;
+}
+
+/* join mode: put a .crt file back together from the header and bank files
+   written by -f. the banks are sorted by bank and load address, the CHIP
+   headers are recomputed from the real size of each bank file and the
+   whole file is written with a few writev calls straight from the mapped
+   bank files. */
+
+typedef struct join_chunk_s {
+    char *name;
+    mapped_file_t m;
+    const unsigned char *data;
+    unsigned int size;
+    unsigned int type;
+    unsigned int bank;
+    unsigned int start;
+    unsigned int order;
+    unsigned char header[0x10];
+} join_chunk_t;
+
+static int join_is_bank_name(const char *name, unsigned int *bank, unsigned int *start)
+{
+    const char *base = strrchr(name, '/');
+    unsigned int end;
+    int n = 0;
+
+    base = (base == NULL) ? name : base + 1;
+    if (sscanf(base, "%x_%x_%x%n", bank, start, &end, &n) != 3 || base[n] != 0) {
+        return 0;
+    }
+    return 1;
+}
+
+static int join_add_chunk(cartconv_t *cc, join_chunk_t **chunks, unsigned int *num, unsigned int *max, const char *name)
+{
+    join_chunk_t *c;
+    unsigned int bank = 0, start = 0;
+    int has_name = join_is_bank_name(name, &bank, &start);
+
+    if (*num == *max) {
+        *max = *max ? *max * 2 : 64;
+        c = realloc(*chunks, *max * sizeof(join_chunk_t));
+        if (c == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            return -1;
+        }
+        *chunks = c;
+    }
+    c = &(*chunks)[*num];
+    memset(c, 0, sizeof(join_chunk_t));
+    if (map_input_file(&c->m, name) < 0) {
+        cc_error(cc, "Error: Can't open %s\n", name);
+        return -1;
+    }
+    /* the mapping stays valid, do not run out of file descriptors on big carts */
+    close(c->m.fd);
+    c->m.fd = -1;
+    c->name = strdup(name);
+    c->order = (*num)++;
+    c->type = 0xffff;
+    if (c->name == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        return -1;
+    }
+
+    if (c->m.size >= 0x10 && !memcmp(c->m.data, "CHIP", 4)) {
+        /* a chunk written by -f, the bank and address are taken from its CHIP header */
+        c->type = (unsigned int)((c->m.data[8] << 8) + c->m.data[9]);
+        c->bank = (unsigned int)((c->m.data[10] << 8) + c->m.data[11]);
+        c->start = (unsigned int)((c->m.data[12] << 8) + c->m.data[13]);
+        c->data = c->m.data + 0x10;
+        c->size = (unsigned int)(c->m.size - 0x10);
+    } else if (has_name) {
+        /* raw bank data, the bank and address are taken from the name */
+        c->bank = bank;
+        c->start = start;
+        c->data = c->m.data;
+        c->size = (unsigned int)c->m.size;
+    } else {
+        cc_error(cc, "Error: %s is neither a bank file nor named like one (bank_start_end)\n", name);
+        return -1;
+    }
+    if (c->size > 0xffff) {
+        cc_error(cc, "Error: bank file %s is too large (%u bytes)\n", name, c->size);
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_join_chunks(const void *op1, const void *op2)
+{
+    const join_chunk_t *p1 = (const join_chunk_t *)op1;
+    const join_chunk_t *p2 = (const join_chunk_t *)op2;
+
+    if (p1->bank != p2->bank) {
+        return (p1->bank < p2->bank) ? -1 : 1;
+    }
+    if (p1->start != p2->start) {
+        return (p1->start < p2->start) ? -1 : 1;
+    }
+    return (p1->order < p2->order) ? -1 : 1;
+}
+
+/* write all iovecs, IOV_MAX at a time */
+static int writev_all(int fd, struct iovec *iov, unsigned int num)
+{
+    ssize_t n;
+    unsigned int count;
+
+    while (num > 0) {
+        count = (num > IOV_MAX) ? IOV_MAX : num;
+        n = writev(fd, iov, (int)count);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        /* skip what has been written, a partial write continues in the middle of an iovec */
+        while (num > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            num--;
+        }
+        if (num > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+    return 0;
+}
+
+static int join_banks(cartconv_t *cc, const char *join_source)
+{
+    join_chunk_t *chunks = NULL;
+    unsigned int num = 0, max = 0, i;
+    mapped_file_t header;
+    struct stat st;
+    struct iovec *iov = NULL;
+    DIR *d;
+    struct dirent *de;
+    char *dir = NULL, *headername = NULL, *path, *p;
+    unsigned int type = 0;
+    unsigned long total;
+    int rc;
+    int result = -1;
+
+    header.fd = -1;
+    header.data = NULL;
+
+    /* the source is either the directory of the chunks, or the header file in it */
+    if (stat(join_source, &st) == 0 && S_ISDIR(st.st_mode)) {
+        dir = strdup(join_source);
+        headername = malloc(strlen(join_source) + 32);
+        if (dir == NULL || headername == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            goto out;
+        }
+        sprintf(headername, "%s/000_0000_0040_CRT_header", dir);
+    } else {
+        headername = strdup(join_source);
+        dir = strdup(join_source);
+        if (dir == NULL || headername == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            goto out;
+        }
+        p = strrchr(dir, '/');
+        if (p == NULL) {
+            strcpy(dir, ".");
+        } else {
+            *p = 0;
+        }
+    }
+
+    if (map_input_file(&header, headername) < 0) {
+        cc_error(cc, "Error: Can't open %s\n", headername);
+        goto out;
+    }
+    if (header.size < 0x40 || memcmp(header.data, "C64 CARTRIDGE   ", 16)) {
+        cc_error(cc, "Error: %s is not a .crt header\n", headername);
+        goto out;
+    }
+
+    d = opendir(dir);
+    if (d == NULL) {
+        cc_error(cc, "Error: Can't open directory %s\n", dir);
+        goto out;
+    }
+    while ((de = readdir(d)) != NULL) {
+        unsigned int bank, start;
+
+        if (!join_is_bank_name(de->d_name, &bank, &start)) {
+            continue;
+        }
+        path = malloc(strlen(dir) + strlen(de->d_name) + 2);
+        if (path == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            closedir(d);
+            goto out;
+        }
+        sprintf(path, "%s/%s", dir, de->d_name);
+        rc = join_add_chunk(cc, &chunks, &num, &max, path);
+        free(path);
+        if (rc < 0) {
+            closedir(d);
+            goto out;
+        }
+    }
+    closedir(d);
+    for (i = 0; i < cc->input_filenames; i++) {
+        if (join_add_chunk(cc, &chunks, &num, &max, cc->input_filename[i]) < 0) {
+            goto out;
+        }
+    }
+    if (num == 0) {
+        cc_error(cc, "Error: no bank files found in %s\n", dir);
+        goto out;
+    }
+
+    qsort(chunks, num, sizeof(join_chunk_t), compare_join_chunks);
+
+    /* raw banks get the chip type of the other banks */
+    for (i = 0; i < num; i++) {
+        if (chunks[i].type != 0xffff) {
+            type = chunks[i].type;
+            break;
+        }
+    }
+
+    iov = malloc((1 + (num * 2)) * sizeof(struct iovec));
+    if (iov == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+    iov[0].iov_base = header.data;
+    iov[0].iov_len = header.size;
+    total = header.size;
+    for (i = 0; i < num; i++) {
+        join_chunk_t *c = &chunks[i];
+
+        if (i > 0 && c->bank == chunks[i - 1].bank && c->start == chunks[i - 1].start) {
+            cc_error(cc, "Error: %s and %s are both bank %u at $%04x\n",
+                    chunks[i - 1].name, c->name, c->bank, c->start);
+            goto out;
+        }
+        if (c->type == 0xffff) {
+            c->type = type;
+        }
+        memcpy(c->header, "CHIP", 4);
+        c->header[4] = 0;
+        c->header[5] = 0;
+        c->header[6] = (unsigned char)((c->size + 0x10) >> 8);
+        c->header[7] = (unsigned char)((c->size + 0x10) & 0xff);
+        c->header[8] = (unsigned char)(c->type >> 8);
+        c->header[9] = (unsigned char)(c->type & 0xff);
+        c->header[0xa] = (unsigned char)(c->bank >> 8);
+        c->header[0xb] = (unsigned char)(c->bank & 0xff);
+        c->header[0xc] = (unsigned char)(c->start >> 8);
+        c->header[0xd] = (unsigned char)(c->start & 0xff);
+        c->header[0xe] = (unsigned char)(c->size >> 8);
+        c->header[0xf] = (unsigned char)(c->size & 0xff);
+        iov[1 + (i * 2)].iov_base = c->header;
+        iov[1 + (i * 2)].iov_len = 0x10;
+        iov[2 + (i * 2)].iov_base = (void *)c->data;
+        iov[2 + (i * 2)].iov_len = c->size;
+        total += 0x10 + c->size;
+    }
+
+    if (write_crt_output(cc, iov, 1 + (num * 2)) < 0) {
+        goto out;
+    }
+
+    if (!cc->quiet_mode) {
+        fprintf(cc->out, "Joined %s and %u banks into %s ($%06lx bytes).\n", headername, num, cc->output_filename, total);
+    }
+    result = 0;
+
+out:
+    for (i = 0; i < num; i++) {
+        unmap_input_file(&chunks[i].m);
+        free(chunks[i].name);
+    }
+    free(chunks);
+    free(iov);
+    unmap_input_file(&header);
+    free(headername);
+    free(dir);
+    return result;
+}
+
+/* edit mode: change an existing .crt file in place. replaced banks and
+   patched header fields are written with pwrite at their offset, appended
+   banks go to the end of the file, so only the changed bytes are written.
+   all operations are checked before anything is written. */
+
+static int edit_add_op(cartconv_t *cc, int kind, const char *arg)
+{
+    edit_op_t *p = realloc(cc->edit_ops, (cc->edit_ops_num + 1) * sizeof(edit_op_t));
+
+    if (p == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        return -1;
+    }
+    cc->edit_ops = p;
+    memset(&cc->edit_ops[cc->edit_ops_num], 0, sizeof(edit_op_t));
+    cc->edit_ops[cc->edit_ops_num].kind = kind;
+    cc->edit_ops[cc->edit_ops_num].arg = strdup(arg);
+    cc->edit_ops[cc->edit_ops_num].m.fd = -1;
+    cc->edit_ops_num++;
+    return 0;
+}
+
+static void edit_free_ops(cartconv_t *cc)
+{
+    unsigned int i;
+
+    for (i = 0; i < cc->edit_ops_num; i++) {
+        unmap_input_file(&cc->edit_ops[i].m);
+        free(cc->edit_ops[i].arg);
+    }
+    free(cc->edit_ops);
+    cc->edit_ops = NULL;
+    cc->edit_ops_num = 0;
+}
+
+/* parse "bank:addr=file", the bank is decimal (as printed by -f) or hex with 0x or $,
+   the address is hex */
+static const char *edit_parse_bank(const char *arg, unsigned int *bank, unsigned int *start)
+{
+    char *end;
+    const char *p = arg;
+    int base = 10;
+
+    if (*p == '$') {
+        p++;
+        base = 16;
+    } else if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        p += 2;
+        base = 16;
+    }
+    *bank = (unsigned int)strtoul(p, &end, base);
+    if (end == p || *end != ':') {
+        return NULL;
+    }
+    p = end + 1;
+    if (*p == '$') {
+        p++;
+    }
+    *start = (unsigned int)strtoul(p, &end, 16);
+    if (end == p || *end != '=' || end[1] == 0 || *bank > 0xffff || *start > 0xffff) {
+        return NULL;
+    }
+    return end + 1;
+}
+
+static int edit_find_chip(const crt_chip_t *chips, unsigned int num, unsigned int bank, unsigned int start)
+{
+    unsigned int i;
+
+    for (i = 0; i < num; i++) {
+        if (chips[i].bank == bank && chips[i].start == start) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static int edit_load_bank(cartconv_t *cc, edit_op_t *op, const char *name)
+{
+    if (map_input_file(&op->m, name) < 0) {
+        cc_error(cc, "Error: Can't open %s\n", name);
+        return -1;
+    }
+    op->data = op->m.data;
+    op->size = (unsigned int)op->m.size;
+    /* a chunk written by -f, only its data is used */
+    if (op->m.size >= 0x10 && !memcmp(op->m.data, "CHIP", 4)) {
+        op->data += 0x10;
+        op->size -= 0x10;
+    }
+    if (op->m.size > 0xffff + 0x10 || op->size > 0xffff) {
+        cc_error(cc, "Error: bank file %s is too large\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+static int edit_patch_field(cartconv_t *cc, edit_op_t *op)
+{
+    char *value = strchr(op->arg, '=');
+    long n;
+    int i;
+
+    if (value == NULL) {
+        cc_error(cc, "Error: --patch needs field=value, not %s\n", op->arg);
+        return -1;
+    }
+    *value++ = 0;
+    n = strtol(value, NULL, 0);
+    if (!strcmp(op->arg, "name")) {
+        op->offset = 0x20;
+        op->size = 0x20;
+        for (i = 0; i < 0x20 && value[i] != 0; i++) {
+            op->buf[i] = (unsigned char)toupper((int)value[i]);
+        }
+    } else if (!strcmp(op->arg, "exrom") || !strcmp(op->arg, "game")) {
+        op->offset = (op->arg[0] == 'e') ? 0x18 : 0x19;
+        op->size = 1;
+        op->buf[0] = (unsigned char)(n != 0);
+    } else if (!strcmp(op->arg, "revision")) {
+        op->offset = 0x1a;
+        op->size = 1;
+        op->buf[0] = (unsigned char)n;
+    } else if (!strcmp(op->arg, "type")) {
+        /* either a type option like "easy", a type name or the hardware id */
+        i = find_cart_type(value);
+        if (i >= 0) {
+            n = i;
+        }
+        if ((i < 0 && !isdigit((int)value[0])) || n < 0 || n > CARTRIDGE_LAST) {
+            cc_error(cc, "Error: unknown cart type %s\n", value);
+            return -1;
+        }
+        op->offset = 0x16;
+        op->size = 2;
+        op->buf[0] = (unsigned char)(n >> 8);
+        op->buf[1] = (unsigned char)(n & 0xff);
+    } else {
+        cc_error(cc, "Error: unknown header field %s (use name, type, exrom, game or revision)\n", op->arg);
+        return -1;
+    }
+    op->data = op->buf;
+    return 0;
+}
+
+static int edit_crt(cartconv_t *cc, const char *edit_filename)
+{
+    mapped_file_t m;
+    crt_chip_t *chips = NULL;
+    unsigned int num = 0, complete, i;
+    unsigned int bank, start, type;
+    unsigned long end;
+    const char *name;
+    edit_op_t *op;
+    struct iovec iov[2];
+    int idx, fd = -1;
+    int result = -1;
+
+    if (map_input_file(&m, edit_filename) < 0) {
+        cc_error(cc, "Error: Can't open %s\n", edit_filename);
+        edit_free_ops(cc);
+        return -1;
+    }
+    if (m.size < 0x40 || memcmp(m.data, "C64 CARTRIDGE   ", 16)) {
+        cc_error(cc, "Error: %s is not a .crt file\n", edit_filename);
+        goto out;
+    }
+
+    /* chip table of the file as it is now, with room for the appended ones.
+       a broken last chip is not part of it */
+    if (crt_walk_chips(&m, cc->edit_ops_num, &chips, &num, &complete) < 0) {
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+    num = complete;
+    end = m.size;
+
+    /* check everything before the file is touched */
+    for (i = 0; i < cc->edit_ops_num; i++) {
+        op = &cc->edit_ops[i];
+        if (op->kind == CARTCONV_EDIT_PATCH) {
+            if (edit_patch_field(cc, op) < 0) {
+                goto out;
+            }
+            continue;
+        }
+        name = edit_parse_bank(op->arg, &bank, &start);
+        if (name == NULL) {
+            cc_error(cc, "Error: expected bank:address=file, not %s\n", op->arg);
+            goto out;
+        }
+        if (edit_load_bank(cc, op, name) < 0) {
+            goto out;
+        }
+        idx = edit_find_chip(chips, num, bank, start);
+        if (op->kind == CARTCONV_EDIT_REPLACE) {
+            if (idx < 0) {
+                cc_error(cc, "Error: %s has no bank %u at $%04x\n", edit_filename, bank, start);
+                goto out;
+            }
+            if (op->size != chips[idx].size || chips[idx].offset + 0x10 + op->size > end) {
+                cc_error(cc, "Error: %s has $%04x bytes, bank %u at $%04x has $%04x (use --join to change bank sizes)\n",
+                        name, op->size, bank, start, chips[idx].size);
+                goto out;
+            }
+            op->offset = chips[idx].offset + 0x10;
+        } else {
+            if (idx >= 0) {
+                cc_error(cc, "Error: %s already has bank %u at $%04x\n", edit_filename, bank, start);
+                goto out;
+            }
+            /* new banks get the chip type of the first bank */
+            type = (num > 0) ? chips[0].type : 0;
+            memcpy(op->buf, "CHIP", 4);
+            op->buf[6] = (unsigned char)((op->size + 0x10) >> 8);
+            op->buf[7] = (unsigned char)((op->size + 0x10) & 0xff);
+            op->buf[8] = (unsigned char)(type >> 8);
+            op->buf[9] = (unsigned char)(type & 0xff);
+            op->buf[0xa] = (unsigned char)(bank >> 8);
+            op->buf[0xb] = (unsigned char)(bank & 0xff);
+            op->buf[0xc] = (unsigned char)(start >> 8);
+            op->buf[0xd] = (unsigned char)(start & 0xff);
+            op->buf[0xe] = (unsigned char)(op->size >> 8);
+            op->buf[0xf] = (unsigned char)(op->size & 0xff);
+            op->offset = end;
+            chips[num].offset = end;
+            chips[num].bank = bank;
+            chips[num].start = start;
+            chips[num].size = op->size;
+            num++;
+            end += 0x10 + op->size;
+        }
+    }
+
+    fd = open(edit_filename, O_WRONLY);
+    if (fd < 0) {
+        cc_error(cc, "Error: Can't open %s for writing\n", edit_filename);
+        goto out;
+    }
+    for (i = 0; i < cc->edit_ops_num; i++) {
+        op = &cc->edit_ops[i];
+        if (op->kind == CARTCONV_EDIT_APPEND) {
+            iov[0].iov_base = op->buf;
+            iov[0].iov_len = 0x10;
+            iov[1].iov_base = (void *)op->data;
+            iov[1].iov_len = op->size;
+            if (lseek(fd, (off_t)op->offset, SEEK_SET) < 0 || writev_all(fd, iov, 2) < 0) {
+                cc_error(cc, "Error: Can't write to file %s\n", edit_filename);
+                goto out;
+            }
+        } else if (pwrite(fd, op->data, op->size, (off_t)op->offset) != (ssize_t)op->size) {
+            cc_error(cc, "Error: Can't write to file %s\n", edit_filename);
+            goto out;
+        }
+        if (!cc->quiet_mode) {
+            fprintf(cc->out, "%s %s at $%06lx ($%04x bytes)\n",
+                   (op->kind == CARTCONV_EDIT_REPLACE) ? "Replaced" : (op->kind == CARTCONV_EDIT_APPEND) ? "Appended" : "Patched",
+                   op->arg, op->offset, op->size);
+        }
+    }
+    result = 0;
+
+out:
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(chips);
+    unmap_input_file(&m);
+    edit_free_ops(cc);
+    return result;
+}
+
+/* bank store: the data of every chip is kept once in <store>/banks/, named
+   after its SHA-256, so banks that several carts share take space only once.
+   a cart becomes a small text manifest with its header and its chips, and
+   restoring the manifest gives back the identical .crt file. */
+
+#define STORE_MANIFEST_ID "cartconv manifest 1"
+#define STORE_HASH_LEN (SHA256_DIGEST_SIZE * 2)
+
+typedef struct store_part_s {
+    mapped_file_t m;
+    unsigned char header[0x10];     /* CHIP header, not used for the tail */
+    int is_chip;
+} store_part_t;
+
+/* create the missing directories in front of a file name */
+static int store_make_dirs(const char *name)
+{
+    char *path = strdup(name);
+    char *p;
+
+    if (path == NULL) {
+        return -1;
+    }
+    for (p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = 0;
+            if (mkdir(path, 0777) < 0 && errno != EEXIST) {
+                free(path);
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+    free(path);
+    return 0;
+}
+
+/* write a file under a temporary name and rename it, so that others storing
+   into the same store at the same time never see a partial file */
+static int store_write_file(const char *name, const void *data, size_t size)
+{
+    char *tmpname;
+    struct iovec iov;
+    int fd;
+    int result = -1;
+
+    if (store_make_dirs(name) < 0) {
+        return -1;
+    }
+    tmpname = malloc(strlen(name) + 8);
+    if (tmpname == NULL) {
+        return -1;
+    }
+    sprintf(tmpname, "%s.XXXXXX", name);
+    fd = mkstemp(tmpname);
+    if (fd >= 0) {
+        iov.iov_base = (void *)data;
+        iov.iov_len = size;
+        if (fchmod(fd, 0644) == 0 && writev_all(fd, &iov, 1) == 0) {
+            result = 0;
+        }
+        if (close(fd) < 0 || result < 0 || rename(tmpname, name) < 0) {
+            remove(tmpname);
+            result = -1;
+        }
+    }
+    free(tmpname);
+    return result;
+}
+
+static char *store_blob_name(const char *store, const char *hex)
+{
+    char *name = malloc(strlen(store) + STORE_HASH_LEN + 16);
+
+    if (name != NULL) {
+        sprintf(name, "%s/banks/%.2s/%s", store, hex, hex);
+    }
+    return name;
+}
+
+/* store one piece of data unless it is there already, *added is set if it was new */
+static int store_blob(cartconv_t *cc, const char *store, const unsigned char *data, size_t size, char *hex, int *added)
+{
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    struct stat st;
+    char *name;
+    int result = 0;
+
+    sha256(data, size, digest);
+    hash_to_hex(digest, SHA256_DIGEST_SIZE, hex);
+    name = store_blob_name(store, hex);
+    if (name == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        return -1;
+    }
+    *added = 0;
+    if (stat(name, &st) < 0 || (size_t)st.st_size != size) {
+        if (store_write_file(name, data, size) < 0) {
+            cc_error(cc, "Error: Can't write %s\n", name);
+            result = -1;
+        }
+        *added = 1;
+    }
+    free(name);
+    return result;
+}
+
+/* the manifest of an input file: its name without the extension */
+static char *store_manifest_name(const char *name)
+{
+    const char *base = strrchr(name, '/');
+    char *manifest, *dot;
+
+    base = (base == NULL) ? name : base + 1;
+    manifest = malloc(strlen(base) + 10);
+    if (manifest != NULL) {
+        strcpy(manifest, base);
+        dot = strrchr(manifest, '.');
+        if (dot != NULL && dot != manifest) {
+            *dot = 0;
+        }
+        strcat(manifest, ".manifest");
+    }
+    return manifest;
+}
+
+static int store_crt(cartconv_t *cc, const char *store, const char *name, const char *manifest)
+{
+    mapped_file_t m, old;
+    crt_chip_t *list = NULL, *chip;
+    char hex[STORE_HASH_LEN + 1];
+    char *text = NULL, *mname = NULL;
+    const char *p;
+    size_t textlen = 0;
+    FILE *f = NULL;
+    unsigned long pos, datasize, databytes = 0, newbytes = 0;
+    unsigned int chips = 0, newchips = 0, num, complete, i;
+    int added, result = -1;
+
+    if (map_input_file(&m, name) < 0) {
+        cc_error(cc, "Error: Can't open %s\n", name);
+        return -1;
+    }
+    if (m.size < 0x40 || memcmp(m.data, "C64 CARTRIDGE   ", 16)) {
+        cc_error(cc, "Error: %s is not a .crt file\n", name);
+        unmap_input_file(&m);
+        return -1;
+    }
+    f = open_memstream(&text, &textlen);
+    if (f == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+
+    /* the way back from the manifest to the store, the manifest name is relative to it */
+    while (*manifest == '/') {
+        manifest++;
+    }
+    fprintf(f, "%s\nstore ", STORE_MANIFEST_ID);
+    p = strchr(manifest, '/');
+    if (p == NULL) {
+        fputc('.', f);
+    }
+    while (p != NULL) {
+        p = strchr(p + 1, '/');
+        fprintf(f, (p != NULL) ? "../" : "..");
+    }
+    fprintf(f, "\nheader ");
+    for (i = 0; i < 0x40; i++) {
+        fprintf(f, "%02x", m.data[i]);
+    }
+    fprintf(f, "\n# type bank address size length datasize sha256\n");
+
+    /* the chips are stored as they are, with whatever their CHIP headers say.
+       a last chip that runs past the end of the file is cut off there */
+    if (crt_walk_chips(&m, 0, &list, &num, &complete) < 0) {
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+    pos = 0x40;
+    for (i = 0; i < num; i++) {
+        chip = &list[i];
+        if (memcmp(chip->header, "CHIP", 4) || chip->length < 0x10) {
+            break;
+        }
+        datasize = chip->length - 0x10;
+        if (datasize > m.size - pos - 0x10) {
+            datasize = m.size - pos - 0x10;
+        }
+        if (store_blob(cc, store, chip->data, datasize, hex, &added) < 0) {
+            goto out;
+        }
+        fprintf(f, "chip %04x %04x %04x %04x %08lx %08lx %s\n",
+                chip->type, chip->bank, chip->start, chip->size, chip->length, datasize, hex);
+        chips++;
+        databytes += datasize;
+        if (added) {
+            newchips++;
+            newbytes += datasize;
+        }
+        pos += 0x10 + datasize;
+    }
+    /* whatever follows the last chip */
+    if (pos < m.size) {
+        datasize = m.size - pos;
+        if (store_blob(cc, store, m.data + pos, datasize, hex, &added) < 0) {
+            goto out;
+        }
+        fprintf(f, "tail %08lx %s\n", datasize, hex);
+        databytes += datasize;
+        if (added) {
+            newbytes += datasize;
+        }
+    }
+    if (fclose(f) != 0) {
+        f = NULL;
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+    f = NULL;
+
+    mname = malloc(strlen(store) + strlen(manifest) + 2);
+    if (mname == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+    sprintf(mname, "%s/%s", store, manifest);
+    /* storing the same cart again is fine, replacing another one is not */
+    if (map_input_file(&old, mname) == 0) {
+        added = (old.size != textlen || memcmp(old.data, text, textlen));
+        unmap_input_file(&old);
+        if (added) {
+            cc_error(cc, "Error: %s is already in the store with other contents\n", mname);
+            goto out;
+        }
+    } else if (store_write_file(mname, text, textlen) < 0) {
+        cc_error(cc, "Error: Can't write %s\n", mname);
+        goto out;
+    }
+
+    if (!cc->quiet_mode) {
+        fprintf(cc->out, "Stored %s as %s: %u chips, %u new ($%06lx of $%06lx bytes).\n",
+                name, manifest, chips, newchips, newbytes, databytes);
+    }
+    result = 0;
+
+out:
+    if (f != NULL) {
+        fclose(f);
+    }
+    free(text);
+    free(mname);
+    free(list);
+    unmap_input_file(&m);
+    return result;
+}
+
+static int store_hex_decode(const char *hex, unsigned char *data, unsigned int size)
+{
+    unsigned int i, c;
+
+    for (i = 0; i < size; i++) {
+        if (!isxdigit((unsigned char)hex[i * 2]) || !isxdigit((unsigned char)hex[i * 2 + 1])) {
+            return -1;
+        }
+        sscanf(hex + (i * 2), "%2x", &c);
+        data[i] = (unsigned char)c;
+    }
+    return (hex[size * 2] == 0) ? 0 : -1;
+}
+
+/* map a stored piece of data and check that it is what the manifest expects */
+static int store_map_blob(cartconv_t *cc, const char *store, const char *hex, unsigned long size, mapped_file_t *m)
+{
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    char check[STORE_HASH_LEN + 1];
+    char *name = store_blob_name(store, hex);
+
+    if (name == NULL || map_input_file(m, name) < 0) {
+        cc_error(cc, "Error: bank %s is missing in the store\n", hex);
+        free(name);
+        return -1;
+    }
+    free(name);
+    /* the mapping stays valid, do not run out of file descriptors on big carts */
+    close(m->fd);
+    m->fd = -1;
+    sha256(m->data, m->size, digest);
+    hash_to_hex(digest, SHA256_DIGEST_SIZE, check);
+    if (m->size != size || strcmp(check, hex)) {
+        cc_error(cc, "Error: bank %s in the store is damaged\n", hex);
+        return -1;
+    }
+    return 0;
+}
+
+static int restore_crt(cartconv_t *cc, const char *manifest)
+{
+    FILE *f;
+    char line[0x100];
+    char hex[0x100];
+    char *store = NULL, *p;
+    unsigned char header[0x40];
+    store_part_t *parts = NULL, *part;
+    struct iovec *iov = NULL;
+    unsigned int num = 0, max = 0, lineno = 0, i, n;
+    unsigned int type, bank, start, size;
+    unsigned long length, datasize, total;
+    int has_header = 0;
+    int result = -1;
+
+    f = fopen(manifest, "r");
+    if (f == NULL) {
+        cc_error(cc, "Error: Can't open %s\n", manifest);
+        return -1;
+    }
+    if (fgets(line, sizeof(line), f) == NULL || strncmp(line, STORE_MANIFEST_ID "\n", sizeof(STORE_MANIFEST_ID))) {
+        cc_error(cc, "Error: %s is not a manifest\n", manifest);
+        fclose(f);
+        return -1;
+    }
+    lineno = 1;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (num == max) {
+            max = max ? max * 2 : 64;
+            part = realloc(parts, max * sizeof(store_part_t));
+            if (part == NULL) {
+                cc_error(cc, "Error: out of memory.\n");
+                goto out;
+            }
+            parts = part;
+        }
+        part = &parts[num];
+        part->m.fd = -1;
+        part->m.data = NULL;
+        part->m.size = 0;
+        part->m.is_mapped = 0;
+        part->is_chip = 0;
+        if (store == NULL && sscanf(line, "store %255s", hex) == 1) {
+            /* relative to the directory of the manifest */
+            p = strrchr(manifest, '/');
+            n = (p == NULL) ? 0 : (unsigned int)(p - manifest) + 1;
+            store = malloc(n + strlen(hex) + 1);
+            if (store == NULL) {
+                cc_error(cc, "Error: out of memory.\n");
+                goto out;
+            }
+            memcpy(store, manifest, n);
+            strcpy(store + n, hex);
+        } else if (!has_header && sscanf(line, "header %128s", hex) == 1 && store_hex_decode(hex, header, 0x40) == 0) {
+            has_header = 1;
+        } else if (store != NULL && has_header &&
+                   sscanf(line, "chip %x %x %x %x %lx %lx %64s", &type, &bank, &start, &size, &length, &datasize, hex) == 7 &&
+                   strlen(hex) == STORE_HASH_LEN) {
+            if (store_map_blob(cc, store, hex, datasize, &part->m) < 0) {
+                num++;
+                goto out;
+            }
+            memcpy(part->header, "CHIP", 4);
+            part->header[4] = (unsigned char)(length >> 24);
+            part->header[5] = (unsigned char)(length >> 16);
+            part->header[6] = (unsigned char)(length >> 8);
+            part->header[7] = (unsigned char)length;
+            part->header[8] = (unsigned char)(type >> 8);
+            part->header[9] = (unsigned char)type;
+            part->header[0xa] = (unsigned char)(bank >> 8);
+            part->header[0xb] = (unsigned char)bank;
+            part->header[0xc] = (unsigned char)(start >> 8);
+            part->header[0xd] = (unsigned char)start;
+            part->header[0xe] = (unsigned char)(size >> 8);
+            part->header[0xf] = (unsigned char)size;
+            part->is_chip = 1;
+            num++;
+        } else if (store != NULL && has_header &&
+                   sscanf(line, "tail %lx %64s", &datasize, hex) == 2 && strlen(hex) == STORE_HASH_LEN) {
+            if (store_map_blob(cc, store, hex, datasize, &part->m) < 0) {
+                num++;
+                goto out;
+            }
+            num++;
+        } else {
+            cc_error(cc, "Error: %s line %u is broken\n", manifest, lineno);
+            goto out;
+        }
+    }
+    if (!has_header) {
+        cc_error(cc, "Error: %s has no header\n", manifest);
+        goto out;
+    }
+
+    iov = malloc((1 + (num * 2)) * sizeof(struct iovec));
+    if (iov == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        goto out;
+    }
+    iov[0].iov_base = header;
+    iov[0].iov_len = 0x40;
+    total = 0x40;
+    n = 1;
+    for (i = 0; i < num; i++) {
+        if (parts[i].is_chip) {
+            iov[n].iov_base = parts[i].header;
+            iov[n++].iov_len = 0x10;
+            total += 0x10;
+        }
+        iov[n].iov_base = parts[i].m.data;
+        iov[n++].iov_len = parts[i].m.size;
+        total += parts[i].m.size;
+    }
+
+    if (write_crt_output(cc, iov, n) < 0) {
+        goto out;
+    }
+
+    if (!cc->quiet_mode) {
+        fprintf(cc->out, "Restored %s from %s ($%06lx bytes).\n", cc->output_filename, manifest, total);
+    }
+    result = 0;
+
+out:
+    fclose(f);
+    for (i = 0; i < num; i++) {
+        unmap_input_file(&parts[i].m);
+    }
+    free(parts);
+    free(iov);
+    free(store);
+    return result;
+}
+
+/* add up the manifests below dir */
+static void store_scan_manifests(const char *dir, int top, unsigned long *stats)
+{
+    DIR *d;
+    struct dirent *de;
+    struct stat st;
+    FILE *f;
+    char line[0x100];
+    char *path;
+    unsigned long datasize;
+    size_t len;
+
+    d = opendir(dir);
+    if (d == NULL) {
+        return;
+    }
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.' || (top && !strcmp(de->d_name, "banks"))) {
+            continue;
+        }
+        path = malloc(strlen(dir) + strlen(de->d_name) + 2);
+        if (path == NULL) {
+            break;
+        }
+        sprintf(path, "%s/%s", dir, de->d_name);
+        len = strlen(de->d_name);
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            store_scan_manifests(path, 0, stats);
+        } else if (len > 9 && !strcmp(de->d_name + len - 9, ".manifest") && (f = fopen(path, "r")) != NULL) {
+            stats[0]++;
+            stats[1] += 0x40;
+            stats[3] += (unsigned long)st.st_size;
+            while (fgets(line, sizeof(line), f) != NULL) {
+                if (sscanf(line, "chip %*x %*x %*x %*x %*x %lx", &datasize) == 1) {
+                    stats[1] += 0x10 + datasize;
+                } else if (sscanf(line, "tail %lx", &datasize) == 1) {
+                    stats[1] += datasize;
+                }
+            }
+            fclose(f);
+        }
+        free(path);
+    }
+    closedir(d);
+}
+
+/* add up the stored banks, <store>/banks/xx/<hash> */
+static void store_scan_banks(const char *store, unsigned long *stats)
+{
+    DIR *d, *sub;
+    struct dirent *de, *se;
+    struct stat st;
+    char *path;
+
+    path = malloc(strlen(store) + STORE_HASH_LEN + 16);
+    if (path == NULL) {
+        return;
+    }
+    sprintf(path, "%s/banks", store);
+    d = opendir(path);
+    while (d != NULL && (de = readdir(d)) != NULL) {
+        if (strlen(de->d_name) != 2) {
+            continue;
+        }
+        sprintf(path, "%s/banks/%s", store, de->d_name);
+        sub = opendir(path);
+        while (sub != NULL && (se = readdir(sub)) != NULL) {
+            /* leftovers of interrupted writes do not count */
+            if (strlen(se->d_name) != STORE_HASH_LEN) {
+                continue;
+            }
+            sprintf(path, "%s/banks/%s/%s", store, de->d_name, se->d_name);
+            if (stat(path, &st) == 0) {
+                stats[2]++;
+                stats[3] += (unsigned long)st.st_size;
+            }
+        }
+        if (sub != NULL) {
+            closedir(sub);
+        }
+    }
+    if (d != NULL) {
+        closedir(d);
+    }
+    free(path);
+}
+
+static int store_info(cartconv_t *cc, const char *store)
+{
+    /* carts, their size, stored banks, size of the banks and manifests */
+    unsigned long stats[4] = { 0, 0, 0, 0 };
+    struct stat st;
+
+    if (stat(store, &st) < 0 || !S_ISDIR(st.st_mode)) {
+        cc_error(cc, "Error: Can't open directory %s\n", store);
+        return -1;
+    }
+    store_scan_manifests(store, 1, stats);
+    store_scan_banks(store, stats);
+    fprintf(cc->out, "Store %s: %lu carts ($%06lx bytes), %lu unique banks, $%06lx bytes stored, %ld%% saved.\n",
+            store, stats[0], stats[1], stats[2], stats[3],
+            (stats[1] > 0) ? (long)(((double)stats[1] - (double)stats[3]) * 100.0 / (double)stats[1]) : 0L);
+    return 0;
+}
+
+/* rom database: printbanks looks up the checksums of the image and of its
+   chips, cartconv_romdb_import() builds the database from DAT files and
+   known good .crt files */
+
+typedef struct romdb_match_s {
+    const char *title;          /* the strings are stored once, the same title is the same pointer */
+    const char *version;
+    unsigned int chips;         /* number of chips of the image that are in the title */
+    unsigned int last;          /* the last of them, a chip counts once per title */
+} romdb_match_t;
+
+static void print_romdb_title(cartconv_t *cc, const char *title, const char *version)
+{
+    fprintf(cc->out, "%s%s%s%s", title, *version ? " (" : "", version, *version ? ")" : "");
+}
+
+/* the title of the whole image, or else the title most chips belong to and
+   the chips that differ from it. empty chips are left out, they are the same
+   in too many carts to tell anything */
+static void print_romdb(cartconv_t *cc, const crt_chip_t *chips, const hash_digests_t *digests, unsigned int num,
+                        const hash_digests_t *image)
+{
+    const romdb_entry_t *e;
+    romdb_match_t *matches = NULL, *p;
+    unsigned int matches_num = 0, matches_max = 0, known = 0, best = 0;
+    unsigned int i, j, n;
+    const char *title;
+
+    n = romdb_find(cc->romdb, image->sha1, &e);
+    for (i = 0; i < n; i++) {
+        if (romdb_bank(&e[i]) == ROMDB_IMAGE) {
+            fprintf(cc->out, "romdb: ");
+            print_romdb_title(cc, romdb_title(cc->romdb, &e[i]), romdb_version(cc->romdb, &e[i]));
+            fprintf(cc->out, "\n");
+            return;
+        }
+    }
+
+    for (i = 0; i < num && digests != NULL; i++) {
+        if (is_empty_data(chips[i].data, chips[i].avail)) {
+            continue;
+        }
+        known++;
+        n = romdb_find(cc->romdb, digests[i].sha1, &e);
+        for (j = 0; j < n; j++) {
+            if (romdb_bank(&e[j]) == ROMDB_IMAGE) {
+                continue;
+            }
+            title = romdb_title(cc->romdb, &e[j]);
+            for (best = 0; best < matches_num && matches[best].title != title; best++) {
+            }
+            if (best == matches_num) {
+                if (matches_num == matches_max) {
+                    p = realloc(matches, (matches_max ? matches_max * 2 : 16) * sizeof(romdb_match_t));
+                    if (p == NULL) {
+                        continue;
+                    }
+                    matches = p;
+                    matches_max = matches_max ? matches_max * 2 : 16;
+                }
+                matches[best].title = title;
+                matches[best].version = romdb_version(cc->romdb, &e[j]);
+                matches[best].chips = 0;
+                matches[best].last = num;
+                matches_num++;
+            }
+            if (matches[best].last != i) {
+                matches[best].last = i;
+                matches[best].chips++;
+            }
+        }
+    }
+
+    if (matches_num == 0) {
+        fprintf(cc->out, "romdb: unknown\n");
+        return;
+    }
+    for (i = 1, best = 0; i < matches_num; i++) {
+        if (matches[i].chips > matches[best].chips) {
+            best = i;
+        }
+    }
+    fprintf(cc->out, "romdb: closest ");
+    print_romdb_title(cc, matches[best].title, matches[best].version);
+    fprintf(cc->out, ", %u of %u chips match\n", matches[best].chips, known);
+    for (i = 0; i < num; i++) {
+        if (is_empty_data(chips[i].data, chips[i].avail)) {
+            continue;
+        }
+        n = romdb_find(cc->romdb, digests[i].sha1, &e);
+        for (j = 0; j < n && romdb_title(cc->romdb, &e[j]) != matches[best].title; j++) {
+        }
+        if (j == n) {
+            fprintf(cc->out, "  modified: #%03u $%04x\n", chips[i].bank, chips[i].start);
+        }
+    }
+    free(matches);
+}
+
+/* the name of a file without its dir and extension */
+static char *romdb_file_title(const char *name)
+{
+    const char *base = strrchr(name, '/');
+    char *title, *ext;
+
+    title = strdup(base ? base + 1 : name);
+    if (title != NULL && (ext = strrchr(title, '.')) != NULL && ext != title) {
+        *ext = 0;
+    }
+    return title;
+}
+
+static void romdb_sha1(const unsigned char *data, size_t size, unsigned char *digest)
+{
+    sha1_ctx_t ctx;
+
+    sha1_init(&ctx);
+    sha1_update(&ctx, data, size);
+    sha1_final(&ctx, digest);
+}
+
+/* a .crt file is taken as a known good release: the whole image and every
+   chip that is not empty, under the name of the file */
+static int romdb_import_crt(romdb_builder_t *b, const mapped_file_t *m, const char *name)
+{
+    unsigned char sha1[SHA1_DIGEST_SIZE];
+    crt_chip_t *chips = NULL;
+    unsigned int num, complete, i;
+    char *title;
+    int added = -1;
+
+    title = romdb_file_title(name);
+    if (title == NULL || crt_walk_chips(m, 0, &chips, &num, &complete) < 0) {
+        free(title);
+        return -1;
+    }
+    romdb_sha1(m->data, m->size, sha1);
+    if (romdb_builder_add(b, sha1, title, "", ROMDB_IMAGE, 0) < 0) {
+        goto out;
+    }
+    added = 1;
+    for (i = 0; i < complete; i++) {
+        if (!is_empty_data(chips[i].data, chips[i].avail)) {
+            romdb_sha1(chips[i].data, chips[i].avail, sha1);
+            if (romdb_builder_add(b, sha1, title, "", chips[i].bank, chips[i].start) < 0) {
+                added = -1;
+                goto out;
+            }
+            added++;
+        }
+    }
+out:
+    free(chips);
+    free(title);
+    return added;
+}
+
+/* a .crt or a DAT file, all files but .crt, .dat and .xml are skipped in dirs */
+static int romdb_import_file(cartconv_t *cc, romdb_builder_t *b, const char *name, int in_dir, unsigned long *stats)
+{
+    const char *ext = strrchr(name, '.');
+    mapped_file_t m;
+    int is_crt, n;
+
+    if (in_dir && (ext == NULL || (strcasecmp(ext, ".crt") && strcasecmp(ext, ".dat") && strcasecmp(ext, ".xml")))) {
+        return 0;
+    }
+    if (map_input_file(&m, name) < 0) {
+        cc_error(cc, "Error: Can't open input file %s\n", name);
+        return -1;
+    }
+    is_crt = (m.size >= 0x40 && !memcmp(m.data, "C64 CARTRIDGE   ", 16));
+    if (is_crt) {
+        n = romdb_import_crt(b, &m, name);
+    } else {
+        n = romdb_builder_add_dat(b, (const char *)m.data, m.size);
+    }
+    unmap_input_file(&m);
+    if (n < 0) {
+        cc_error(cc, "Error: out of memory.\n");
+        return -1;
+    }
+    if (n == 0 && !in_dir) {
+        fprintf(cc->err, "Warning: no roms found in %s\n", name);
+    }
+    stats[0]++;
+    stats[1] += (unsigned long)n;
+    return 0;
+}
+
+static int romdb_import_dir(cartconv_t *cc, romdb_builder_t *b, const char *dir, unsigned long *stats)
+{
+    DIR *d;
+    struct dirent *de;
+    struct stat st;
+    char *path;
+    int result = 0;
+
+    d = opendir(dir);
+    if (d == NULL) {
+        cc_error(cc, "Error: Can't open directory %s\n", dir);
+        return -1;
+    }
+    while (result == 0 && (de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.') {
+            continue;
+        }
+        path = malloc(strlen(dir) + strlen(de->d_name) + 2);
+        if (path == NULL) {
+            result = -1;
+            break;
+        }
+        sprintf(path, "%s/%s", dir, de->d_name);
+        if (stat(path, &st) < 0) {
+            free(path);
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            result = romdb_import_dir(cc, b, path, stats);
+        } else if (S_ISREG(st.st_mode)) {
+            result = romdb_import_file(cc, b, path, 1, stats);
+        }
+        free(path);
+    }
+    closedir(d);
+    return result;
+}
+
+static int romdb_import(cartconv_t *cc, const char *name, const char **sources, int num)
+{
+    romdb_builder_t *b;
+    romdb_t *db;
+    struct stat st;
+    /* files and entries */
+    unsigned long stats[2] = { 0, 0 };
+    int i, result = 0;
+
+    b = romdb_builder_new();
+    if (b == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        return -1;
+    }
+    /* the entries of the database are kept */
+    db = romdb_open(name);
+    if (db != NULL) {
+        result = romdb_builder_add_db(b, db);
+        romdb_close(db);
+        if (result < 0) {
+            cc_error(cc, "Error: out of memory.\n");
+        }
+    } else if (errno != ENOENT) {
+        cc_error(cc, (errno == EINVAL) ? "Error: %s is no rom database\n" : "Error: Can't open rom database %s\n", name);
+        result = -1;
+    }
+    for (i = 0; i < num && result == 0; i++) {
+        if (stat(sources[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            result = romdb_import_dir(cc, b, sources[i], stats);
+        } else {
+            result = romdb_import_file(cc, b, sources[i], 0, stats);
+        }
+    }
+    if (result == 0) {
+        if (romdb_builder_write(b, name) < 0) {
+            cc_error(cc, "Error: Can't write to file %s\n", name);
+            result = -1;
+        } else if (!cc->quiet_mode) {
+            fprintf(cc->out, "Imported %lu entries of %lu files into %s\n", stats[1], stats[0], name);
+        }
+    }
+    romdb_builder_free(b);
+    return result;
+}
+
+void cartconv_print_types(FILE *f)
+{
+    const cart_registry_t *r = get_cart_registry();
+    unsigned int i;
+    int id;
+
+    fprintf(f, "supported cart types:\n\n");
+
+    fprintf(f, "bin      Binary .bin file (Default crt->bin)\n");
+    fprintf(f, "prg      Binary C64 .prg file with load-address\n\n");
+    fprintf(f, "normal   Generic 8KiB/12KiB/16KiB .crt file (Default bin->crt)\n");
+    fprintf(f, "ulti     Ultimax mode 4KiB/8KiB/16KiB .crt file\n\n");
+
+    for (i = 0; i < r->listed_num; i++) {
+        id = r->listed[i];
+        fprintf(f, "%-8s %2d %s .crt file%s\n", cart_info[id].opt, id, cart_info[id].name,
+                cart_takes_inserts(id) ? ", extra files can be inserted" : "");
+    }
+}
+
+int cartconv_get_type(int index, cartconv_type_t *type)
+{
+    const cart_registry_t *r = get_cart_registry();
+    int id;
+
+    if (index < 0 || (unsigned int)index >= r->convertible_num) {
+        return -1;
+    }
+    id = r->convertible[index];
+    type->id = id;
+    type->opt = cart_info[id].opt;
+    type->name = cart_info[id].name;
+    type->sizes = cart_info[id].sizes;
+    type->insertion = cart_takes_inserts(id);
+    return 0;
+}
+
+/* the library interface, see cartconv.h */
+
+cartconv_t *cartconv_new(void)
+{
+    cartconv_t *cc = calloc(1, sizeof(cartconv_t));
+
+    if (cc == NULL) {
+        return NULL;
+    }
+    cc->out = stdout;
+    cc->err = stderr;
+    cc->outfd = STDOUT_FILENO;
+    cc->cart_type = -1;
+    cc->omit_empty_banks = 1;
+    cc->extract_files = 1;
+    cc->extract_dirfd = AT_FDCWD;
+    cc->inmap.fd = -1;
+    return cc;
+}
+
+void cartconv_reset(cartconv_t *cc)
+{
+    int i;
+
+    close_input_file(cc);
+    edit_free_ops(cc);
+    for (i = 0; i < 33; i++) {
+        free(cc->input_filename[i]);
+        cc->input_filename[i] = NULL;
+    }
+    cc->input_filenames = 0;
+    free(cc->output_filename);
+    cc->output_filename = NULL;
+    free(cc->cart_name);
+    cc->cart_name = NULL;
+    cartconv_set_checksum_file(cc, NULL);
+    cartconv_set_extract_dir(cc, NULL);
+    cartconv_set_flags(cc, 0);
+    cc->outfile = NULL;
+    cc->outstream = NULL;
+    cc->load_address = 0;
+    cc->cart_type = -1;
+    cc->cart_subtype = 0;
+    cc->convert_to_bin = 0;
+    cc->convert_to_prg = 0;
+    cc->convert_to_ultimax = 0;
+    cc->loadfile_is_crt = 0;
+    cc->loadfile_is_ultimax = 0;
+    cc->error[0] = 0;
+}
+
+void cartconv_free(cartconv_t *cc)
+{
+    int i;
+
+    if (cc == NULL) {
+        return;
+    }
+    close_input_file(cc);
+    edit_free_ops(cc);
+    free(cc->crtchips);
+    free(cc->output_filename);
+    free(cc->cart_name);
+    free(cc->checksum_filename);
+    romdb_close(cc->romdb);
+    free(cc->extracted);
+    for (i = 0; i < 33; i++) {
+        free(cc->input_filename[i]);
+    }
+    if (cc->extract_dirfd >= 0) {
+        close(cc->extract_dirfd);
+    }
+    abort_crt_output(cc);
+    free(cc->crtout.parts);
+    free(cc->layout_chips);
+    free(cc->crtout.iov);
+    free(cc->crtout.fill);
+    free(cc->filebuffer);
+    free(cc);
+}
+
+void cartconv_set_streams(cartconv_t *cc, FILE *out, FILE *err)
+{
+    cc->out = out;
+    cc->err = err;
+}
+
+const char *cartconv_error(const cartconv_t *cc)
+{
+    return cc->error;
+}
+
+int cartconv_set_type(cartconv_t *cc, const char *type)
+{
+    int i;
+
+    cc->cart_type = -1;
+    cc->convert_to_bin = 0;
+    cc->convert_to_prg = 0;
+    cc->convert_to_ultimax = 0;
+
+    i = find_cart_type(type);
+    if (i < 0) {
+        if (!strcmp(type, "bin")) {
+            cc->convert_to_bin = 1;
+        } else if (!strcmp(type, "normal")) {
+            cc->cart_type = CARTRIDGE_CRT;
+        } else if (!strcmp(type, "prg")) {
+            cc->convert_to_prg = 1;
+        } else if (!strcmp(type, "ulti")) {
+            cc->cart_type = CARTRIDGE_CRT;
+            cc->convert_to_ultimax = 1;
+        } else {
+            cc_error(cc, "Error: unknown cart type %s\n", type);
+            return -1;
+        }
+    } else {
+        cc->cart_type = (signed char)i;
+        if (cc->cart_type == 61) { /* MAX Basic */
+            cc->convert_to_ultimax = 1;
+        }
+    }
+    return 0;
+}
+
+int cartconv_set_name(cartconv_t *cc, const char *name)
+{
+    char *p = strdup(name);
+
+    if (p == NULL) {
+        return -1;
+    }
+    free(cc->cart_name);
+    cc->cart_name = p;
+    return 0;
+}
+
+void cartconv_set_subtype(cartconv_t *cc, int subtype)
+{
+    cc->cart_subtype = (unsigned char)subtype;
+}
+
+void cartconv_set_load_address(cartconv_t *cc, int address)
+{
+    cc->load_address = address;
+}
+
+void cartconv_set_flags(cartconv_t *cc, int flags)
+{
+    cc->repair_mode = (flags & CARTCONV_REPAIR) ? 1 : 0;
+    cc->input_padding = (flags & CARTCONV_PAD_INPUT) ? 1 : 0;
+    cc->omit_empty_banks = (flags & CARTCONV_ALL_BANKS) ? 0 : 1;
+    cc->quiet_mode = (flags & CARTCONV_QUIET) ? 1 : 0;
+    cc->verify = (flags & CARTCONV_VERIFY) ? 1 : 0;
+    cc->extract_files = (flags & CARTCONV_NO_FILES) ? 0 : 1;
+}
+
+void cartconv_set_threads(cartconv_t *cc, int threads)
+{
+    cc->extract_threads = threads;
+}
+
+int cartconv_set_checksum_file(cartconv_t *cc, const char *name)
+{
+    char *p = NULL;
+
+    if (name != NULL && (p = strdup(name)) == NULL) {
+        return -1;
+    }
+    free(cc->checksum_filename);
+    cc->checksum_filename = p;
+    return 0;
+}
+
+int cartconv_set_romdb(cartconv_t *cc, const char *name)
+{
+    romdb_t *db = NULL;
+
+    if (name != NULL && (db = romdb_open(name)) == NULL) {
+        cc_error(cc, (errno == EINVAL) ? "Error: %s is no rom database\n" : "Error: Can't open rom database %s\n", name);
+        return -1;
+    }
+    romdb_close(cc->romdb);
+    cc->romdb = db;
+    return 0;
+}
+
+int cartconv_set_extract_dir(cartconv_t *cc, const char *dir)
+{
+    int fd = AT_FDCWD;
+
+    if (dir != NULL) {
+        fd = open(dir, O_RDONLY | O_DIRECTORY);
+        if (fd < 0) {
+            cc_error(cc, "Error: Can't open directory %s\n", dir);
+            return -1;
+        }
+    }
+    if (cc->extract_dirfd >= 0) {
+        close(cc->extract_dirfd);
+    }
+    cc->extract_dirfd = fd;
+    return 0;
+}
+
+void cartconv_set_output_fd(cartconv_t *cc, int fd)
+{
+    cc->outfd = fd;
+}
+
+int cartconv_add_input(cartconv_t *cc, const char *name)
+{
+    if (cc->input_filenames == 33) {
+        return too_many_inputs(cc);
+    }
+    cc->input_filename[cc->input_filenames] = strdup(name);
+    cc->input_filenames++;
+    return 0;
+}
+
+int cartconv_num_inputs(const cartconv_t *cc)
+{
+    return cc->input_filenames;
+}
+
+int cartconv_input_is_crt(const cartconv_t *cc)
+{
+    return cc->loaded && cc->loadfile_is_crt;
+}
+
+static int set_output_name(cartconv_t *cc, const char *name)
+{
+    char *p = strdup(name);
+
+    if (p == NULL) {
+        return -1;
+    }
+    free(cc->output_filename);
+    cc->output_filename = p;
+    return 0;
+}
+
+/* the first input name is used in the messages, give unnamed input one */
+static void set_input_name(cartconv_t *cc, const char *name)
+{
+    if (cc->input_filenames == 0) {
+        cartconv_add_input(cc, name);
+    }
+}
+
+int cartconv_load_file(cartconv_t *cc, const char *name)
+{
+    set_input_name(cc, name);
+    if (load_input_file(cc, name) < 0) {
+        return -1;
+    }
+    cc->loaded = 1;
+    cc->inmap_name = strdup(name);
+    return 0;
+}
+
+int cartconv_load_fd(cartconv_t *cc, int fd)
+{
+    set_input_name(cc, "-");
+    close_input_file(cc);
+    if (map_input_fd(&cc->inmap, dup(fd)) < 0) {
+        cc_error(cc, "Error: Can't read %s\n", cc->input_filename[0]);
+        return -1;
+    }
+    if (load_mapped_input(cc, cc->input_filename[0]) < 0) {
+        return -1;
+    }
+    cc->loaded = 1;
+    return 0;
+}
+
+int cartconv_load_buffer(cartconv_t *cc, const void *data, size_t size)
+{
+    set_input_name(cc, "(buffer)");
+    close_input_file(cc);
+    cc->inmap.fd = -1;
+    cc->inmap.data = (unsigned char *)data;
+    cc->inmap.size = size;
+    cc->inmap.is_mapped = 2;
+    if (load_mapped_input(cc, cc->input_filename[0]) < 0) {
+        return -1;
+    }
+    cc->loaded = 1;
+    return 0;
+}
+
+int cartconv_convert(cartconv_t *cc, const char *output_name)
+{
+    if (set_output_name(cc, output_name) < 0) {
+        return -1;
+    }
+    if (!cc->loaded) {
+        if (cc->input_filenames == 0) {
+            cc_error(cc, "Error: no input filename\n");
+            return -1;
+        }
+        if (cartconv_load_file(cc, cc->input_filename[0]) < 0) {
+            return -1;
+        }
+    }
+    /* cartconv_convert_buffer() verifies its buffer itself */
+    if (verify_applies(cc) && cc->outstream == NULL) {
+        return convert_verified(cc);
+    }
+    return convert_loaded_file(cc);
+}
+
+int cartconv_convert_fd(cartconv_t *cc, int fd)
+{
+    int outfd = cc->outfd;
+    int result;
+
+    cc->outfd = fd;
+    result = cartconv_convert(cc, "-");
+    cc->outfd = outfd;
+    return result;
+}
+
+int cartconv_convert_buffer(cartconv_t *cc, unsigned char **data, size_t *size)
+{
+    verify_input_t in;
+    char *buf = NULL;
+    size_t len = 0;
+    int verify, result;
+
+    if (!cc->loaded && cc->input_filenames > 0 && cartconv_load_file(cc, cc->input_filename[0]) < 0) {
+        return -1;
+    }
+    verify = verify_applies(cc);
+    if (verify && verify_capture(cc, &in) < 0) {
+        return -1;
+    }
+    cc->outstream = open_memstream(&buf, &len);
+    if (cc->outstream == NULL) {
+        cc_error(cc, "Error: out of memory.\n");
+        if (verify) {
+            verify_free(&in);
+        }
+        return -1;
+    }
+    /* the stream is closed by the conversion once it has been opened as output */
+    cc->outfile = NULL;
+    result = cartconv_convert(cc, "(buffer)");
+    if (result < 0 && cc->outfile != cc->outstream) {
+        fclose(cc->outstream);
+    }
+    cc->outstream = NULL;
+    cc->outfile = NULL;
+    if (verify) {
+        if (result == 0) {
+            result = verify_crt(cc, &in, (unsigned char *)buf, len);
+        }
+        if (result == 0) {
+            verify_ok(cc, &in);
+        }
+        verify_free(&in);
+    }
+    if (result < 0) {
+        free(buf);
+        return -1;
+    }
+    *data = (unsigned char *)buf;
+    *size = len;
+    return 0;
+}
+
+int cartconv_convert_stream(cartconv_t *cc, int fd, const char *output_name)
+{
+    FILE *in;
+    int infd, result;
+
+    if (set_output_name(cc, output_name) < 0) {
+        return -1;
+    }
+    set_input_name(cc, "-");
+    infd = dup(fd);
+    in = (infd < 0) ? NULL : fdopen(infd, "rb");
+    if (in == NULL) {
+        if (infd >= 0) {
+            close(infd);
+        }
+        cc_error(cc, "Error: Can't read %s\n", cc->input_filename[0]);
+        return -1;
+    }
+    result = stream_crt_to_bin(cc, in);
+    fclose(in);
+    return result;
+}
+
+int cartconv_extract(cartconv_t *cc, const char *name)
+{
+    return printinfo(cc, name);
+}
+
+int cartconv_get_header(const cartconv_t *cc, cartconv_header_t *header)
+{
+    if (!cc->extracted_valid) {
+        return -1;
+    }
+    *header = cc->extracted_header;
+    return 0;
+}
+
+int cartconv_get_chips(const cartconv_t *cc, const cartconv_chip_t **chips)
+{
+    *chips = cc->extracted_valid ? cc->extracted : NULL;
+    return cc->extracted_valid ? (int)cc->extracted_num : 0;
+}
+
+int cartconv_analyze(cartconv_t *cc, const char *name)
+{
+    return analyze_banks(cc, name);
+}
+
+int cartconv_catalog(cartconv_t *cc, const char *source, int format)
+{
+    return catalog(cc, source, format);
+}
+
+int cartconv_detect(cartconv_t *cc, const char *name, cartconv_guess_t *guesses, int max)
+{
+    return detect_type(cc, name, guesses, (max < 0) ? 0 : max);
+}
+
+int cartconv_join(cartconv_t *cc, const char *source, const char *output_name)
+{
+    if (set_output_name(cc, output_name) < 0) {
+        return -1;
+    }
+    return join_banks(cc, source);
+}
+
+int cartconv_add_edit(cartconv_t *cc, int op, const char *arg)
+{
+    if (op != CARTCONV_EDIT_REPLACE && op != CARTCONV_EDIT_APPEND && op != CARTCONV_EDIT_PATCH) {
+        cc_error(cc, "Error: unknown edit operation %d\n", op);
+        return -1;
+    }
+    return edit_add_op(cc, op, arg);
+}
+
+int cartconv_num_edits(const cartconv_t *cc)
+{
+    return (int)cc->edit_ops_num;
+}
+
+int cartconv_edit(cartconv_t *cc, const char *name)
+{
+    return edit_crt(cc, name);
+}
+
+int cartconv_romdb_import(cartconv_t *cc, const char *db, const char **sources, int num)
+{
+    return romdb_import(cc, db, sources, num);
+}
+
+int cartconv_store(cartconv_t *cc, const char *store, const char *manifest)
+{
+    char *name;
+    unsigned int i;
+    int result = 0;
+
+    if (cc->input_filenames == 0 || (manifest != NULL && cc->input_filenames > 1)) {
+        cc_error(cc, "Error: %s input files to store\n", (cc->input_filenames == 0) ? "no" : "too many");
+        return -1;
+    }
+    for (i = 0; i < cc->input_filenames && result == 0; i++) {
+        name = (manifest != NULL) ? strdup(manifest) : store_manifest_name(cc->input_filename[i]);
+        if (name == NULL) {
+            cc_error(cc, "Error: out of memory.\n");
+            return -1;
+        }
+        result = store_crt(cc, store, cc->input_filename[i], name);
+        free(name);
+    }
+    return result;
+}
+
+int cartconv_restore(cartconv_t *cc, const char *manifest, const char *output_name)
+{
+    if (set_output_name(cc, output_name) < 0) {
+        return -1;
+    }
+    return restore_crt(cc, manifest);
+}
+
+int cartconv_store_info(cartconv_t *cc, const char *store)
+{
+    return store_info(cc, store);
+}
@@ -0,0 +1,210 @@
+/** \file   cartconv.h
+ * \brief   Cartridge Conversion library
+ *
+ * \author  Marco van den heuvel <blackystardust68@yahoo.com>
+ * \author  groepaz <groepaz@gmx.net>
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef CARTCONV_H
+#define CARTCONV_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* all state of a conversion lives in a context, different contexts can be
+   used from different threads at the same time. all calls return 0 on
+   success and -1 on error, the error message is printed to the error stream
+   of the context and can also be fetched with cartconv_error(). */
+
+typedef struct cartconv_s cartconv_t;
+
+/* flags for cartconv_set_flags() */
+#define CARTCONV_REPAIR     0x01    /* accept broken input files (-r) */
+#define CARTCONV_PAD_INPUT  0x02    /* accept non padded binaries (-p) */
+#define CARTCONV_ALL_BANKS  0x04    /* do not omit empty banks (-b) */
+#define CARTCONV_QUIET      0x08    /* no messages on success (-q) */
+#define CARTCONV_VERIFY     0x10    /* read a new .crt back and compare it with the input (--verify) */
+#define CARTCONV_NO_FILES   0x20    /* cartconv_extract() only prints, no header and bank files */
+
+/* operations for cartconv_add_edit() */
+#define CARTCONV_EDIT_REPLACE 0     /* bank:addr=file */
+#define CARTCONV_EDIT_APPEND  1     /* bank:addr=file */
+#define CARTCONV_EDIT_PATCH   2     /* field=value */
+
+cartconv_t *cartconv_new(void);
+void cartconv_free(cartconv_t *cc);
+/* forget the inputs, output and options of the last job but keep the
+   buffers, for a context that does one job after the other. the streams,
+   the output fd and the thread count are kept as well */
+void cartconv_reset(cartconv_t *cc);
+
+/* messages go to out (default stdout), errors and warnings to err (default stderr) */
+void cartconv_set_streams(cartconv_t *cc, FILE *out, FILE *err);
+const char *cartconv_error(const cartconv_t *cc);
+
+/* options, like the command line switches of the same meaning */
+int cartconv_set_type(cartconv_t *cc, const char *type);  /* -t, an option or a type name, -1 if unknown */
+int cartconv_set_name(cartconv_t *cc, const char *name);  /* -n */
+void cartconv_set_subtype(cartconv_t *cc, int subtype);   /* -s */
+void cartconv_set_load_address(cartconv_t *cc, int address); /* -l */
+void cartconv_set_flags(cartconv_t *cc, int flags);
+void cartconv_set_threads(cartconv_t *cc, int threads);   /* -f extraction threads, 0 = one per cpu */
+/* also write the checksums of every chip and of the whole file to this
+   file when extracting (--checksums), NULL for none */
+int cartconv_set_checksum_file(cartconv_t *cc, const char *name);
+/* the rom database that cartconv_extract() looks up the image and its chips
+   in (--romdb), NULL for none */
+int cartconv_set_romdb(cartconv_t *cc, const char *name);
+/* the directory that cartconv_extract() writes to, NULL for the current one */
+int cartconv_set_extract_dir(cartconv_t *cc, const char *dir);
+/* the fd that the output name "-" refers to, default stdout */
+void cartconv_set_output_fd(cartconv_t *cc, int fd);
+
+/* input files, the first one is converted, further ones are inserted into
+   Dela/Rex eprom carts. -1 if there are too many. */
+int cartconv_add_input(cartconv_t *cc, const char *name);
+int cartconv_num_inputs(const cartconv_t *cc);
+
+/* parse an input file (.crt or binary) without converting it yet. the
+   buffer is used in place and has to stay valid until the conversion is done */
+int cartconv_load_file(cartconv_t *cc, const char *name);
+int cartconv_load_fd(cartconv_t *cc, int fd);              /* fd is not closed */
+int cartconv_load_buffer(cartconv_t *cc, const void *data, size_t size);
+/* 1 if the loaded input is a .crt file, 0 for a binary */
+int cartconv_input_is_crt(const cartconv_t *cc);
+
+/* convert the loaded input (or the first input file if nothing is loaded)
+   to a file, an fd or a malloc'ed buffer that the caller has to free */
+int cartconv_convert(cartconv_t *cc, const char *output_name);
+int cartconv_convert_fd(cartconv_t *cc, int fd);
+int cartconv_convert_buffer(cartconv_t *cc, unsigned char **data, size_t *size);
+
+/* convert a .crt read from fd to binary strictly forward, for pipes */
+int cartconv_convert_stream(cartconv_t *cc, int fd, const char *output_name);
+
+/* print the header and chip table of a .crt file with the CRC32 and SHA-1
+   of every chip, and write the header and bank files into the current
+   directory (-f). a .crt loaded with cartconv_load_file() under the same
+   name is not read again */
+int cartconv_extract(cartconv_t *cc, const char *name);
+
+/* the header and the chip table of the .crt of the last cartconv_extract(),
+   for callers that want the fields and not the text. the checksums are the
+   ones of the table, size/crc32/sha1 of the header are the ones of the file.
+   cartconv_get_header() is -1 if the last file was no .crt, the chips stay
+   valid until the next cartconv_extract() */
+typedef struct cartconv_header_s {
+    int version;                /* major << 8 | minor */
+    int id;
+    const char *type;
+    int exrom;
+    int game;
+    int revision;
+    char name[0x20 + 1];
+    unsigned long size;
+    unsigned int crc32;
+    unsigned char sha1[20];
+} cartconv_header_t;
+
+typedef struct cartconv_chip_s {
+    unsigned long offset;
+    unsigned int type;
+    unsigned int bank;
+    unsigned int start;
+    unsigned int size;
+    unsigned int crc32;
+    unsigned char sha1[20];
+} cartconv_chip_t;
+
+int cartconv_get_header(const cartconv_t *cc, cartconv_header_t *header);
+int cartconv_get_chips(const cartconv_t *cc, const cartconv_chip_t **chips);
+
+/* print a table of the used and free space and the entropy of every chip
+   of a .crt file, as comma separated values */
+int cartconv_analyze(cartconv_t *cc, const char *name);
+
+/* print one row per .crt file of a dir tree, a list file or a single .crt
+   file: version, hardware id, exrom/game, revision, name, number and size
+   of the chips and header warnings. only the header and the CHIP headers are
+   read, on several threads (cartconv_set_threads). -1 if a file is no .crt */
+#define CARTCONV_CATALOG_CSV  0
+#define CARTCONV_CATALOG_JSON 1     /* one JSON object per line */
+int cartconv_catalog(cartconv_t *cc, const char *source, int format);
+
+/* a guess of cartconv_detect(), the score goes from 1 to 100 */
+typedef struct cartconv_guess_s {
+    int id;                 /* hardware type, 0 for the generic carts */
+    const char *opt;        /* -t option, "normal" or "ulti" for the generic carts */
+    const char *name;
+    int score;
+} cartconv_guess_t;
+
+/* rank the cart types a binary can be converted to, by its size, the CBM80
+   and reset vector signatures, the I/O registers its code accesses and its
+   mirrored and empty banks. fills in up to max guesses, best first, and
+   returns how many. a .crt file gives its own type with score 100 */
+int cartconv_detect(cartconv_t *cc, const char *name, cartconv_guess_t *guesses, int max);
+
+/* rebuild a .crt file from a directory written by cartconv_extract() and the
+   extra bank files added with cartconv_add_input() */
+int cartconv_join(cartconv_t *cc, const char *source, const char *output_name);
+
+/* change a .crt file in place with the operations added before */
+int cartconv_add_edit(cartconv_t *cc, int op, const char *arg);
+int cartconv_num_edits(const cartconv_t *cc);
+int cartconv_edit(cartconv_t *cc, const char *name);
+
+/* add the roms of DAT files (clrmamepro or XML), the images and chips of
+   .crt files and all of these files in dir trees to the rom database db,
+   which is created if it does not exist */
+int cartconv_romdb_import(cartconv_t *cc, const char *db, const char **sources, int num);
+
+/* bank store: the data of every chip is stored once under its SHA-256 in
+   <store>/banks/, a cart as a manifest of its header and chips.
+   cartconv_store() stores the input files, manifest is the name of the
+   manifest relative to the store (only with one input file), NULL names it
+   after the input file. cartconv_restore() rebuilds the .crt file of a
+   manifest, cartconv_store_info() prints how much space the store saves. */
+int cartconv_store(cartconv_t *cc, const char *store, const char *manifest);
+int cartconv_restore(cartconv_t *cc, const char *manifest, const char *output_name);
+int cartconv_store_info(cartconv_t *cc, const char *store);
+
+/* the -t types that cartconv_set_type() knows */
+void cartconv_print_types(FILE *f);
+
+/* the .crt types that can be made from a binary, index counts from 0 and
+   -1 is returned past the last one. sizes is the or of the binary sizes the
+   type accepts (0x2000 | 0x4000 for 8KiB and 16KiB), a size is accepted
+   when all its bits are set in there. */
+typedef struct cartconv_type_s {
+    int id;                 /* hardware type in the .crt header */
+    const char *opt;        /* -t option */
+    const char *name;
+    unsigned int sizes;
+    int insertion;          /* extra files can be inserted (Dela/Rex) */
+} cartconv_type_t;
+
+int cartconv_get_type(int index, cartconv_type_t *type);
+
+#endif
@@ -0,0 +1,574 @@
+/** \file   hash.c
+ * \brief   Checksums and hashes of cartridge banks
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include "hash.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HASH_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+typedef void (*hash_blocks_t)(uint32_t *state, const unsigned char *data, size_t blocks);
+
+static uint32_t crc32_table[8][256];
+
+static void sha1_blocks_c(uint32_t *state, const unsigned char *data, size_t blocks);
+static void sha256_blocks_c(uint32_t *state, const unsigned char *data, size_t blocks);
+static void hash_init(void);
+
+/* the implementations for this cpu, set up once */
+static pthread_once_t hash_once = PTHREAD_ONCE_INIT;
+static hash_blocks_t sha1_blocks = sha1_blocks_c;
+static hash_blocks_t sha256_blocks = sha256_blocks_c;
+static int crc32_use_pclmul = 0;
+
+/* CRC-32 */
+
+#ifdef HASH_X86
+/* folds 64 bytes at a time with carry-less multiplies, then a Barrett
+   reduction to 32 bits, see Intel's "Fast CRC Computation for Generic
+   Polynomials Using PCLMULQDQ". size is at least 64 and a multiple of 16,
+   crc is the inverted crc like in the tables. */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul(uint32_t crc, const unsigned char *p, size_t size)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(p + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(p + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(p + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    p += 64;
+    size -= 64;
+
+    while (size >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *)(p + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *)(p + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *)(p + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *)(p + 0x30)));
+        p += 64;
+        size -= 64;
+    }
+
+    /* fold the four lanes into one */
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    while (size >= 16) {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)p)), x5);
+        p += 16;
+        size -= 16;
+    }
+
+    /* 128 to 64 bits */
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+#endif
+
+uint32_t crc32_update(uint32_t crc, const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    uint32_t c = ~crc;
+
+    pthread_once(&hash_once, hash_init);
+#ifdef HASH_X86
+    if (crc32_use_pclmul && size >= 64) {
+        size_t n = size & ~(size_t)15;
+
+
+        c = crc32_pclmul(c, p, n);
+        p += n;
+        size -= n;
+    }
+#elif defined(__ARM_FEATURE_CRC32)
+    while (size >= 8) {
+        uint64_t v;
+
+        memcpy(&v, p, 8);
+        c = __crc32d(c, v);
+        p += 8;
+        size -= 8;
+    }
+#endif
+    /* slicing by 8 */
+    while (size >= 8) {
+        c ^= (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        c = crc32_table[7][c & 0xff] ^ crc32_table[6][(c >> 8) & 0xff] ^
+            crc32_table[5][(c >> 16) & 0xff] ^ crc32_table[4][c >> 24] ^
+            crc32_table[3][p[4]] ^ crc32_table[2][p[5]] ^ crc32_table[1][p[6]] ^ crc32_table[0][p[7]];
+        p += 8;
+        size -= 8;
+    }
+    while (size--) {
+        c = crc32_table[0][(c ^ *p++) & 0xff] ^ (c >> 8);
+    }
+    return ~c;
+}
+
+/* a * b modulo the CRC polynomial, bit 31 is x^0 */
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t)1 << 31;
+    uint32_t p = 0;
+
+    while (1) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0xedb88320 : b >> 1;
+    }
+    return p;
+}
+
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t size2)
+{
+    uint32_t x = (uint32_t)1 << 31;     /* x^0 */
+    uint32_t sq = (uint32_t)1 << 23;    /* x^8, shifts by one byte */
+
+    /* crc1 shifted over size2 bytes of zeros, that is times x^(8 * size2) */
+    for (; size2 > 0; size2 >>= 1) {
+        if (size2 & 1) {
+            x = crc32_multmodp(sq, x);
+        }
+        sq = crc32_multmodp(sq, sq);
+    }
+    return crc32_multmodp(x, crc1) ^ crc2;
+}
+
+/* the block buffering and padding that SHA-1 and SHA-256 share */
+
+static void md_update(uint32_t *state, uint64_t *length, unsigned char *buf, unsigned int *buflen,
+                      hash_blocks_t blocks, const unsigned char *p, size_t size)
+{
+    size_t n;
+
+    *length += size;
+    if (*buflen > 0) {
+        n = 64 - *buflen;
+        if (n > size) {
+            n = size;
+        }
+        memcpy(buf + *buflen, p, n);
+        *buflen += (unsigned int)n;
+        p += n;
+        size -= n;
+        if (*buflen < 64) {
+            return;
+        }
+        blocks(state, buf, 1);
+        *buflen = 0;
+    }
+    /* whole blocks are hashed straight from the input */
+    if (size >= 64) {
+        blocks(state, p, size / 64);
+        p += size & ~(size_t)63;
+        size &= 63;
+    }
+    memcpy(buf, p, size);
+    *buflen = (unsigned int)size;
+}
+
+static void md_final(uint32_t *state, uint64_t length, unsigned char *buf, unsigned int buflen,
+                     hash_blocks_t blocks, unsigned int words, unsigned char *digest)
+{
+    uint64_t bits = length * 8;
+    unsigned int i;
+
+    buf[buflen++] = 0x80;
+    if (buflen > 56) {
+        memset(buf + buflen, 0, 64 - buflen);
+        blocks(state, buf, 1);
+        buflen = 0;
+    }
+    memset(buf + buflen, 0, 56 - buflen);
+    for (i = 0; i < 8; i++) {
+        buf[56 + i] = (unsigned char)(bits >> (56 - (i * 8)));
+    }
+    blocks(state, buf, 1);
+    for (i = 0; i < words; i++) {
+        digest[i * 4] = (unsigned char)(state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)state[i];
+    }
+}
+
+static uint32_t load_be32(const unsigned char *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/* SHA-1 as in FIPS 180-4 */
+
+static void sha1_blocks_c(uint32_t *state, const unsigned char *data, size_t blocks)
+{
+    uint32_t w[80];
+    uint32_t a, b, c, d, e, t;
+    unsigned int i;
+
+    while (blocks--) {
+        for (i = 0; i < 16; i++) {
+            w[i] = load_be32(data + (i * 4));
+        }
+        for (i = 16; i < 80; i++) {
+            w[i] = ROL32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        a = state[0]; b = state[1]; c = state[2]; d = state[3]; e = state[4];
+        for (i = 0; i < 80; i++) {
+            if (i < 20) {
+                t = ((b & c) | (~b & d)) + 0x5a827999;
+            } else if (i < 40) {
+                t = (b ^ c ^ d) + 0x6ed9eba1;
+            } else if (i < 60) {
+                t = ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;
+            } else {
+                t = (b ^ c ^ d) + 0xca62c1d6;
+            }
+            t += ROL32(a, 5) + e + w[i];
+            e = d; d = c; c = ROL32(b, 30); b = a; a = t;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d; state[4] += e;
+        data += 64;
+    }
+}
+
+#ifdef HASH_X86
+/* four rounds, g is the number of the group. the message schedule runs
+   ahead of the rounds in four registers that are used in turn. g is a
+   constant, so all the conditions are resolved by the compiler */
+#define SHA1_ROUNDS4(g)                                                                 \
+    do {                                                                                \
+        if ((g) < 4) {                                                                  \
+            msg[(g) & 3] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + ((g) * 16))), mask); \
+        }                                                                               \
+        if ((g) == 0) {                                                                 \
+            e[0] = _mm_add_epi32(e[0], msg[0]);                                         \
+        } else {                                                                        \
+            e[(g) & 1] = _mm_sha1nexte_epu32(e[(g) & 1], msg[(g) & 3]);                 \
+        }                                                                               \
+        e[((g) + 1) & 1] = abcd;                                                        \
+        if ((g) >= 3 && (g) <= 18) {                                                    \
+            msg[((g) + 1) & 3] = _mm_sha1msg2_epu32(msg[((g) + 1) & 3], msg[(g) & 3]);  \
+        }                                                                               \
+        abcd = _mm_sha1rnds4_epu32(abcd, e[(g) & 1], (g) / 5);                          \
+        if ((g) >= 1 && (g) <= 16) {                                                    \
+            msg[((g) - 1) & 3] = _mm_sha1msg1_epu32(msg[((g) - 1) & 3], msg[(g) & 3]);  \
+        }                                                                               \
+        if ((g) >= 2 && (g) <= 17) {                                                    \
+            msg[((g) - 2) & 3] = _mm_xor_si128(msg[((g) - 2) & 3], msg[(g) & 3]);       \
+        }                                                                               \
+    } while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha1_blocks_shani(uint32_t *state, const unsigned char *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+    __m128i abcd, abcd_save, e0_save, e[2], msg[4];
+
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1b);
+    e[0] = _mm_set_epi32((int)state[4], 0, 0, 0);
+    e[1] = _mm_setzero_si128();
+
+    while (blocks--) {
+        abcd_save = abcd;
+        e0_save = e[0];
+        SHA1_ROUNDS4(0); SHA1_ROUNDS4(1); SHA1_ROUNDS4(2); SHA1_ROUNDS4(3);
+        SHA1_ROUNDS4(4); SHA1_ROUNDS4(5); SHA1_ROUNDS4(6); SHA1_ROUNDS4(7);
+        SHA1_ROUNDS4(8); SHA1_ROUNDS4(9); SHA1_ROUNDS4(10); SHA1_ROUNDS4(11);
+        SHA1_ROUNDS4(12); SHA1_ROUNDS4(13); SHA1_ROUNDS4(14); SHA1_ROUNDS4(15);
+        SHA1_ROUNDS4(16); SHA1_ROUNDS4(17); SHA1_ROUNDS4(18); SHA1_ROUNDS4(19);
+        e[0] = _mm_sha1nexte_epu32(e[0], e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+        data += 64;
+    }
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = (uint32_t)_mm_extract_epi32(e[0], 3);
+}
+#endif
+
+void sha1_init(sha1_ctx_t *ctx)
+{
+    static const uint32_t init[5] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+    };
+
+    pthread_once(&hash_once, hash_init);
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->length = 0;
+    ctx->buflen = 0;
+}
+
+void sha1_update(sha1_ctx_t *ctx, const void *data, size_t size)
+{
+    md_update(ctx->state, &ctx->length, ctx->buf, &ctx->buflen, sha1_blocks, data, size);
+}
+
+void sha1_final(sha1_ctx_t *ctx, unsigned char *digest)
+{
+    md_final(ctx->state, ctx->length, ctx->buf, ctx->buflen, sha1_blocks, 5, digest);
+}
+
+/* SHA-256 as in FIPS 180-4 */
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void sha256_blocks_c(uint32_t *state, const unsigned char *data, size_t blocks)
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h, t1, t2;
+    unsigned int i;
+
+    while (blocks--) {
+        for (i = 0; i < 16; i++) {
+            w[i] = load_be32(data + (i * 4));
+        }
+        for (i = 16; i < 64; i++) {
+            t1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            t2 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            w[i] = w[i - 16] + t2 + w[i - 7] + t1;
+        }
+        a = state[0]; b = state[1]; c = state[2]; d = state[3];
+        e = state[4]; f = state[5]; g = state[6]; h = state[7];
+        for (i = 0; i < 64; i++) {
+            t1 = h + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+            t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        data += 64;
+    }
+}
+
+#ifdef HASH_X86
+/* like SHA1_ROUNDS4, the state is kept as ABEF/CDGH as the instructions want it */
+#define SHA256_ROUNDS4(g)                                                               \
+    do {                                                                                \
+        if ((g) < 4) {                                                                  \
+            msg[(g) & 3] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + ((g) * 16))), mask); \
+        }                                                                               \
+        m = _mm_add_epi32(msg[(g) & 3], _mm_loadu_si128((const __m128i *)&sha256_k[(g) * 4])); \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, m);                              \
+        if ((g) >= 3 && (g) <= 14) {                                                    \
+            tmp = _mm_alignr_epi8(msg[(g) & 3], msg[((g) - 1) & 3], 4);                 \
+            msg[((g) + 1) & 3] = _mm_add_epi32(msg[((g) + 1) & 3], tmp);                \
+            msg[((g) + 1) & 3] = _mm_sha256msg2_epu32(msg[((g) + 1) & 3], msg[(g) & 3]); \
+        }                                                                               \
+        m = _mm_shuffle_epi32(m, 0x0e);                                                 \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, m);                              \
+        if ((g) >= 1 && (g) <= 12) {                                                    \
+            msg[((g) - 1) & 3] = _mm_sha256msg1_epu32(msg[((g) - 1) & 3], msg[(g) & 3]); \
+        }                                                                               \
+    } while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_shani(uint32_t *state, const unsigned char *data, size_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+    __m128i state0, state1, abef_save, cdgh_save, m, tmp, msg[4];
+
+    tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);     /* CDAB */
+    state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);  /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);                                       /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);                                    /* CDGH */
+
+    while (blocks--) {
+        abef_save = state0;
+        cdgh_save = state1;
+        SHA256_ROUNDS4(0); SHA256_ROUNDS4(1); SHA256_ROUNDS4(2); SHA256_ROUNDS4(3);
+        SHA256_ROUNDS4(4); SHA256_ROUNDS4(5); SHA256_ROUNDS4(6); SHA256_ROUNDS4(7);
+        SHA256_ROUNDS4(8); SHA256_ROUNDS4(9); SHA256_ROUNDS4(10); SHA256_ROUNDS4(11);
+        SHA256_ROUNDS4(12); SHA256_ROUNDS4(13); SHA256_ROUNDS4(14); SHA256_ROUNDS4(15);
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+        data += 64;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);                                          /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xb1);                                       /* DCHG */
+    _mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, state1, 0xf0));     /* DCBA */
+    _mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(state1, tmp, 8));        /* HGFE */
+}
+#endif
+
+void sha256_init(sha256_ctx_t *ctx)
+{
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    pthread_once(&hash_once, hash_init);
+    memcpy(ctx->state, init, sizeof(init));
+    ctx->length = 0;
+    ctx->buflen = 0;
+}
+
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t size)
+{
+    md_update(ctx->state, &ctx->length, ctx->buf, &ctx->buflen, sha256_blocks, data, size);
+}
+
+void sha256_final(sha256_ctx_t *ctx, unsigned char *digest)
+{
+    md_final(ctx->state, ctx->length, ctx->buf, ctx->buflen, sha256_blocks, 8, digest);
+}
+
+void sha256(const void *data, size_t size, unsigned char *digest)
+{
+    sha256_ctx_t ctx;
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, size);
+    sha256_final(&ctx, digest);
+}
+
+static void hash_init(void)
+{
+    uint32_t c;
+    unsigned int i, j;
+#ifdef HASH_X86
+    unsigned int eax, ebx, ecx, edx;
+#endif
+
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (j = 0; j < 8; j++) {
+            c = (c & 1) ? (c >> 1) ^ 0xedb88320 : c >> 1;
+        }
+        crc32_table[0][i] = c;
+    }
+    for (i = 0; i < 256; i++) {
+        for (j = 1; j < 8; j++) {
+            crc32_table[j][i] = (crc32_table[j - 1][i] >> 8) ^ crc32_table[0][crc32_table[j - 1][i] & 0xff];
+        }
+    }
+
+#ifdef HASH_X86
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        /* PCLMULQDQ, SSSE3 and SSE4.1 */
+        if ((ecx & (1 << 1)) && (ecx & (1 << 9)) && (ecx & (1 << 19))) {
+            crc32_use_pclmul = 1;
+            if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1 << 29))) {
+                sha1_blocks = sha1_blocks_shani;
+                sha256_blocks = sha256_blocks_shani;
+            }
+        }
+    }
+#endif
+}
+
+void hash_digests(const void *data, size_t size, hash_digests_t *d)
+{
+    const unsigned char *p = data;
+    sha1_ctx_t sha1;
+    sha256_ctx_t sha256;
+    size_t n;
+
+    d->crc32 = 0;
+    sha1_init(&sha1);
+    sha256_init(&sha256);
+    /* in pieces that stay in the cache for all three */
+    while (size > 0) {
+        n = (size > 0x2000) ? 0x2000 : size;
+        d->crc32 = crc32_update(d->crc32, p, n);
+        sha1_update(&sha1, p, n);
+        sha256_update(&sha256, p, n);
+        p += n;
+        size -= n;
+    }
+    sha1_final(&sha1, d->sha1);
+    sha256_final(&sha256, d->sha256);
+}
+
+void hash_to_hex(const unsigned char *digest, size_t size, char *text)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        text[i * 2] = hex[digest[i] >> 4];
+        text[i * 2 + 1] = hex[digest[i] & 15];
+    }
+    text[size * 2] = 0;
+}
@@ -0,0 +1,81 @@
+/** \file   hash.h
+ * \brief   Checksums and hashes of cartridge banks
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef CARTCONV_HASH_H
+#define CARTCONV_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* the CRC/SHA instructions of the cpu are used when it has them, this is
+   checked once at run time */
+
+#define SHA1_DIGEST_SIZE    20
+#define SHA256_DIGEST_SIZE  32
+
+typedef struct sha1_ctx_s {
+    uint32_t state[5];
+    uint64_t length;            /* bytes hashed so far */
+    unsigned char buf[64];
+    unsigned int buflen;
+} sha1_ctx_t;
+
+typedef struct sha256_ctx_s {
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char buf[64];
+    unsigned int buflen;
+} sha256_ctx_t;
+
+/* all checksums of one piece of data */
+typedef struct hash_digests_s {
+    uint32_t crc32;
+    unsigned char sha1[SHA1_DIGEST_SIZE];
+    unsigned char sha256[SHA256_DIGEST_SIZE];
+} hash_digests_t;
+
+/* the CRC-32 of zip and zlib, start with crc 0 */
+uint32_t crc32_update(uint32_t crc, const void *data, size_t size);
+
+/* the CRC-32 of two pieces in a row from the CRC-32 of each, size2 is the
+   size of the second piece */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t size2);
+
+void sha1_init(sha1_ctx_t *ctx);
+void sha1_update(sha1_ctx_t *ctx, const void *data, size_t size);
+void sha1_final(sha1_ctx_t *ctx, unsigned char *digest);
+
+void sha256_init(sha256_ctx_t *ctx);
+void sha256_update(sha256_ctx_t *ctx, const void *data, size_t size);
+void sha256_final(sha256_ctx_t *ctx, unsigned char *digest);
+void sha256(const void *data, size_t size, unsigned char *digest);
+
+/* all three checksums in one pass over the data */
+void hash_digests(const void *data, size_t size, hash_digests_t *d);
+
+/* lowercase hex of a digest, text needs room for 2 * size + 1 chars */
+void hash_to_hex(const unsigned char *digest, size_t size, char *text);
+
+#endif
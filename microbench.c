@@ -0,0 +1,451 @@
+/** \file   microbench.c
+ * \brief   Microbenchmarks of the inner loops of cartconv
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* the kernels are static functions, so the library is built into this
+   program instead of being linked. every kernel is run next to a plain
+   reference version of the same job (the way cartconv did it before), so
+   a replacement can be compared with what it replaces in one build.
+
+   warm: the data is in the cache from the run before.
+   cold: a buffer larger than the last level cache is written before
+         every run.
+
+   the time of a run is the median of all runs, ns/byte is per byte of cart
+   data the kernel works on, cycles/bank are TSC cycles on x86 (0 on other
+   cpus). */
+
+#include "cartconv.c"
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC
+#endif
+
+#define MICRO_WARM_RUNS     200
+#define MICRO_COLD_RUNS     25
+#define MICRO_EVICT_SIZE    (64 * 1024 * 1024)
+
+typedef struct micro_kernel_s {
+    const char *name;
+    int (*run)(void);
+    unsigned int bytes;         /* cart data per run */
+    unsigned int banks;
+} micro_kernel_t;
+
+static unsigned char *evict_buffer;
+static volatile unsigned int sink;
+
+/* the test carts */
+static cartconv_t *gmod3_cc;    /* 16MiB GMOD3, 2048 chips */
+static cartconv_t *md_cc;       /* 1MiB Magic Desk with every other bank left out */
+static cartconv_t *easy_cc;     /* 1MiB EasyFlash */
+static cartconv_t *write_cc;    /* 2MiB binary */
+static unsigned char *empty_banks;
+static unsigned char *gmod3_crt;
+static size_t gmod3_crt_size;
+static unsigned char *md_crt;
+static size_t md_crt_size;
+static unsigned char *easy_crt;
+static size_t easy_crt_size;
+static unsigned char *write_bin;
+static int null_fd = -1;
+
+/* ------------------------------------------------------------------------ */
+
+/* the empty check, 128 banks of 0xff so the whole bank is always looked at */
+
+static int empty_current(void)
+{
+    unsigned int i, n = 0;
+
+    for (i = 0; i < 128; i++) {
+        n += (unsigned int)is_empty_data(empty_banks + i * 0x2000, 0x2000);
+    }
+    return (int)n;
+}
+
+static int empty_reference(void)
+{
+    unsigned int i, j, n = 0;
+
+    for (i = 0; i < 128; i++) {
+        const unsigned char *p = empty_banks + i * 0x2000;
+
+        for (j = 0; j < 0x2000; j++) {
+            if (p[j] != 0xff) {
+                break;
+            }
+        }
+        n += (j == 0x2000);
+    }
+    return (int)n;
+}
+
+/* the CHIP headers of a 2048 chip cart: load_all_banks(), and the plain
+   decode of printbanks() and the other chip walks */
+
+static int decode_load_all_banks(void)
+{
+    gmod3_cc->crtchips_num = 0;
+    gmod3_cc->loadfile_size = 0;
+    gmod3_cc->load_address = 0;
+    load_all_banks(gmod3_cc);
+    return (int)gmod3_cc->crtchips_num;
+}
+
+static int decode_chip_walk(void)
+{
+    mapped_file_t m;
+    crt_chip_t chip;
+    unsigned long pos = 0x40;
+    int n = 0;
+
+    m.data = gmod3_crt;
+    m.size = gmod3_crt_size;
+    while (crt_decode_chip(&m, pos, &chip) == 0 && chip.length >= 0x10) {
+        pos += chip.length;
+        n++;
+    }
+    return n;
+}
+
+static int decode_reference(void)
+{
+    const unsigned char *b;
+    unsigned long pos = 0x40;
+    unsigned long length;
+    int n = 0;
+
+    /* byte by byte like the old fread loop */
+    while (pos + 0x10 <= gmod3_crt_size) {
+        unsigned int size, bank;
+
+        b = gmod3_crt + pos;
+        if (memcmp(b, "CHIP", 4) != 0) {
+            break;
+        }
+        length = ((unsigned long)b[4] << 24) | ((unsigned long)b[5] << 16) | ((unsigned long)b[6] << 8) | b[7];
+        bank = (unsigned int)(b[0xa] << 8) | b[0xb];
+        size = (unsigned int)(b[0xe] << 8) | b[0xf];
+        sink += bank + size;
+        pos += length;
+        n++;
+    }
+    return n;
+}
+
+/* 256 banks of 8KiB through write_chip_package() and flush_crt_output() into
+   /dev/null, against one writev() per 512 iovecs of headers and data made by
+   hand */
+
+static int write_current(void)
+{
+    unsigned int i;
+
+    write_cc->loadfile_offset = 0;
+    for (i = 0; i < 256; i++) {
+        if (write_chip_package(write_cc, 0x2000, i, 0x8000, 0) < 0) {
+            return -1;
+        }
+    }
+    flush_crt_output(write_cc);
+    return write_cc->crtout.failed ? -1 : 0;
+}
+
+static int write_batched(void)
+{
+    static unsigned char headers[256][0x10];
+    struct iovec iov[512];
+    unsigned int i;
+
+    for (i = 0; i < 256; i++) {
+        unsigned char *h = headers[i];
+
+        memcpy(h, "CHIP", 4);
+        h[4] = 0;
+        h[5] = 0;
+        h[6] = 0x20;
+        h[7] = 0x10;
+        h[8] = 0;
+        h[9] = 0;
+        h[0xa] = (unsigned char)(i >> 8);
+        h[0xb] = (unsigned char)(i & 0xff);
+        h[0xc] = 0x80;
+        h[0xd] = 0;
+        h[0xe] = 0x20;
+        h[0xf] = 0;
+        iov[i * 2].iov_base = h;
+        iov[i * 2].iov_len = 0x10;
+        iov[i * 2 + 1].iov_base = write_bin + i * 0x2000;
+        iov[i * 2 + 1].iov_len = 0x2000;
+    }
+    return writev_all(null_fd, iov, 512);
+}
+
+/* the 0xff fill of the banks missing from a .crt when it is needed as one
+   binary (get_load_data), against filling the whole buffer first */
+
+static int fill_current(void)
+{
+    md_cc->loaddata = NULL;
+    return get_load_data(md_cc) ? 0 : -1;
+}
+
+static int fill_reference(void)
+{
+    unsigned int i;
+
+    memset(md_cc->filebuffer, 0xff, md_cc->loadfile_size);
+    for (i = 0; i < md_cc->crtchips_num; i++) {
+        const crt_chip_t *chip = &md_cc->crtchips[i];
+
+        memcpy(md_cc->filebuffer + chip->binpos, chip->data, chip->avail);
+    }
+    return 0;
+}
+
+/* the interleaving of the 8KiB ROML/ROMH chips of an EasyFlash into one
+   binary, against placing every chip in file order */
+
+static int interleave_current(void)
+{
+    easy_cc->loaddata = NULL;
+    return get_load_data(easy_cc) ? 0 : -1;
+}
+
+static int interleave_reference(void)
+{
+    unsigned int i;
+
+    memset(easy_cc->filebuffer, 0xff, 0x100000);
+    for (i = 0; i < easy_cc->crtchips_num; i++) {
+        const crt_chip_t *chip = &easy_cc->crtchips[i];
+        unsigned int pos = ((chip->bank & 0x3f) * 0x4000) + ((chip->start == 0xa000 || chip->start == 0xe000) ? 0x2000 : 0);
+
+        memcpy(easy_cc->filebuffer + pos, chip->data, 0x2000);
+    }
+    return 0;
+}
+
+static const micro_kernel_t kernels[] = {
+    { "is_empty_data", empty_current, 128 * 0x2000, 128 },
+    { "  bytewise loop", empty_reference, 128 * 0x2000, 128 },
+    { "load_all_banks", decode_load_all_banks, 2048 * 0x2000, 2048 },
+    { "  crt_decode_chip walk", decode_chip_walk, 2048 * 0x2000, 2048 },
+    { "  bytewise decode", decode_reference, 2048 * 0x2000, 2048 },
+    { "write_chip_package", write_current, 256 * 0x2000, 256 },
+    { "  writev batch", write_batched, 256 * 0x2000, 256 },
+    { "get_load_data holes", fill_current, 128 * 0x2000, 128 },
+    { "  memset all first", fill_reference, 128 * 0x2000, 128 },
+    { "get_load_data easyflash", interleave_current, 128 * 0x2000, 128 },
+    { "  chips in file order", interleave_reference, 128 * 0x2000, 128 },
+    { NULL, NULL, 0, 0 }
+};
+
+/* ------------------------------------------------------------------------ */
+
+static uint64_t ticks(void)
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void evict_caches(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < MICRO_EVICT_SIZE; i += 64) {
+        evict_buffer[i]++;
+    }
+}
+
+static int compare_u64(const void *op1, const void *op2)
+{
+    uint64_t a = *(const uint64_t *)op1;
+    uint64_t b = *(const uint64_t *)op2;
+
+    return (a > b) - (a < b);
+}
+
+/* median time and cycles of runs runs */
+static int measure(const micro_kernel_t *k, int cold, unsigned int runs, double *ns, double *cycles)
+{
+    uint64_t t[MICRO_WARM_RUNS], c[MICRO_WARM_RUNS];
+    uint64_t t0, c0;
+    unsigned int i;
+
+    if (k->run() < 0) {
+        return -1;
+    }
+    for (i = 0; i < runs; i++) {
+        if (cold) {
+            evict_caches();
+        }
+        t0 = now_ns();
+        c0 = ticks();
+        sink += (unsigned int)k->run();
+        c[i] = ticks() - c0;
+        t[i] = now_ns() - t0;
+    }
+    qsort(t, runs, sizeof(uint64_t), compare_u64);
+    qsort(c, runs, sizeof(uint64_t), compare_u64);
+    *ns = (double)t[runs / 2];
+    *cycles = (double)c[runs / 2];
+    return 0;
+}
+
+/* ------------------------------------------------------------------------ */
+
+static unsigned char *make_binary(unsigned int size, uint32_t seed, int holes)
+{
+    unsigned char *data = malloc(size);
+    unsigned int i;
+
+    if (data == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < size; i++) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = (unsigned char)(seed >> 16);
+    }
+    if (holes) {
+        for (i = 0x2000; i + 0x2000 < size; i += 0x4000) {
+            memset(data + i, 0xff, 0x2000);
+        }
+    }
+    return data;
+}
+
+static cartconv_t *make_crt(const char *type, unsigned int size, int holes,
+                            unsigned char **crt, size_t *crt_size)
+{
+    cartconv_t *cc = cartconv_new();
+    unsigned char *bin = make_binary(size, size, holes);
+
+    if (cc == NULL || bin == NULL) {
+        return NULL;
+    }
+    cartconv_set_flags(cc, CARTCONV_QUIET);
+    if (cartconv_set_type(cc, type) < 0
+        || cartconv_load_buffer(cc, bin, size) < 0
+        || cartconv_convert_buffer(cc, crt, crt_size) < 0) {
+        fprintf(stderr, "%s", cartconv_error(cc));
+        return NULL;
+    }
+    cartconv_free(cc);
+    free(bin);
+
+    cc = cartconv_new();
+    if (cc == NULL || cartconv_load_buffer(cc, *crt, *crt_size) < 0) {
+        return NULL;
+    }
+    return cc;
+}
+
+static int setup(void)
+{
+    evict_buffer = calloc(1, MICRO_EVICT_SIZE);
+    empty_banks = malloc(128 * 0x2000);
+    if (evict_buffer == NULL || empty_banks == NULL) {
+        return -1;
+    }
+    memset(empty_banks, 0xff, 128 * 0x2000);
+
+    gmod3_cc = make_crt("gmod3", 0x1000000, 0, &gmod3_crt, &gmod3_crt_size);
+    md_cc = make_crt("md", 0x100000, 1, &md_crt, &md_crt_size);
+    easy_cc = make_crt("easy", 0x100000, 0, &easy_crt, &easy_crt_size);
+    if (gmod3_cc == NULL || md_cc == NULL || easy_cc == NULL) {
+        return -1;
+    }
+    /* the buffers the fill and interleave kernels write into */
+    if (get_load_data(md_cc) == NULL || get_load_data(easy_cc) == NULL) {
+        return -1;
+    }
+
+    write_bin = make_binary(0x200000, 1, 0);
+    write_cc = cartconv_new();
+    null_fd = open("/dev/null", O_WRONLY);
+    if (write_bin == NULL || write_cc == NULL || null_fd < 0
+        || cartconv_load_buffer(write_cc, write_bin, 0x200000) < 0) {
+        return -1;
+    }
+    write_cc->output_filename = strdup("/dev/null");
+    if (open_crt_output(write_cc) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    const micro_kernel_t *k;
+    double ns[2], cycles[2];
+
+    if (setup() < 0) {
+        fprintf(stderr, "Error: can't set up the test data\n");
+        return 1;
+    }
+
+    printf("%-26s %10s %10s %12s %10s %10s %12s\n", "", "warm", "", "", "cold", "", "");
+    printf("%-26s %10s %10s %12s %10s %10s %12s\n", "kernel", "us/run", "ns/byte", "cycles/bank",
+           "us/run", "ns/byte", "cycles/bank");
+    for (k = kernels; k->name != NULL; k++) {
+        if (measure(k, 0, MICRO_WARM_RUNS, &ns[0], &cycles[0]) < 0
+            || measure(k, 1, MICRO_COLD_RUNS, &ns[1], &cycles[1]) < 0) {
+            fprintf(stderr, "Error: %s failed\n", k->name);
+            return 1;
+        }
+        printf("%-26s %10.1f %10.4f %12.0f %10.1f %10.4f %12.0f\n", k->name,
+               ns[0] / 1000.0, ns[0] / k->bytes, cycles[0] / k->banks,
+               ns[1] / 1000.0, ns[1] / k->bytes, cycles[1] / k->banks);
+    }
+
+    close_crt_output(write_cc);
+    close(null_fd);
+    cartconv_free(gmod3_cc);
+    cartconv_free(md_cc);
+    cartconv_free(easy_cc);
+    cartconv_free(write_cc);
+    free(gmod3_crt);
+    free(md_crt);
+    free(easy_crt);
+    free(write_bin);
+    free(empty_banks);
+    free(evict_buffer);
+    return 0;
+}
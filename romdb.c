@@ -0,0 +1,617 @@
+/** \file   romdb.c
+ * \brief   Identification database of known cartridge images and banks
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "romdb.h"
+
+/* the file: a header, the buckets, the entries and the strings
+
+   0x00  "CCROMDB1"
+   0x08  number of entries
+   0x0c  bucket bits, there are 1 << bits buckets and one more for the end
+   0x10  offset of the strings
+   0x14  size of the strings
+   0x20  the buckets, the index of the first entry of each
+*/
+#define ROMDB_MAGIC         "CCROMDB1"
+#define ROMDB_HEADER_SIZE   0x20
+#define ROMDB_MIN_BITS      8
+#define ROMDB_MAX_BITS      24
+
+struct romdb_s {
+    unsigned char *data;
+    size_t size;
+    unsigned int entries;
+    unsigned int bits;
+    const unsigned char *buckets;
+    const romdb_entry_t *table;
+    const char *strings;
+    unsigned int strings_size;
+};
+
+static unsigned int get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static void put16(unsigned char *p, unsigned int v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put32(unsigned char *p, unsigned int v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+/* the top bits of the SHA-1, they are as good as random */
+static unsigned int bucket_of(const unsigned char *sha1, unsigned int bits)
+{
+    unsigned int top = ((unsigned int)sha1[0] << 24) | (sha1[1] << 16) | (sha1[2] << 8) | sha1[3];
+
+    return top >> (32 - bits);
+}
+
+romdb_t *romdb_open(const char *name)
+{
+    romdb_t *db;
+    struct stat st;
+    size_t tables;
+    int fd;
+
+    fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    db = calloc(1, sizeof(romdb_t));
+    if (db == NULL) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    db->size = (size_t)st.st_size;
+    if (db->size < ROMDB_HEADER_SIZE) {
+        goto invalid;
+    }
+    db->data = mmap(NULL, db->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (db->data == MAP_FAILED) {
+        free(db);
+        return NULL;
+    }
+#ifdef MADV_RANDOM
+    madvise(db->data, db->size, MADV_RANDOM);
+#endif
+    if (memcmp(db->data, ROMDB_MAGIC, 8)) {
+        goto invalid;
+    }
+    db->entries = get32(db->data + 0x08);
+    db->bits = get32(db->data + 0x0c);
+    db->strings_size = get32(db->data + 0x14);
+    if (db->bits < ROMDB_MIN_BITS || db->bits > ROMDB_MAX_BITS || db->entries > (db->size / sizeof(romdb_entry_t))) {
+        goto invalid;
+    }
+    tables = ROMDB_HEADER_SIZE + (((size_t)1 << db->bits) + 1) * 4 + (size_t)db->entries * sizeof(romdb_entry_t);
+    if (get32(db->data + 0x10) != tables || db->strings_size == 0 || tables + db->strings_size > db->size) {
+        goto invalid;
+    }
+    db->buckets = db->data + ROMDB_HEADER_SIZE;
+    db->table = (const romdb_entry_t *)(db->data + ROMDB_HEADER_SIZE + (((size_t)1 << db->bits) + 1) * 4);
+    db->strings = (const char *)db->data + tables;
+    if (db->strings[db->strings_size - 1] != 0) {
+        goto invalid;
+    }
+    return db;
+
+invalid:
+    if (db->data != NULL && db->data != MAP_FAILED) {
+        munmap(db->data, db->size);
+    } else {
+        close(fd);
+    }
+    free(db);
+    errno = EINVAL;
+    return NULL;
+}
+
+void romdb_close(romdb_t *db)
+{
+    if (db != NULL) {
+        munmap(db->data, db->size);
+        free(db);
+    }
+}
+
+unsigned int romdb_entries(const romdb_t *db)
+{
+    return db->entries;
+}
+
+unsigned int romdb_find(const romdb_t *db, const unsigned char *sha1, const romdb_entry_t **found)
+{
+    unsigned int b, lo, hi, mid, n;
+
+    b = bucket_of(sha1, db->bits);
+    lo = get32(db->buckets + b * 4);
+    hi = get32(db->buckets + (b + 1) * 4);
+    if (hi > db->entries) {
+        hi = db->entries;
+    }
+    if (lo > hi) {
+        lo = hi;
+    }
+    /* the first entry of the SHA-1 in the bucket */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (memcmp(db->table[mid].sha1, sha1, SHA1_DIGEST_SIZE) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    for (n = 0; lo + n < db->entries && !memcmp(db->table[lo + n].sha1, sha1, SHA1_DIGEST_SIZE); n++) {
+    }
+    *found = (n > 0) ? &db->table[lo] : NULL;
+    return n;
+}
+
+static const char *romdb_string(const romdb_t *db, const unsigned char *offset)
+{
+    unsigned int n = get32(offset);
+
+    return (n < db->strings_size) ? db->strings + n : "";
+}
+
+const char *romdb_title(const romdb_t *db, const romdb_entry_t *e)
+{
+    return romdb_string(db, e->title);
+}
+
+const char *romdb_version(const romdb_t *db, const romdb_entry_t *e)
+{
+    return romdb_string(db, e->version);
+}
+
+unsigned int romdb_bank(const romdb_entry_t *e)
+{
+    return get16(e->bank);
+}
+
+unsigned int romdb_start(const romdb_entry_t *e)
+{
+    return get16(e->start);
+}
+
+
+/* building: the entries are collected with their strings in a pool, every
+   string is only stored once */
+
+typedef struct build_entry_s {
+    unsigned char sha1[SHA1_DIGEST_SIZE];
+    unsigned int title;
+    unsigned int version;
+    unsigned int bank;
+    unsigned int start;
+} build_entry_t;
+
+struct romdb_builder_s {
+    build_entry_t *entries;
+    unsigned int num;
+    unsigned int max;
+    char *strings;
+    unsigned int strings_size;
+    unsigned int strings_max;
+    unsigned int *index;            /* offset + 1 of the strings by hash, 0 for a free slot */
+    unsigned int index_num;
+    unsigned int index_max;         /* a power of 2 */
+};
+
+romdb_builder_t *romdb_builder_new(void)
+{
+    romdb_builder_t *b = calloc(1, sizeof(romdb_builder_t));
+
+    if (b == NULL) {
+        return NULL;
+    }
+    /* offset 0 is the empty string */
+    b->strings_max = 0x10000;
+    b->strings = malloc(b->strings_max);
+    b->index_max = 0x1000;
+    b->index = calloc(b->index_max, sizeof(unsigned int));
+    if (b->strings == NULL || b->index == NULL) {
+        romdb_builder_free(b);
+        return NULL;
+    }
+    b->strings[0] = 0;
+    b->strings_size = 1;
+    return b;
+}
+
+void romdb_builder_free(romdb_builder_t *b)
+{
+    if (b != NULL) {
+        free(b->entries);
+        free(b->strings);
+        free(b->index);
+        free(b);
+    }
+}
+
+static unsigned int string_hash(const char *s)
+{
+    unsigned int h = 2166136261u;
+
+    while (*s) {
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    }
+    return h;
+}
+
+static int builder_grow_index(romdb_builder_t *b)
+{
+    unsigned int *index, max = b->index_max * 2, i, h;
+
+    index = calloc(max, sizeof(unsigned int));
+    if (index == NULL) {
+        return -1;
+    }
+    for (i = 0; i < b->index_max; i++) {
+        if (b->index[i] != 0) {
+            h = string_hash(b->strings + b->index[i] - 1) & (max - 1);
+            while (index[h] != 0) {
+                h = (h + 1) & (max - 1);
+            }
+            index[h] = b->index[i];
+        }
+    }
+    free(b->index);
+    b->index = index;
+    b->index_max = max;
+    return 0;
+}
+
+/* the offset of a string in the pool, it is added if it is new. -1 if out of memory */
+static long builder_string(romdb_builder_t *b, const char *s)
+{
+    size_t len = strlen(s) + 1;
+    unsigned int h;
+    char *p;
+
+    if (*s == 0) {
+        return 0;
+    }
+    h = string_hash(s) & (b->index_max - 1);
+    while (b->index[h] != 0) {
+        if (!strcmp(b->strings + b->index[h] - 1, s)) {
+            return b->index[h] - 1;
+        }
+        h = (h + 1) & (b->index_max - 1);
+    }
+    if (b->strings_size + len > b->strings_max) {
+        if (b->strings_max > 0x7fffffffu / 2) {
+            return -1;
+        }
+        p = realloc(b->strings, b->strings_max * 2);
+        if (p == NULL) {
+            return -1;
+        }
+        b->strings = p;
+        b->strings_max *= 2;
+    }
+    memcpy(b->strings + b->strings_size, s, len);
+    b->index[h] = b->strings_size + 1;
+    b->strings_size += (unsigned int)len;
+    if (++b->index_num * 2 > b->index_max && builder_grow_index(b) < 0) {
+        return -1;
+    }
+    return b->strings_size - (long)len;
+}
+
+int romdb_builder_add(romdb_builder_t *b, const unsigned char *sha1, const char *title, const char *version,
+                      unsigned int bank, unsigned int start)
+{
+    build_entry_t *e;
+    long t, v;
+
+    if (b->num == b->max) {
+        e = realloc(b->entries, (b->max ? b->max * 2 : 1024) * sizeof(build_entry_t));
+        if (e == NULL) {
+            return -1;
+        }
+        b->entries = e;
+        b->max = b->max ? b->max * 2 : 1024;
+    }
+    t = builder_string(b, title);
+    v = builder_string(b, version);
+    if (t < 0 || v < 0) {
+        return -1;
+    }
+    e = &b->entries[b->num++];
+    memcpy(e->sha1, sha1, SHA1_DIGEST_SIZE);
+    e->title = (unsigned int)t;
+    e->version = (unsigned int)v;
+    e->bank = bank & 0xffff;
+    e->start = start & 0xffff;
+    return 0;
+}
+
+int romdb_builder_add_db(romdb_builder_t *b, const romdb_t *db)
+{
+    const romdb_entry_t *e;
+    unsigned int i;
+
+    for (i = 0; i < db->entries; i++) {
+        e = &db->table[i];
+        if (romdb_builder_add(b, e->sha1, romdb_title(db, e), romdb_version(db, e), romdb_bank(e), romdb_start(e)) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* DAT files: a token is a word, a quoted string or a single character of
+   ()<>/=?!. that is enough for both formats:
+
+   game ( name "Title" rom ( name title.crt size 65536 crc 1234abcd sha1 ... ) )
+   <game name="Title"><rom name="title.crt" size="65536" sha1="..."/></game>
+*/
+typedef struct dat_parser_s {
+    const char *p;
+    const char *end;
+    char token[256];
+    int word;                       /* the token is a word or a string, not punctuation */
+} dat_parser_t;
+
+static int dat_token(dat_parser_t *d)
+{
+    static const char *entities[] = { "&amp;", "&", "&lt;", "<", "&gt;", ">", "&quot;", "\"", "&apos;", "'" };
+    unsigned int n = 0, i;
+    char quote;
+
+    while (d->p < d->end && isspace((unsigned char)*d->p)) {
+        d->p++;
+    }
+    if (d->p >= d->end) {
+        return 0;
+    }
+    if (strchr("()<>/=?!", *d->p)) {
+        d->token[0] = *d->p++;
+        d->token[1] = 0;
+        d->word = 0;
+        return 1;
+    }
+    d->word = 1;
+    if (*d->p == '"' || *d->p == '\'') {
+        quote = *d->p++;
+        while (d->p < d->end && *d->p != quote) {
+            for (i = 0; i < 10; i += 2) {
+                if (*d->p == '&' && (size_t)(d->end - d->p) >= strlen(entities[i]) &&
+                    !memcmp(d->p, entities[i], strlen(entities[i]))) {
+                    break;
+                }
+            }
+            if (n < sizeof(d->token) - 1) {
+                d->token[n++] = (i < 10) ? entities[i + 1][0] : *d->p;
+            }
+            d->p += (i < 10) ? strlen(entities[i]) : 1;
+        }
+        d->p++;
+    } else {
+        while (d->p < d->end && !isspace((unsigned char)*d->p) && !strchr("()<>/=?!\"", *d->p)) {
+            if (n < sizeof(d->token) - 1) {
+                d->token[n++] = *d->p;
+            }
+            d->p++;
+        }
+    }
+    d->token[n] = 0;
+    return 1;
+}
+
+/* the value of a key, a word or string after an optional = */
+static int dat_value(dat_parser_t *d)
+{
+    if (!dat_token(d)) {
+        return 0;
+    }
+    if (!d->word && d->token[0] == '=' && !dat_token(d)) {
+        return 0;
+    }
+    return d->word;
+}
+
+static int parse_sha1(const char *text, unsigned char *sha1)
+{
+    unsigned int i, hi, lo;
+
+    if (strlen(text) != SHA1_DIGEST_SIZE * 2) {
+        return -1;
+    }
+    for (i = 0; i < SHA1_DIGEST_SIZE; i++) {
+        if (!isxdigit((unsigned char)text[i * 2]) || !isxdigit((unsigned char)text[i * 2 + 1])) {
+            return -1;
+        }
+        hi = isdigit((unsigned char)text[i * 2]) ? text[i * 2] - '0' : (tolower((unsigned char)text[i * 2]) - 'a' + 10);
+        lo = isdigit((unsigned char)text[i * 2 + 1]) ? text[i * 2 + 1] - '0' : (tolower((unsigned char)text[i * 2 + 1]) - 'a' + 10);
+        sha1[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return 0;
+}
+
+int romdb_builder_add_dat(romdb_builder_t *b, const char *text, size_t size)
+{
+    dat_parser_t d;
+    char title[256] = "", version[64] = "";
+    unsigned char sha1[SHA1_DIGEST_SIZE];
+    int game_name = 0, added = 0;
+
+    d.p = text;
+    d.end = text + size;
+    while (dat_token(&d)) {
+        if (!d.word) {
+            continue;
+        }
+        if (!strcmp(d.token, "game") || !strcmp(d.token, "machine")) {
+            /* the next name is the one of the game */
+            game_name = 1;
+            title[0] = 0;
+            version[0] = 0;
+        } else if (!strcmp(d.token, "rom")) {
+            game_name = 0;
+        } else if (!strcmp(d.token, "name") && game_name) {
+            if (dat_value(&d)) {
+                strcpy(title, d.token);
+                game_name = 0;
+            }
+        } else if (!strcmp(d.token, "version")) {
+            if (dat_value(&d)) {
+                d.token[sizeof(version) - 1] = 0;
+                strcpy(version, d.token);
+            }
+        } else if (!strcmp(d.token, "sha1")) {
+            if (dat_value(&d) && title[0] != 0 && parse_sha1(d.token, sha1) == 0) {
+                if (romdb_builder_add(b, sha1, title, version, ROMDB_IMAGE, 0) < 0) {
+                    return -1;
+                }
+                added++;
+            }
+        }
+    }
+    return added;
+}
+
+static int compare_build_entries(const void *op1, const void *op2)
+{
+    const build_entry_t *p1 = (const build_entry_t *)op1;
+    const build_entry_t *p2 = (const build_entry_t *)op2;
+    int c = memcmp(p1->sha1, p2->sha1, SHA1_DIGEST_SIZE);
+
+    if (c != 0) {
+        return c;
+    }
+    if (p1->bank != p2->bank) {
+        return (p1->bank < p2->bank) ? -1 : 1;
+    }
+    if (p1->start != p2->start) {
+        return (p1->start < p2->start) ? -1 : 1;
+    }
+    if (p1->title != p2->title) {
+        return (p1->title < p2->title) ? -1 : 1;
+    }
+    return (p1->version < p2->version) ? -1 : (p1->version > p2->version);
+}
+
+int romdb_builder_write(romdb_builder_t *b, const char *name)
+{
+    unsigned char header[ROMDB_HEADER_SIZE];
+    unsigned char buf[4];
+    romdb_entry_t out;
+    unsigned int i, n, bits, bucket;
+    char *tmpname;
+    FILE *f;
+    int result = 0;
+
+    qsort(b->entries, b->num, sizeof(build_entry_t), compare_build_entries);
+    for (i = 0, n = 0; i < b->num; i++) {
+        if (n == 0 || compare_build_entries(&b->entries[n - 1], &b->entries[i]) != 0) {
+            b->entries[n++] = b->entries[i];
+        }
+    }
+    b->num = n;
+
+    /* about four entries per bucket */
+    for (bits = ROMDB_MIN_BITS; bits < ROMDB_MAX_BITS && (1u << bits) < b->num / 4; bits++) {
+    }
+
+    tmpname = malloc(strlen(name) + 32);
+    if (tmpname == NULL) {
+        return -1;
+    }
+    sprintf(tmpname, "%s.%ld.tmp", name, (long)getpid());
+    f = fopen(tmpname, "wb");
+    if (f == NULL) {
+        free(tmpname);
+        return -1;
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, ROMDB_MAGIC, 8);
+    put32(header + 0x08, b->num);
+    put32(header + 0x0c, bits);
+    put32(header + 0x10, ROMDB_HEADER_SIZE + ((1u << bits) + 1) * 4 + b->num * (unsigned int)sizeof(romdb_entry_t));
+    put32(header + 0x14, b->strings_size);
+    fwrite(header, 1, sizeof(header), f);
+
+    for (bucket = 0, i = 0; bucket <= (1u << bits); bucket++) {
+        while (i < b->num && bucket_of(b->entries[i].sha1, bits) < bucket) {
+            i++;
+        }
+        put32(buf, i);
+        fwrite(buf, 1, 4, f);
+    }
+    for (i = 0; i < b->num; i++) {
+        memcpy(out.sha1, b->entries[i].sha1, SHA1_DIGEST_SIZE);
+        put32(out.title, b->entries[i].title);
+        put32(out.version, b->entries[i].version);
+        put16(out.bank, b->entries[i].bank);
+        put16(out.start, b->entries[i].start);
+        fwrite(&out, 1, sizeof(out), f);
+    }
+    fwrite(b->strings, 1, b->strings_size, f);
+
+    if (ferror(f) || fclose(f) != 0) {
+        result = -1;
+    } else if (rename(tmpname, name) < 0) {
+        result = -1;
+    }
+    if (result < 0) {
+        unlink(tmpname);
+    }
+    free(tmpname);
+    return result;
+}
@@ -0,0 +1,82 @@
+/** \file   romdb.h
+ * \brief   Identification database of known cartridge images and banks
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef CARTCONV_ROMDB_H
+#define CARTCONV_ROMDB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hash.h"
+
+/* the database maps the SHA-1 of whole images and of single chips to the
+   title and version of a known release. the file is used through mmap and
+   never read as a whole: the top bits of a SHA-1 select a bucket, the bucket
+   holds the first of its entries in a table that is sorted by SHA-1, so a
+   lookup reads the bucket, a few entries and the title. all numbers in the
+   file are little endian. */
+
+#define ROMDB_IMAGE 0xffff      /* the bank of an entry for a whole image */
+
+typedef struct romdb_s romdb_t;
+
+/* an entry as it is in the file */
+typedef struct romdb_entry_s {
+    unsigned char sha1[SHA1_DIGEST_SIZE];
+    unsigned char title[4];     /* offset in the string table */
+    unsigned char version[4];   /* offset in the string table, "" if none */
+    unsigned char bank[2];      /* ROMDB_IMAGE or the bank of a chip */
+    unsigned char start[2];     /* load address of a chip */
+} romdb_entry_t;
+
+/* NULL with errno set if the file can't be mapped, EINVAL if it is no database */
+romdb_t *romdb_open(const char *name);
+void romdb_close(romdb_t *db);
+unsigned int romdb_entries(const romdb_t *db);
+
+/* the entries of a SHA-1, *found is the first of them. returns how many there are */
+unsigned int romdb_find(const romdb_t *db, const unsigned char *sha1, const romdb_entry_t **found);
+
+const char *romdb_title(const romdb_t *db, const romdb_entry_t *e);
+const char *romdb_version(const romdb_t *db, const romdb_entry_t *e);
+unsigned int romdb_bank(const romdb_entry_t *e);
+unsigned int romdb_start(const romdb_entry_t *e);
+
+/* a new database is collected in memory and written in one go */
+typedef struct romdb_builder_s romdb_builder_t;
+
+romdb_builder_t *romdb_builder_new(void);
+void romdb_builder_free(romdb_builder_t *b);
+int romdb_builder_add(romdb_builder_t *b, const unsigned char *sha1, const char *title, const char *version,
+                      unsigned int bank, unsigned int start);
+/* all entries of an existing database */
+int romdb_builder_add_db(romdb_builder_t *b, const romdb_t *db);
+/* the SHA-1 of every rom of a DAT file, in the clrmamepro or the XML format,
+   under the name of its game. returns the number of entries or -1 */
+int romdb_builder_add_dat(romdb_builder_t *b, const char *text, size_t size);
+/* sort, drop duplicates and write the file through a temporary one */
+int romdb_builder_write(romdb_builder_t *b, const char *name);
+
+#endif
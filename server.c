@@ -0,0 +1,931 @@
+/** \file   server.c
+ * \brief   Server mode of cartconv, requests on a unix socket or stdin
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+/* every request is one line of words, quoted with "" where a name has
+   spaces: an id chosen by the client, the command and its arguments.
+
+     <id> info <crt>
+     <id> extract <crt> <dir> [--checksums <csv>]
+     <id> convert [-t type] [-s rev] [-n name] [-l addr] [-r] [-p] [-b] [--verify] -i <input> [-i ...] -o <output>
+     <id> hash <file>
+
+   the answer is one line of JSON with the id, "status" ("ok" or "error"),
+   the error message, the fields of the command and the messages ("out" and
+   "err") the command printed. info and extract give the header fields and
+   "chips", the chip table, convert the "output" with its size and checksums
+   like hash. requests are spread over a pool of worker
+   threads, so the answers of one connection can come in any order. every
+   worker keeps one library context and its buffers for all its requests,
+   errors only end the request. */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "cartconv.h"
+#include "hash.h"
+#include "server.h"
+
+#define SERVER_MAX_ARGS     80  /* 33 inputs with their -i and the options */
+#define SERVER_MAX_LINE     0x40000 /* longer requests are answered with an error */
+#define SERVER_MAX_ID       128 /* the part of the id a rejected request is answered with */
+#define SERVER_QUEUE_DEPTH  4   /* queued requests per worker before the readers wait */
+
+typedef struct server_conn_s {
+    int fd;                     /* the answers go here */
+    int close_fd;               /* 0 for stdout */
+    int refs;                   /* the reader and the unanswered requests */
+    pthread_mutex_t lock;       /* one answer at a time */
+} server_conn_t;
+
+typedef struct server_job_s {
+    struct server_job_s *next;
+    server_conn_t *conn;
+    char *line;
+} server_job_t;
+
+typedef struct server_queue_s {
+    pthread_mutex_t lock;
+    pthread_cond_t work;        /* a job was queued or the server stops */
+    pthread_cond_t space;       /* a job was taken */
+    server_job_t *head;
+    server_job_t *tail;
+    unsigned int num;
+    unsigned int max;
+    int done;                   /* no more jobs are queued */
+} server_queue_t;
+
+typedef struct server_request_s {
+    cartconv_t *cc;
+    FILE *err;                  /* the messages of the request */
+    FILE *fields;               /* the fields of the answer, each starting with a comma */
+    char error[256];            /* an error of the server itself */
+} server_request_t;
+
+static server_queue_t queue = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    NULL, NULL, 0, 0, 0
+};
+static volatile sig_atomic_t server_stop = 0;
+static int listen_fd = -1;
+
+static int get_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n < 1) ? 1 : (int)n;
+}
+
+static void server_signal(int sig)
+{
+    server_stop = 1;
+    if (listen_fd >= 0) {
+        shutdown(listen_fd, SHUT_RDWR);     /* wakes up accept() */
+    }
+}
+
+/* only the main thread takes SIGINT/SIGTERM, so that it is its accept() or
+   read() that gets interrupted */
+static int server_start_thread(pthread_t *thread, void *(*func)(void *), void *arg)
+{
+    sigset_t set, old;
+    int result;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, &old);
+    result = pthread_create(thread, NULL, func, arg);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return (result == 0) ? 0 : -1;
+}
+
+static server_conn_t *server_new_conn(int fd, int close_fd)
+{
+    server_conn_t *conn = malloc(sizeof(server_conn_t));
+
+    if (conn == NULL) {
+        return NULL;
+    }
+    conn->fd = fd;
+    conn->close_fd = close_fd;
+    conn->refs = 1;
+    pthread_mutex_init(&conn->lock, NULL);
+    return conn;
+}
+
+static void server_ref_conn(server_conn_t *conn)
+{
+    pthread_mutex_lock(&conn->lock);
+    conn->refs++;
+    pthread_mutex_unlock(&conn->lock);
+}
+
+static void server_unref_conn(server_conn_t *conn)
+{
+    int refs;
+
+    pthread_mutex_lock(&conn->lock);
+    refs = --conn->refs;
+    pthread_mutex_unlock(&conn->lock);
+    if (refs == 0) {
+        if (conn->close_fd) {
+            close(conn->fd);
+        }
+        pthread_mutex_destroy(&conn->lock);
+        free(conn);
+    }
+}
+
+/* blocks while the queue is full, -1 once the server stops */
+static int server_queue_job(server_job_t *job)
+{
+    pthread_mutex_lock(&queue.lock);
+    while (queue.num >= queue.max && !queue.done) {
+        pthread_cond_wait(&queue.space, &queue.lock);
+    }
+    if (queue.done) {
+        pthread_mutex_unlock(&queue.lock);
+        return -1;
+    }
+    job->next = NULL;
+    if (queue.tail != NULL) {
+        queue.tail->next = job;
+    } else {
+        queue.head = job;
+    }
+    queue.tail = job;
+    queue.num++;
+    pthread_cond_signal(&queue.work);
+    pthread_mutex_unlock(&queue.lock);
+    return 0;
+}
+
+/* the jobs that are queued when the server stops are still done */
+static server_job_t *server_next_job(void)
+{
+    server_job_t *job;
+
+    pthread_mutex_lock(&queue.lock);
+    while (queue.head == NULL && !queue.done) {
+        pthread_cond_wait(&queue.work, &queue.lock);
+    }
+    job = queue.head;
+    if (job != NULL) {
+        queue.head = job->next;
+        if (queue.head == NULL) {
+            queue.tail = NULL;
+        }
+        queue.num--;
+        pthread_cond_signal(&queue.space);
+    }
+    pthread_mutex_unlock(&queue.lock);
+    return job;
+}
+
+static void server_stop_queue(void)
+{
+    pthread_mutex_lock(&queue.lock);
+    queue.done = 1;
+    pthread_cond_broadcast(&queue.work);
+    pthread_cond_broadcast(&queue.space);
+    pthread_mutex_unlock(&queue.lock);
+}
+
+/* the length of the UTF-8 sequence at s, 0 if it is no valid one */
+static size_t utf8_length(const unsigned char *s, size_t len)
+{
+    size_t n, i;
+
+    if (s[0] >= 0xc2 && s[0] <= 0xdf) {
+        n = 2;
+    } else if (s[0] >= 0xe0 && s[0] <= 0xef) {
+        n = 3;
+    } else if (s[0] >= 0xf0 && s[0] <= 0xf4) {
+        n = 4;
+    } else {
+        return 0;
+    }
+    if (len < n) {
+        return 0;
+    }
+    for (i = 1; i < n; i++) {
+        if ((s[i] & 0xc0) != 0x80) {
+            return 0;
+        }
+    }
+    /* no overlong forms, surrogates or code points past U+10FFFF */
+    if ((s[0] == 0xe0 && s[1] < 0xa0) || (s[0] == 0xed && s[1] > 0x9f) ||
+        (s[0] == 0xf0 && s[1] < 0x90) || (s[0] == 0xf4 && s[1] > 0x8f)) {
+        return 0;
+    }
+    return n;
+}
+
+/* a JSON string of any bytes: UTF-8 is kept, other bytes like the PETSCII
+   of cart names are written as \u00XX so the answer is always valid JSON */
+static void json_string(FILE *f, const char *s, size_t len)
+{
+    size_t i, n;
+    unsigned char c;
+
+    fputc('"', f);
+    for (i = 0; i < len; i++) {
+        c = (unsigned char)s[i];
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        } else if (c == '\n') {
+            fputs("\\n", f);
+        } else if (c == '\t') {
+            fputs("\\t", f);
+        } else if (c < 0x20 || c == 0x7f) {
+            fprintf(f, "\\u%04x", c);
+        } else if (c >= 0x80) {
+            n = utf8_length((const unsigned char *)s + i, len - i);
+            if (n == 0) {
+                fprintf(f, "\\u%04x", c);
+            } else {
+                fwrite(s + i, 1, n, f);
+                i += n - 1;
+            }
+        } else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static void server_error(server_request_t *req, const char *format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    vfprintf(req->err, format, ap);
+    va_end(ap);
+    va_start(ap, format);
+    vsnprintf(req->error, sizeof(req->error), format + 7, ap);     /* without "Error: " */
+    va_end(ap);
+    req->error[strcspn(req->error, "\n")] = 0;
+}
+
+/* split a request into words in place, "" quotes spaces and \ the next
+   character within quotes. -1 if the line is broken or has too many words */
+static int server_split(char *line, char **argv, int max)
+{
+    char *p = line, *q;
+    char c;
+    int argc = 0;
+
+    while (1) {
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == 0) {
+            return argc;
+        }
+        if (argc == max) {
+            return -1;
+        }
+        argv[argc++] = q = p;
+        while (*p != 0 && *p != ' ' && *p != '\t') {
+            if (*p == '"') {
+                p++;
+                while (*p != 0 && *p != '"') {
+                    if (*p == '\\' && p[1] != 0) {
+                        p++;
+                    }
+                    *q++ = *p++;
+                }
+                if (*p == 0) {
+                    return -1;
+                }
+                p++;
+            } else {
+                *q++ = *p++;
+            }
+        }
+        c = *p;
+        *q = 0;
+        if (c != 0) {
+            p++;
+        }
+    }
+}
+
+/* "-" is the channel of the server itself */
+static int server_check_name(server_request_t *req, const char *name)
+{
+    if (!strcmp(name, "-")) {
+        server_error(req, "Error: - can not be used as a file name in server mode\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int server_crt_input(server_request_t *req, const char *name)
+{
+    if (server_check_name(req, name) < 0 || cartconv_load_file(req->cc, name) < 0) {
+        return -1;
+    }
+    if (!cartconv_input_is_crt(req->cc)) {
+        server_error(req, "Error: %s is not a .crt file\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+/* size, CRC32, SHA-1 and SHA-256 of a file as fields */
+static int server_file_fields(server_request_t *req, const char *name)
+{
+    hash_digests_t d;
+    struct stat st;
+    char sha1[SHA1_DIGEST_SIZE * 2 + 1];
+    char sha256[SHA256_DIGEST_SIZE * 2 + 1];
+    void *data = NULL;
+    int fd;
+
+    fd = open(name, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        server_error(req, "Error: Can't open %s\n", name);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    if (st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            server_error(req, "Error: Can't read %s\n", name);
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+    hash_digests(data, (size_t)st.st_size, &d);
+    if (data != NULL) {
+        munmap(data, (size_t)st.st_size);
+    }
+    hash_to_hex(d.sha1, SHA1_DIGEST_SIZE, sha1);
+    hash_to_hex(d.sha256, SHA256_DIGEST_SIZE, sha256);
+    fprintf(req->fields, ",\"size\":%lu,\"crc32\":\"%08x\",\"sha1\":\"%s\",\"sha256\":\"%s\"",
+            (unsigned long)st.st_size, d.crc32, sha1, sha256);
+    return 0;
+}
+
+/* the header and the chip table of the extracted .crt as fields */
+static void server_crt_fields(server_request_t *req)
+{
+    cartconv_header_t h;
+    const cartconv_chip_t *chips;
+    char sha1[SHA1_DIGEST_SIZE * 2 + 1];
+    int i, num;
+
+    if (cartconv_get_header(req->cc, &h) < 0) {
+        return;
+    }
+    fprintf(req->fields, ",\"version\":\"%d.%d\",\"hardware_id\":%d,\"type\":", h.version >> 8, h.version & 0xff, h.id);
+    json_string(req->fields, h.type, strlen(h.type));
+    fprintf(req->fields, ",\"exrom\":%d,\"game\":%d,\"revision\":%d,\"name\":", h.exrom, h.game, h.revision);
+    json_string(req->fields, h.name, strlen(h.name));
+    hash_to_hex(h.sha1, SHA1_DIGEST_SIZE, sha1);
+    fprintf(req->fields, ",\"size\":%lu,\"crc32\":\"%08x\",\"sha1\":\"%s\",\"chips\":[", h.size, h.crc32, sha1);
+    num = cartconv_get_chips(req->cc, &chips);
+    for (i = 0; i < num; i++) {
+        hash_to_hex(chips[i].sha1, SHA1_DIGEST_SIZE, sha1);
+        fprintf(req->fields, "%s{\"offset\":%lu,\"type\":%u,\"bank\":%u,\"start\":%u,\"size\":%u,\"crc32\":\"%08x\",\"sha1\":\"%s\"}",
+                (i > 0) ? "," : "", chips[i].offset, chips[i].type, chips[i].bank, chips[i].start, chips[i].size,
+                chips[i].crc32, sha1);
+    }
+    fputc(']', req->fields);
+}
+
+static int server_info(server_request_t *req, int argc, char **argv)
+{
+    if (argc != 1) {
+        server_error(req, "Error: usage: info <crt>\n");
+        return -1;
+    }
+    if (server_crt_input(req, argv[0]) < 0) {
+        return -1;
+    }
+    cartconv_set_flags(req->cc, CARTCONV_NO_FILES);
+    if (cartconv_extract(req->cc, argv[0]) < 0) {
+        return -1;
+    }
+    server_crt_fields(req);
+    return 0;
+}
+
+static int server_extract(server_request_t *req, int argc, char **argv)
+{
+    if (argc != 2 && !(argc == 4 && !strcmp(argv[2], "--checksums"))) {
+        server_error(req, "Error: usage: extract <crt> <dir> [--checksums <csv>]\n");
+        return -1;
+    }
+    if (server_crt_input(req, argv[0]) < 0) {
+        return -1;
+    }
+    mkdir(argv[1], 0777);
+    if (cartconv_set_extract_dir(req->cc, argv[1]) < 0) {
+        return -1;
+    }
+    if (argc == 4 && cartconv_set_checksum_file(req->cc, argv[3]) < 0) {
+        server_error(req, "Error: out of memory.\n");
+        return -1;
+    }
+    if (cartconv_extract(req->cc, argv[0]) < 0) {
+        return -1;
+    }
+    server_crt_fields(req);
+    return 0;
+}
+
+static int server_convert(server_request_t *req, int argc, char **argv)
+{
+    cartconv_t *cc = req->cc;
+    const char *input = NULL, *output = NULL;
+    char *opt, *arg;
+    int flags = 0, i;
+
+    for (i = 0; i < argc; i++) {
+        opt = argv[i];
+        arg = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (!strcmp(opt, "-r")) {
+            flags |= CARTCONV_REPAIR;
+            continue;
+        } else if (!strcmp(opt, "-p")) {
+            flags |= CARTCONV_PAD_INPUT;
+            continue;
+        } else if (!strcmp(opt, "-b")) {
+            flags |= CARTCONV_ALL_BANKS;
+            continue;
+        } else if (!strcmp(opt, "-q")) {
+            flags |= CARTCONV_QUIET;
+            continue;
+        } else if (!strcmp(opt, "--verify")) {
+            flags |= CARTCONV_VERIFY;
+            continue;
+        }
+        if (strcmp(opt, "-t") && strcmp(opt, "-s") && strcmp(opt, "-n") && strcmp(opt, "-l") &&
+            strcmp(opt, "-i") && strcmp(opt, "-o")) {
+            server_error(req, "Error: unknown option %s\n", opt);
+            return -1;
+        }
+        if (arg == NULL) {
+            server_error(req, "Error: %s needs an argument\n", opt);
+            return -1;
+        }
+        i++;
+        if (opt[1] == 't') {
+            if (cartconv_set_type(cc, arg) < 0) {
+                return -1;
+            }
+        } else if (opt[1] == 's') {
+            cartconv_set_subtype(cc, atoi(arg));
+        } else if (opt[1] == 'n') {
+            if (cartconv_set_name(cc, arg) < 0) {
+                server_error(req, "Error: out of memory.\n");
+                return -1;
+            }
+        } else if (opt[1] == 'l') {
+            cartconv_set_load_address(cc, atoi(arg));
+        } else if (opt[1] == 'i') {
+            if (server_check_name(req, arg) < 0) {
+                return -1;
+            }
+            if (cartconv_add_input(cc, arg) < 0) {
+                server_error(req, "Error: too many input files\n");
+                return -1;
+            }
+            if (input == NULL) {
+                input = arg;
+            }
+        } else {
+            if (output != NULL) {
+                server_error(req, "Error: more than one output filename\n");
+                return -1;
+            }
+            if (server_check_name(req, arg) < 0) {
+                return -1;
+            }
+            output = arg;
+        }
+    }
+    if (input == NULL || output == NULL) {
+        server_error(req, "Error: no %s filename\n", (input == NULL) ? "input" : "output");
+        return -1;
+    }
+    if (!strcmp(input, output)) {
+        server_error(req, "Error: output filename = input filename\n");
+        return -1;
+    }
+    cartconv_set_flags(cc, flags);
+    if (cartconv_convert(cc, output) < 0) {
+        return -1;
+    }
+    /* the file that was written */
+    fputs(",\"output\":", req->fields);
+    json_string(req->fields, output, strlen(output));
+    return server_file_fields(req, output);
+}
+
+static int server_hash(server_request_t *req, int argc, char **argv)
+{
+    if (argc != 1) {
+        server_error(req, "Error: usage: hash <file>\n");
+        return -1;
+    }
+    if (server_check_name(req, argv[0]) < 0) {
+        return -1;
+    }
+    return server_file_fields(req, argv[0]);
+}
+
+static void server_write(server_conn_t *conn, const char *data, size_t len)
+{
+    ssize_t n;
+
+    pthread_mutex_lock(&conn->lock);
+    while (len > 0) {
+        n = write(conn->fd, data, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;                  /* the client is gone */
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    pthread_mutex_unlock(&conn->lock);
+}
+
+static const char server_nomem[] = "{\"id\":null,\"status\":\"error\",\"error\":\"out of memory.\"}\n";
+
+/* answer a request that is not run, with the id it starts with */
+static void server_reject(server_conn_t *conn, char *line, const char *msg)
+{
+    char answer[SERVER_MAX_ID * 6 + 256];
+    char *argv[1], *p;
+    const char *id = "";
+    size_t len;
+    int quoted = 0;
+    FILE *f;
+
+    /* only the id is split, the rest may be cut off or broken */
+    for (p = line + strspn(line, " \t"); *p != 0 && (quoted || (*p != ' ' && *p != '\t')); p++) {
+        if (*p == '\\' && quoted && p[1] != 0) {
+            p++;
+        } else if (*p == '"') {
+            quoted = !quoted;
+        }
+    }
+    *p = 0;
+    if (server_split(line, argv, 1) == 1) {
+        id = argv[0];
+    }
+    len = strlen(id);
+
+    f = fmemopen(answer, sizeof(answer), "w");
+    if (f == NULL) {
+        server_write(conn, server_nomem, sizeof(server_nomem) - 1);
+        return;
+    }
+    fputs("{\"id\":", f);
+    json_string(f, id, (len < SERVER_MAX_ID) ? len : SERVER_MAX_ID);
+    fputs(",\"status\":\"error\",\"error\":", f);
+    json_string(f, msg, strlen(msg));
+    fputs("}\n", f);
+    len = (size_t)ftell(f);
+    fclose(f);
+    server_write(conn, answer, len);
+}
+
+static void server_answer(cartconv_t *cc, server_job_t *job)
+{
+    server_request_t req;
+    char *argv[SERVER_MAX_ARGS];
+    char *out = NULL, *err = NULL, *fields = NULL, *answer = NULL;
+    size_t outlen = 0, errlen = 0, fieldslen = 0, answerlen = 0;
+    const char *id = "", *msg;
+    FILE *fout, *f;
+    int argc, result = -1;
+
+    cartconv_reset(cc);
+    req.cc = cc;
+    req.error[0] = 0;
+    fout = open_memstream(&out, &outlen);
+    req.err = open_memstream(&err, &errlen);
+    req.fields = open_memstream(&fields, &fieldslen);
+    f = open_memstream(&answer, &answerlen);
+    if (fout == NULL || req.err == NULL || req.fields == NULL || f == NULL) {
+        if (fout != NULL) {
+            fclose(fout);
+        }
+        if (req.err != NULL) {
+            fclose(req.err);
+        }
+        if (req.fields != NULL) {
+            fclose(req.fields);
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+        server_write(job->conn, server_nomem, sizeof(server_nomem) - 1);
+        free(out);
+        free(err);
+        free(fields);
+        free(answer);
+        return;
+    }
+    cartconv_set_streams(cc, fout, req.err);
+
+    argc = server_split(job->line, argv, SERVER_MAX_ARGS);
+    if (argc > 0) {
+        id = argv[0];
+    }
+    if (argc < 0) {
+        server_error(&req, "Error: the request can not be parsed\n");
+    } else if (argc < 2) {
+        server_error(&req, "Error: no command\n");
+    } else if (!strcmp(argv[1], "info")) {
+        result = server_info(&req, argc - 2, argv + 2);
+    } else if (!strcmp(argv[1], "extract")) {
+        result = server_extract(&req, argc - 2, argv + 2);
+    } else if (!strcmp(argv[1], "convert")) {
+        result = server_convert(&req, argc - 2, argv + 2);
+    } else if (!strcmp(argv[1], "hash")) {
+        result = server_hash(&req, argc - 2, argv + 2);
+    } else {
+        server_error(&req, "Error: unknown command %s\n", argv[1]);
+    }
+
+    /* nothing may be printed between the requests */
+    cartconv_set_streams(cc, stderr, stderr);
+    fclose(fout);
+    fclose(req.err);
+    fclose(req.fields);
+
+    fputs("{\"id\":", f);
+    json_string(f, id, strlen(id));
+    fprintf(f, ",\"status\":\"%s\"", (result < 0) ? "error" : "ok");
+    if (result < 0) {
+        msg = req.error[0] ? req.error : cartconv_error(cc);
+        fputs(",\"error\":", f);
+        json_string(f, msg, strlen(msg));
+    }
+    fwrite(fields, 1, fieldslen, f);
+    fputs(",\"out\":", f);
+    json_string(f, out, outlen);
+    fputs(",\"err\":", f);
+    json_string(f, err, errlen);
+    fputs("}\n", f);
+    fclose(f);
+
+    server_write(job->conn, answer, answerlen);
+    free(out);
+    free(err);
+    free(fields);
+    free(answer);
+}
+
+static void *server_worker(void *arg)
+{
+    cartconv_t *cc = arg;
+    server_job_t *job;
+
+    while ((job = server_next_job()) != NULL) {
+        server_answer(cc, job);
+        server_unref_conn(job->conn);
+        free(job->line);
+        free(job);
+    }
+    return NULL;
+}
+
+/* queue the requests of a connection until it ends */
+static void server_read(server_conn_t *conn, int fd)
+{
+    server_job_t *job;
+    char *line;
+    size_t len;
+    FILE *in;
+    int c;
+
+    line = malloc(SERVER_MAX_LINE + 2);
+    in = (line != NULL) ? fdopen(fd, "r") : NULL;
+    if (in == NULL) {
+        free(line);
+        close(fd);
+        return;
+    }
+    /* the line, its newline and the 0 */
+    while (fgets(line, SERVER_MAX_LINE + 2, in) != NULL) {
+        len = strlen(line);
+        if (len > SERVER_MAX_LINE && line[len - 1] != '\n') {
+            while ((c = getc(in)) != EOF && c != '\n') {
+            }
+            server_reject(conn, line, "the request is too long.");
+            continue;
+        }
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+            line[--len] = 0;
+        }
+        if (line[strspn(line, " \t")] == 0) {
+            continue;
+        }
+        job = malloc(sizeof(server_job_t));
+        if (job == NULL || (job->line = strdup(line)) == NULL) {
+            free(job);
+            server_reject(conn, line, "out of memory.");
+            continue;
+        }
+        job->conn = conn;
+        server_ref_conn(conn);
+        if (server_queue_job(job) < 0) {
+            server_unref_conn(conn);
+            free(job->line);
+            free(job);
+            break;
+        }
+    }
+    free(line);
+    fclose(in);
+}
+
+static void *server_reader(void *arg)
+{
+    server_conn_t *conn = arg;
+    int fd = dup(conn->fd);
+
+    if (fd >= 0) {
+        server_read(conn, fd);
+    }
+    server_unref_conn(conn);
+    return NULL;
+}
+
+static int server_listen(const char *name)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd;
+
+    if (strlen(name) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket name %s is too long\n", name);
+        return -1;
+    }
+    /* a socket left over from an earlier server */
+    if (lstat(name, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(name);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, name);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+        fprintf(stderr, "Error: Can't listen on %s: %s\n", name, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static void server_accept(void)
+{
+    server_conn_t *conn;
+    pthread_t thread;
+    int fd;
+
+    while (!server_stop) {
+        fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (!server_stop) {
+                fprintf(stderr, "Error: accept failed: %s\n", strerror(errno));
+            }
+            break;
+        }
+        conn = server_new_conn(fd, 1);
+        if (conn == NULL) {
+            close(fd);
+            continue;
+        }
+        if (server_start_thread(&thread, server_reader, conn) < 0) {
+            server_unref_conn(conn);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+int server_main(const char *name, int workers)
+{
+    struct sigaction sa;
+    server_conn_t *conn;
+    cartconv_t **contexts;
+    pthread_t *threads;
+    int i, n, result = 0;
+
+    if (workers <= 0) {
+        workers = get_cpu_count();
+    }
+    queue.max = (unsigned int)workers * SERVER_QUEUE_DEPTH;
+
+    if (strcmp(name, "-")) {
+        listen_fd = server_listen(name);
+        if (listen_fd < 0) {
+            return 1;
+        }
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = server_signal;     /* no SA_RESTART, accept() and read() return */
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    contexts = calloc((size_t)workers, sizeof(cartconv_t *));
+    threads = malloc((size_t)workers * sizeof(pthread_t));
+    for (n = 0; contexts != NULL && threads != NULL && n < workers; n++) {
+        contexts[n] = cartconv_new();
+        if (contexts[n] == NULL) {
+            break;
+        }
+        /* the requests themselves already run in parallel */
+        cartconv_set_threads(contexts[n], 1);
+        if (server_start_thread(&threads[n], server_worker, contexts[n]) < 0) {
+            cartconv_free(contexts[n]);
+            break;
+        }
+    }
+    if (n == 0) {
+        fprintf(stderr, "Error: Can't start the server workers\n");
+        result = 1;
+    } else if (listen_fd >= 0) {
+        server_accept();
+    } else {
+        conn = server_new_conn(STDOUT_FILENO, 0);
+        if (conn != NULL) {
+            server_read(conn, dup(STDIN_FILENO));
+            server_unref_conn(conn);
+        }
+    }
+
+    server_stop_queue();
+    for (i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+        cartconv_free(contexts[i]);
+    }
+    free(threads);
+    free(contexts);
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(name);
+    }
+    return result;
+}
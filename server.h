@@ -0,0 +1,35 @@
+/** \file   server.h
+ * \brief   Server mode of cartconv
+ */
+
+/*
+ * This file is part of VICE, the Versatile Commodore Emulator.
+ * See README for copyright notice.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ *  02111-1307  USA.
+ *
+ */
+
+#ifndef CARTCONV_SERVER_H
+#define CARTCONV_SERVER_H
+
+/* answer info, extract, convert and hash requests, one per line, on the
+   unix socket name or on stdin and stdout if name is "-". the requests are
+   done by worker threads (0 = one per cpu) that keep their context from one
+   request to the next. returns when stdin ends or on SIGINT/SIGTERM. */
+int server_main(const char *name, int workers);
+
+#endif